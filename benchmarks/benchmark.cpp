@@ -0,0 +1,339 @@
+/*
+Rendering benchmark built from the scenarios of the examples: scatterplots,
+lines of fplot, histograms and a grid of windows, each for a range of
+numbers of points. Every run is split to four timed phases:
+
+	ingest - creating the figure and plotting the data (generated beforehand)
+	layout - the first paint, which lays out the windows, reduces the data
+	         and records the drawing of every window without drawing pixels
+	raster - rendering the retained drawings to a framebuffer
+	encode - encoding the framebuffer to memory
+
+The results are written as csv, one row per run. A drawing too large to be
+retained (see DISPLAY_LIST_LIMIT) is laid out again while rasterized, which
+is marked by retained = 0.
+
+Build and run on Linux:
+	g++ -std=c++17 -O2 -pthread benchmark.cpp -o benchmark
+	./benchmark --sizes 1e3,1e4,1e5,1e6,1e7,1e8 --scenarios scatter,fplot,hist,grid \
+		--repeat 3 --format png --output results.csv
+*/
+#define _USE_MATH_DEFINES
+#include "../src/Figure.h"
+#include <math.h>
+#include <chrono>
+#include <functional>
+#include <random>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsed_ms(Clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	/*
+	Canvas measuring the text like CanvasMemory while drawing nothing,
+	so that a paint to it only lays out and records the windows.
+	*/
+	class CanvasLayout : public cpplot::CanvasMemory
+	{
+	public:
+		CanvasLayout(cpplot::Framebuffer& in_framebuffer) : CanvasMemory(in_framebuffer) {};
+
+		virtual void line_to(int x, int y) {};
+
+		virtual void polyline(const POINT *points, int count) {};
+
+		virtual void polypolyline(const POINT *points, const DWORD *counts,
+			int polylines) {};
+
+		virtual void rectangle(int left, int top, int right, int bottom) {};
+
+		virtual void rectangles(const RECT *rects, int count) {};
+
+		virtual void ellipse(int left, int top, int right, int bottom) {};
+
+		virtual void ellipses(const RECT *rects, int count) {};
+
+		virtual void text_out(int x, int y, const char *text, int length) {};
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba) {};
+
+		virtual void set_clip(const RECT *clip) {};
+	};
+
+	// Data of a scenario, generated before the timing
+	struct Data
+	{
+		std::vector<double> x, y;
+	};
+
+	struct Scenario
+	{
+		std::string name;
+		int width, height; // size of the figure
+		std::function<void(size_t points, Data& data)> generate;
+		std::function<std::unique_ptr<cpplot::Figure>(size_t points, const Data& data)> ingest;
+	};
+
+	struct Result
+	{
+		std::string scenario;
+		size_t points;
+		int repeat;
+		double ingest_ms, layout_ms, raster_ms, encode_ms;
+		size_t bytes; // size of the encoded image
+		bool retained; // whether the raster phase only replayed the recorded drawing
+	};
+
+	std::vector<Scenario> scenarios()
+	{
+		std::vector<Scenario> list;
+
+		// Example 1: scatterplot of a bivariate normal sample
+		list.push_back(Scenario{ "scatter", 1000, 1000,
+			[](size_t points, Data& data)
+		{
+			std::mt19937_64 generator(123);
+			std::normal_distribution<double> distribution(0.0, 1.0);
+			data.x.resize(points);
+			data.y.resize(points);
+			for (size_t i = 0; i != points; ++i)
+			{
+				data.x[i] = distribution(generator);
+				data.y[i] = distribution(generator);
+			}
+		},
+			[](size_t points, const Data& data)
+		{
+			std::unique_ptr<cpplot::Figure> figure(new cpplot::Figure(1000, 1000));
+			figure->plot(data.x, data.y, "", "scatter", 5);
+			figure->xlabel("Dimension 1");
+			figure->ylabel("Dimension 2");
+			figure->title("2-variate Normal Random Variable");
+			return figure;
+		} });
+
+		// Example 2: lines of functions evaluated at points equally spaced points
+		list.push_back(Scenario{ "fplot", 1500, 1000,
+			[](size_t points, Data& data) {},
+			[](size_t points, const Data& data)
+		{
+			std::unique_ptr<cpplot::Figure> figure(new cpplot::Figure(1500, 1000));
+			cpplot::SampleOptions options(points, false);
+			figure->fplot([](double x) { return sin(x); }, -M_PI, M_PI, options,
+				"Sine", "line", 3, RED);
+			figure->fplot([](double x) { return cos(x); }, -M_PI, M_PI, options,
+				"Cosine", "line", 3, GREEN, { 0, 0 });
+			figure->xlabel("Index");
+			figure->ylabel("Value");
+			figure->title("Sine and Cosine");
+			return figure;
+		} });
+
+		// Example 3: normalized histograms of a normal and an exponential sample
+		list.push_back(Scenario{ "hist", 1000, 1000,
+			[](size_t points, Data& data)
+		{
+			std::mt19937_64 generator(123);
+			std::normal_distribution<double> distribution_n(0.0, 1.0);
+			std::exponential_distribution<double> distribution_e(1.0);
+			data.x.resize(points);
+			data.y.resize(points);
+			for (size_t i = 0; i != points; ++i)
+			{
+				data.x[i] = distribution_n(generator);
+				data.y[i] = distribution_e(generator);
+			}
+		},
+			[](size_t points, const Data& data)
+		{
+			std::unique_ptr<cpplot::Figure> figure(new cpplot::Figure(
+				std::vector<int>{ 1000 }, std::vector<int>{ 500, 500 }));
+			figure->hist(data.x, 100, {}, "", 1, GREEN, true, { 0, 0 });
+			figure->hist(data.y, 100, {}, "", 1, BLUE, true, { 1, 0 });
+			return figure;
+		} });
+
+		// Example 4: 2 x 2 windows, each with a line and a scatterplot
+		// of an eighth of the points
+		list.push_back(Scenario{ "grid", 1800, 1200,
+			[](size_t points, Data& data)
+		{
+			std::mt19937_64 generator(123);
+			std::normal_distribution<double> distribution(0.0, 1.0);
+			size_t length = points / 8 ? points / 8 : 1;
+			data.x.resize(length);
+			data.y.resize(length);
+			double walk = 0.0;
+			for (size_t i = 0; i != length; ++i)
+			{
+				walk += distribution(generator);
+				data.x[i] = (double)i;
+				data.y[i] = walk;
+			}
+		},
+			[](size_t points, const Data& data)
+		{
+			std::unique_ptr<cpplot::Figure> figure(new cpplot::Figure(
+				std::vector<int>{ 900, 900 }, std::vector<int>{ 600, 600 },
+				std::vector<COLORREF>{}, true));
+			for (int i = 0; i != 2; ++i)
+			{
+				for (int j = 0; j != 2; ++j)
+				{
+					figure->plot(data.x, data.y, "Line A", "line", 1, BLUE, { i, j });
+					figure->plot(data.x, data.y, "Points B", "scatter", 1, RED, { i, j });
+				}
+			}
+			return figure;
+		} });
+
+		return list;
+	}
+
+	Result run(const Scenario& scenario, size_t points, const Data& data,
+		const std::string& format, unsigned int threads)
+	{
+		Result result = Result{ scenario.name, points, 0, 0.0, 0.0, 0.0, 0.0, 0, false };
+
+		Clock::time_point start = Clock::now();
+		std::unique_ptr<cpplot::Figure> figure = scenario.ingest(points, data);
+		figure->set_paint_threads(threads);
+		result.ingest_ms = elapsed_ms(start);
+
+		cpplot::Framebuffer framebuffer(scenario.width, scenario.height);
+		RECT client_area = { 0, 0, scenario.width, scenario.height };
+
+		start = Clock::now();
+		{
+			CanvasLayout canvas(framebuffer);
+			figure->paint(&canvas, client_area);
+		}
+		result.layout_ms = elapsed_ms(start);
+
+		start = Clock::now();
+		framebuffer.erase();
+		figure->paint(framebuffer);
+		result.raster_ms = elapsed_ms(start);
+		result.retained = figure->get_frame_stats().drawn == 0;
+
+		start = Clock::now();
+		cpplot::MemorySink sink;
+		cpplot::EncodeImage(framebuffer, format, sink);
+		result.encode_ms = elapsed_ms(start);
+		result.bytes = sink.get_data().size();
+
+		return result;
+	}
+
+	// Split a comma separated list
+	std::vector<std::string> split(const std::string& list)
+	{
+		std::vector<std::string> items;
+		size_t begin = 0;
+		while (begin <= list.size())
+		{
+			size_t end = list.find(',', begin);
+			end = end == std::string::npos ? list.size() : end;
+			if (end > begin)
+			{
+				items.push_back(list.substr(begin, end - begin));
+			}
+			begin = end + 1;
+		}
+
+		return items;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> sizes = { "1e3", "1e4", "1e5", "1e6", "1e7" };
+	std::vector<std::string> names = { "scatter", "fplot", "hist", "grid" };
+	int repeat = 3;
+	std::string format = "png";
+	std::string output = "benchmark.csv";
+	unsigned int threads = 1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (i + 1 == argc)
+		{
+			printf("ERROR: Option %s has no value.\n", option.c_str());
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (option == "--sizes") { sizes = split(value); }
+		else if (option == "--scenarios") { names = split(value); }
+		else if (option == "--repeat") { repeat = atoi(value.c_str()); }
+		else if (option == "--format") { format = value; }
+		else if (option == "--output") { output = value; }
+		else if (option == "--threads") { threads = (unsigned int)atoi(value.c_str()); }
+		else
+		{
+			printf("Usage: benchmark [--sizes 1e3,1e4,...] [--scenarios scatter,fplot,hist,grid]\n"
+				"\t[--repeat 3] [--format png|bmp|ppm] [--output benchmark.csv] [--threads 1]\n");
+			return 1;
+		}
+	}
+
+	FILE *stream = fopen(output.c_str(), "w");
+	if (!stream)
+	{
+		printf("ERROR: File %s could not be opened for writing.\n", output.c_str());
+		return 1;
+	}
+	fprintf(stream, "scenario,points,repeat,ingest_ms,layout_ms,raster_ms,encode_ms,bytes,retained\n");
+
+	std::vector<Scenario> list = scenarios();
+	for (size_t n = 0; n != names.size(); ++n)
+	{
+		const Scenario *scenario = nullptr;
+		for (size_t s = 0; s != list.size(); ++s)
+		{
+			scenario = list[s].name == names[n] ? &list[s] : scenario;
+		}
+		if (!scenario)
+		{
+			printf("Warning: Unknown scenario %s. No action taken.\n", names[n].c_str());
+			continue;
+		}
+
+		for (size_t k = 0; k != sizes.size(); ++k)
+		{
+			size_t points = (size_t)strtod(sizes[k].c_str(), nullptr);
+			if (!points)
+			{
+				printf("Warning: Invalid size %s. No action taken.\n", sizes[k].c_str());
+				continue;
+			}
+
+			Data data;
+			scenario->generate(points, data);
+
+			for (int r = 0; r < repeat; ++r)
+			{
+				Result result = run(*scenario, points, data, format, threads);
+				result.repeat = r;
+
+				fprintf(stream, "%s,%zu,%d,%.3f,%.3f,%.3f,%.3f,%zu,%d\n", result.scenario.c_str(),
+					result.points, result.repeat, result.ingest_ms, result.layout_ms,
+					result.raster_ms, result.encode_ms, result.bytes, result.retained ? 1 : 0);
+				fflush(stream);
+
+				printf("%-8s %10zu  ingest %9.2f ms  layout %9.2f ms  raster %8.2f ms  encode %8.2f ms%s\n",
+					result.scenario.c_str(), result.points, result.ingest_ms, result.layout_ms,
+					result.raster_ms, result.encode_ms, result.retained ? "" : "  (not retained)");
+			}
+		}
+	}
+
+	return fclose(stream) == 0 ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+#pragma once
+#include "Header.h"
+#include "DataView.h"
+#include "Parallel.h"
+
+#include <cfloat>
+
+namespace cpplot
+{
+	/*
+	Counting of values in bins given by their edges. The bins are half-open
+	[edge_i, edge_i+1), except the last one, which includes its right edge.
+	Values outside of the edges and NaNs are not counted. The bin of a value
+	is computed directly for uniform edges and found by binary search otherwise.
+	*/
+	class Binning
+	{
+	public:
+		Binning(const std::vector<double>& in_edges);
+
+		size_t bins() const { return edges.size() > 1 ? edges.size() - 1 : 0; }
+
+		const std::vector<double>& get_edges() const { return edges; }
+
+		// Bin of the value or -1 if it is not counted
+		long long find(double value) const;
+
+		// Add the counts of the values to counts, which has a value for every bin,
+		// and return the number of the counted values
+		unsigned long long count(const DataView& data,
+			std::vector<unsigned long long>& counts) const;
+
+	private:
+		// Move the guess of the bin to the bin whose edges enclose the value
+		size_t correct(double value, size_t bin) const;
+
+		// Count values of the block to counts
+		void count_block(const double *values, size_t length,
+			unsigned long long *counts) const;
+
+		std::vector<double> edges;
+		bool uniform; // whether the direct computation of the bin can be used
+		double first, last, scale; // first and last edge, bins per unit
+	};
+
+	inline Binning::Binning(const std::vector<double>& in_edges) : edges(in_edges),
+		uniform(false), first(0.0), last(0.0), scale(0.0)
+	{
+		if (!std::is_sorted(edges.begin(), edges.end()))
+		{
+			printf("Warning: Bin edges are not sorted. Sorted edges are used.\n");
+
+			std::sort(edges.begin(), edges.end());
+		}
+
+		size_t count = this->bins();
+		if (!count)
+		{
+			return;
+		}
+
+		first = edges.front();
+		last = edges.back();
+		if (!(last > first))
+		{
+			return;
+		}
+
+		// Edges close to the uniform ones give a guess off by at most one bin,
+		// which is corrected to the exact edges
+		double width = (last - first) / count;
+		uniform = true;
+		for (size_t i = 0; i != edges.size() && uniform; ++i)
+		{
+			uniform = fabs(edges[i] - (first + i * width)) <= 1e-6 * width;
+		}
+
+		scale = count / (last - first);
+	}
+
+	inline size_t Binning::correct(double value, size_t bin) const
+	{
+		size_t count = this->bins();
+		bin = bin < count ? bin : count - 1;
+
+		while (bin > 0 && value < edges[bin])
+		{
+			--bin;
+		}
+
+		while (bin + 1 < count && value >= edges[bin + 1])
+		{
+			++bin;
+		}
+
+		return bin;
+	}
+
+	inline long long Binning::find(double value) const
+	{
+		// Comparisons with NaN are false, so it is not counted
+		if (!this->bins() || !(value >= first && value <= last))
+		{
+			return -1;
+		}
+
+		if (uniform)
+		{
+			return (long long)this->correct(value, (size_t)((value - first) * scale));
+		}
+
+		size_t bin = std::upper_bound(edges.begin(), edges.end(), value) - edges.begin() - 1;
+
+		return bin < this->bins() ? (long long)bin : (long long)this->bins() - 1;
+	}
+
+	inline void Binning::count_block(const double *values, size_t length,
+		unsigned long long *counts) const
+	{
+		size_t i = 0;
+
+		if (uniform)
+		{
+#ifdef CPPLOT_SSE2
+			const __m128d v_first = _mm_set1_pd(first);
+			const __m128d v_last = _mm_set1_pd(last);
+			const __m128d v_scale = _mm_set1_pd(scale);
+			int guesses[4];
+
+			for (; i + 2 <= length; i += 2)
+			{
+				__m128d v = _mm_loadu_pd(values + i);
+
+				// Comparisons with NaN are false, so NaNs are skipped too
+				int mask = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(v, v_first),
+					_mm_cmple_pd(v, v_last)));
+				if (!mask)
+				{
+					continue;
+				}
+
+				_mm_storeu_si128((__m128i*)guesses, _mm_cvttpd_epi32(
+					_mm_mul_pd(_mm_sub_pd(v, v_first), v_scale)));
+
+				if (mask & 1)
+				{
+					++counts[this->correct(values[i], (size_t)guesses[0])];
+				}
+				if (mask & 2)
+				{
+					++counts[this->correct(values[i + 1], (size_t)guesses[1])];
+				}
+			}
+#endif
+			for (; i < length; ++i)
+			{
+				double value = values[i];
+				if (value >= first && value <= last)
+				{
+					++counts[this->correct(value, (size_t)((value - first) * scale))];
+				}
+			}
+
+			return;
+		}
+
+		for (; i < length; ++i)
+		{
+			long long bin = this->find(values[i]);
+			if (bin >= 0)
+			{
+				++counts[bin];
+			}
+		}
+	}
+
+	inline unsigned long long Binning::count(const DataView& data,
+		std::vector<unsigned long long>& counts) const
+	{
+		size_t count = this->bins();
+		counts.resize(count, 0);
+		if (!count)
+		{
+			return 0;
+		}
+
+		// Every thread counts to its own histogram, which are merged afterwards
+		size_t length = data.size();
+		size_t chunks = Parallel::chunk_count(length);
+		std::vector<std::vector<unsigned long long>> local_counts(chunks,
+			std::vector<unsigned long long>(count, 0));
+
+		Parallel::for_chunks(length, chunks, [&](size_t index, size_t begin, size_t end)
+		{
+			unsigned long long *local = local_counts[index].data();
+
+			const double *values = data.contiguous();
+			if (values)
+			{
+				this->count_block(values + begin, end - begin, local);
+				return;
+			}
+
+			// Other element types and strides are converted block by block
+			static constexpr size_t block = 1024;
+			double buffer[block];
+			for (size_t i = begin; i < end; i += block)
+			{
+				size_t size = end - i < block ? end - i : block;
+				data.read(i, size, buffer);
+
+				this->count_block(buffer, size, local);
+			}
+		});
+
+		unsigned long long total = 0;
+		for (size_t i = 0; i != chunks; ++i)
+		{
+			for (size_t j = 0; j != count; ++j)
+			{
+				counts[j] += local_counts[i][j];
+				total += local_counts[i][j];
+			}
+		}
+
+		return total;
+	}
+
+	/*
+	Histogram of a fixed number of bins for data of an unknown range. The bins
+	are aligned to the multiples of their width, which is a power of two, so
+	when new values do not fit, the width is doubled by merging pairs of
+	neighbouring bins and the counts stay exact. Two sketches can be merged
+	the same way. Memory use depends only on the number of bins.
+	*/
+	class BinSketch
+	{
+	public:
+		BinSketch(size_t in_bins);
+
+		// Count the finite values of the data
+		void add(const DataView& data);
+
+		// Add the counts of another sketch
+		void merge(const BinSketch& other);
+
+		unsigned long long get_total() const { return total; }
+
+		// Edges and counts of the bins from the first to the last non-empty one
+		void get_bins(std::vector<double>& edges,
+			std::vector<unsigned long long>& out_counts) const;
+
+	private:
+		// Global index of the bin of the value, the bins are [i * width, (i + 1) * width)
+		long long index(double value) const { return (long long)floor(value / width); }
+
+		// Set the first width for the values between min and max
+		void initialize(double min, double max);
+
+		// Double the width, merging the bins, until the indices of the values
+		// between min and max are below INDEX_LIMIT -> a chunk far outside of
+		// the scale of the first one does not overflow them
+		void widen(double min, double max);
+
+		// Double the width at least shift times and until the global bins first 
+		// to last fit to the window and move the window to start at the bin of first
+		void fit(long long first, long long last, int shift = 0);
+
+		// Index of the bin containing the bin of index after doubling the width 
+		// shift times, rounding towards minus infinity
+		static long long coarsen(long long index, int shift)
+		{
+			return shift < 63 ? index >> shift : (index < 0 ? -1 : 0);
+		}
+
+		// Largest magnitude of the indices, 2^52, at which they are exact in double
+		static constexpr double INDEX_LIMIT = 4503599627370496.0;
+
+		// Window positions of the first and the last non-empty bin, false if empty
+		bool occupied(size_t& first, size_t& last) const;
+
+		size_t bins;
+		double width; // 0 until the first values are added
+		long long origin; // global index of the first bin of the window
+		std::vector<unsigned long long> counts;
+		unsigned long long total;
+	};
+
+	inline BinSketch::BinSketch(size_t in_bins) : bins(in_bins > 1 ? in_bins : 2),
+		width(0.0), origin(0), counts(bins, 0), total(0) {}
+
+	inline void BinSketch::initialize(double min, double max)
+	{
+		double span = max - min;
+		double magnitude = fabs(min) > fabs(max) ? fabs(min) : fabs(max);
+
+		double start = span > 0.0 ? span / bins : (magnitude > 0.0 ? magnitude / bins : 1.0);
+
+		// Bins narrower than the resolution of the values would overflow the indices
+		start = start > magnitude * DBL_EPSILON * 4.0 ? start : magnitude * DBL_EPSILON * 4.0;
+		start = start > DBL_MIN ? start : DBL_MIN; // subnormal values
+
+		width = exp2(ceil(log2(start)));
+		origin = this->index(min);
+	}
+
+	inline bool BinSketch::occupied(size_t& first, size_t& last) const
+	{
+		if (!total)
+		{
+			return false;
+		}
+
+		first = 0;
+		while (!counts[first]) { ++first; }
+
+		last = bins - 1;
+		while (!counts[last]) { --last; }
+
+		return true;
+	}
+
+	inline void BinSketch::widen(double min, double max)
+	{
+		double magnitude = fabs(min) > fabs(max) ? fabs(min) : fabs(max);
+		if (magnitude < INDEX_LIMIT * width)
+		{
+			return;
+		}
+
+		// Doublings needed, computed from the logarithms, which do not overflow
+		int shift = (int)ceil(log2(magnitude) - log2(width) - log2(INDEX_LIMIT));
+		shift = shift > 0 ? shift : 0;
+		while (!(magnitude < INDEX_LIMIT * ldexp(width, shift)))
+		{
+			++shift;
+		}
+
+		size_t first_used, last_used;
+		if (this->occupied(first_used, last_used))
+		{
+			this->fit(origin + (long long)first_used, origin + (long long)last_used, shift);
+		}
+		else
+		{
+			this->fit(origin, origin, shift);
+		}
+	}
+
+	inline void BinSketch::fit(long long first, long long last, int shift)
+	{
+		// Indices of the merged bins are halved, rounding towards minus infinity
+		while (coarsen(last, shift) - coarsen(first, shift) + 1 > (long long)bins)
+		{
+			++shift;
+		}
+
+		long long new_origin = coarsen(first, shift);
+		if (!shift && new_origin == origin)
+		{
+			return;
+		}
+
+		std::vector<unsigned long long> new_counts(bins, 0);
+		for (size_t i = 0; i != bins; ++i)
+		{
+			if (counts[i])
+			{
+				new_counts[(size_t)(coarsen(origin + (long long)i, shift) - new_origin)] += counts[i];
+			}
+		}
+
+		counts.swap(new_counts);
+		origin = new_origin;
+		width = ldexp(width, shift);
+	}
+
+	inline void BinSketch::add(const DataView& data)
+	{
+		// Range of the finite values of the chunk
+		double min = INFINITY, max = -INFINITY;
+		double buffer[1024];
+		for (size_t i = 0; i < data.size(); i += 1024)
+		{
+			size_t size = data.size() - i < 1024 ? data.size() - i : 1024;
+			data.read(i, size, buffer);
+
+			for (size_t j = 0; j != size; ++j)
+			{
+				if (std::isfinite(buffer[j]))
+				{
+					min = buffer[j] < min ? buffer[j] : min;
+					max = buffer[j] > max ? buffer[j] : max;
+				}
+			}
+		}
+
+		if (min > max)
+		{
+			return;
+		}
+
+		if (width == 0.0)
+		{
+			this->initialize(min, max);
+		}
+
+		this->widen(min, max);
+
+		long long first = this->index(min);
+		long long last = this->index(max);
+
+		size_t first_used, last_used;
+		if (this->occupied(first_used, last_used))
+		{
+			first = first < origin + (long long)first_used ? first : origin + (long long)first_used;
+			last = last > origin + (long long)last_used ? last : origin + (long long)last_used;
+		}
+
+		this->fit(first, last);
+
+		// The window covers all the values, which are never equal to its last edge
+		std::vector<double> edges(bins + 1);
+		for (size_t i = 0; i != bins + 1; ++i)
+		{
+			edges[i] = (double)(origin + (long long)i) * width;
+		}
+
+		total += Binning(edges).count(data, counts);
+	}
+
+	inline void BinSketch::merge(const BinSketch& other)
+	{
+		size_t other_first, other_last;
+		if (!other.occupied(other_first, other_last))
+		{
+			return;
+		}
+
+		// Bring the other sketch to the same width and add its bins by their edges
+		BinSketch copy = other;
+		if (width == 0.0)
+		{
+			width = copy.width;
+			origin = copy.origin + (long long)other_first;
+		}
+
+		while (copy.width < width)
+		{
+			copy.fit(copy.origin, copy.origin + (long long)copy.bins * 2 - 1);
+		}
+
+		while (width < copy.width)
+		{
+			this->fit(origin, origin + (long long)bins * 2 - 1);
+		}
+
+		copy.occupied(other_first, other_last);
+		long long first = copy.origin + (long long)other_first;
+		long long last = copy.origin + (long long)other_last;
+
+		size_t first_used, last_used;
+		if (this->occupied(first_used, last_used))
+		{
+			first = first < origin + (long long)first_used ? first : origin + (long long)first_used;
+			last = last > origin + (long long)last_used ? last : origin + (long long)last_used;
+		}
+
+		this->fit(first, last);
+
+		// The merging of this sketch may have doubled the width again
+		while (copy.width < width)
+		{
+			copy.fit(copy.origin, copy.origin + (long long)copy.bins * 2 - 1);
+		}
+
+		for (size_t i = 0; i != copy.bins; ++i)
+		{
+			if (copy.counts[i])
+			{
+				counts[(size_t)(copy.origin + (long long)i - origin)] += copy.counts[i];
+			}
+		}
+
+		total += copy.total;
+	}
+
+	inline void BinSketch::get_bins(std::vector<double>& edges,
+		std::vector<unsigned long long>& out_counts) const
+	{
+		edges.clear();
+		out_counts.clear();
+
+		size_t first, last;
+		if (!this->occupied(first, last))
+		{
+			return;
+		}
+
+		out_counts.assign(counts.begin() + first, counts.begin() + last + 1);
+		for (size_t i = first; i != last + 2; ++i)
+		{
+			edges.push_back((double)(origin + (long long)i) * width);
+		}
+	}
+}
+
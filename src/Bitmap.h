@@ -1,10 +1,77 @@
 #pragma once
 #include "Header.h"
+#include "Framebuffer.h"
+#include "Deflate.h"
+#include "Trace.h"
+
+#include <cstdlib>
+#include <mutex>
 
 namespace cpplot
 {
+	// Destination of the bytes of an encoded image
+	class ImageSink
+	{
+	public:
+		// Write the bytes, false if they could not be written
+		virtual bool write(const unsigned char *data, size_t length) = 0;
+
+		virtual ~ImageSink() = default;
+	};
+
+	// Sink writing to an open file, which is left open
+	class FileSink : public ImageSink
+	{
+	public:
+		FileSink(FILE *in_stream) : stream(in_stream) {}
+
+		virtual bool write(const unsigned char *data, size_t length)
+		{
+			return fwrite(data, 1, length, stream) == length;
+		}
+
+	private:
+		FILE *stream;
+	};
+
+	// Sink collecting the bytes in memory
+	class MemorySink : public ImageSink
+	{
+	public:
+		virtual bool write(const unsigned char *data, size_t length)
+		{
+			bytes.insert(bytes.end(), data, data + length);
+			return true;
+		}
+
+		const std::vector<unsigned char>& get_data() const { return bytes; }
+
+		void clear() { bytes.clear(); }
+
+	private:
+		std::vector<unsigned char> bytes;
+	};
+
+	// Filter of the PNG rows applied before their compression
+	enum PngFilter { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVERAGE,
+		PNG_FILTER_PAETH, PNG_FILTER_ADAPTIVE };
+
+	// Settings of the built-in encoders. Level 0 is the fastest and writes the
+	// rows unfiltered, level 9 with PNG_FILTER_ADAPTIVE writes the smallest files.
+	struct ImageOptions
+	{
+		ImageOptions(int in_compression = PNG_COMPRESSION_LEVEL,
+			PngFilter in_filter = PNG_FILTER_ADAPTIVE, bool in_decimate = true) :
+			compression(in_compression), filter(in_filter), decimate(in_decimate) {}
+
+		int compression; // 0 (stored) to 9 (smallest), also of the pdf content
+		PngFilter filter; // PNG_FILTER_ADAPTIVE chooses the filter of every row
+		bool decimate; // svg and pdf leave out what does not change the drawing at pixel precision
+	};
+
+#ifdef _WIN32
 	// this function manages obtaining the CLSID identification of an extension type
-	int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
+	inline int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
 	{
 		UINT  num = 0;          // number of image encoders
 		UINT  size = 0;         // size of the image encoder array in bytes
@@ -34,69 +101,562 @@ namespace cpplot
 		return -1;  // Failure
 	}
 
-	// This function saves the image
-	void CreateImage(HWND hwnd, HDC hdc, wchar_t *dir, wchar_t *ext)
+	namespace Encoding
 	{
-		// Initialize GDI+
-		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
-		ULONG_PTR gdiplusToken;
-		Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
+		// GDI+ is started at its first use and shut down at the exit of the program
+		class GdiplusSession
+		{
+		public:
+			GdiplusSession() : token(0)
+			{
+				Gdiplus::GdiplusStartupInput input;
+				status = Gdiplus::GdiplusStartup(&token, &input, NULL);
+			}
+
+			GdiplusSession(const GdiplusSession& session) = delete;
 
-		// Create compatible DC and bitmaps
-		HDC memDC = CreateCompatibleDC(hdc);
+			GdiplusSession& operator=(const GdiplusSession& session) = delete;
 
-		RECT rcClient;
-		GetClientRect(hwnd, &rcClient);
-		int nWidth = rcClient.right - rcClient.left;
-		int nHeight = rcClient.bottom - rcClient.top;
+			~GdiplusSession()
+			{
+				if (status == Gdiplus::Ok)
+				{
+					Gdiplus::GdiplusShutdown(token);
+				}
+			}
+
+			bool is_started() const { return status == Gdiplus::Ok; }
+
+		private:
+			ULONG_PTR token;
+			Gdiplus::Status status;
+		};
 
-		HDC memdc = CreateCompatibleDC(hdc);
-		HBITMAP hbitmap = CreateCompatibleBitmap(hdc, nWidth, nHeight);
-		HBITMAP oldbmp = (HBITMAP)SelectObject(memdc, hbitmap);
-		BitBlt(memdc, 0, 0, nWidth, nHeight, hdc, 0, 0, SRCCOPY | CAPTUREBLT);
-		SelectObject(memdc, oldbmp);
+		inline const GdiplusSession& gdiplus_session()
+		{
+			static const GdiplusSession session;
+
+			return session;
+		}
 
-		// Create the wchar_t holding the desired extension type
-		// Ext needs to be null terminated -> this is a safety check
-		unsigned int counter = 1;
-		wchar_t *ext_copy = ext;
-		while (*ext_copy++ != L'\0')
+		// CLSID of the encoder of the MIME type, the encoders are
+		// listed only at the first use of every type
+		inline bool encoder_clsid(const std::wstring& mime, CLSID *clsid)
 		{
-			++counter;
-			if (counter > MAX_EXTENSION_SIZE)
+			static std::mutex mutex;
+			static std::map<std::wstring, CLSID> clsids;
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			std::map<std::wstring, CLSID>::const_iterator it = clsids.find(mime);
+			if (it == clsids.end())
 			{
-				printf("ERROR: Encoder extension is too long. Either change the "
-					"extension or set the MAX_EXTENSION_SIZE macro\n");
-				return;
+				CLSID found;
+				if (GetEncoderClsid(mime.c_str(), &found) < 0)
+				{
+					return false;
+				}
+				it = clsids.insert(std::make_pair(mime, found)).first;
 			}
+
+			*clsid = it->second;
+
+			return true;
+		}
+	}
+
+	// This function saves the image with the GDI+ encoder of the extension
+	inline bool CreateImage(const Framebuffer& framebuffer, const wchar_t *dir, const wchar_t *ext)
+	{
+		if (!Encoding::gdiplus_session().is_started())
+		{
+			printf("ERROR: GDI+ could not be started.\n");
+			return false;
+		}
+
+		if (wcslen(ext) + 1 > MAX_EXTENSION_SIZE)
+		{
+			printf("ERROR: Encoder extension is too long. Either change the "
+				"extension or set the MAX_EXTENSION_SIZE macro\n");
+			return false;
 		}
-		unsigned int clsid_buffer_size = 6 + counter;
-		wchar_t *clsid_buff = new wchar_t[clsid_buffer_size];
-		wcscpy_s(clsid_buff, 7, L"image/\0");
-		wcscpy_s(clsid_buff + 6, counter, ext);
 
 		// Get the encoder parameters
-		CLSID pngClsid;
-		HRESULT hresult = GetEncoderClsid(clsid_buff, &pngClsid);
-		if (hresult < 0)
+		CLSID clsid;
+		if (!Encoding::encoder_clsid(L"image/" + std::wstring(ext), &clsid))
 		{
 			printf("ERROR: Given encoder is not installed.\n");
+			return false;
+		}
+
+		// GDI+ expects the pixels in the BGRA order
+		int width = framebuffer.get_width();
+		int height = framebuffer.get_height();
+		std::vector<unsigned char> bgra(framebuffer.get_data(),
+			framebuffer.get_data() + (size_t)width * height * 4);
+		for (size_t i = 0; i < bgra.size(); i += 4)
+		{
+			std::swap(bgra[i], bgra[i + 2]);
 		}
 
 		// Save the bitmap to file
-		Gdiplus::Bitmap bitmap(hbitmap, NULL);
-		Gdiplus::Status s = bitmap.Save(dir, &pngClsid);
+		Gdiplus::Bitmap bitmap(width, height, width * 4, PixelFormat32bppARGB, bgra.data());
+		Gdiplus::Status s = bitmap.Save(dir, &clsid);
 		if (s)
 		{
 			printf("ERROR: An image could not be saved. Error status from "
 				"Gdiplus::Bitmap::save: %d \n", s);
+			return false;
 		}
 
-		// Clean the objects
-		DeleteObject(hbitmap);
-		DeleteDC(memdc);
+		return true;
+	}
+#endif
 
-		delete[] clsid_buff;
+	// Helper functions for writing the built-in image formats
+	namespace Encoding
+	{
+		inline FILE *open_file(const std::string& file)
+		{
+#ifdef _WIN32
+			std::wstring wide_file(file.size() + 1, L'\0');
+			int length = MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1,
+				&wide_file[0], (int)wide_file.size());
+			wide_file.resize(length > 0 ? length - 1 : 0);
+
+			FILE *stream = nullptr;
+			_wfopen_s(&stream, wide_file.c_str(), L"wb");
+
+			return stream;
+#else
+			return fopen(file.c_str(), "wb");
+#endif
+		}
+
+		inline void put_u16_le(std::vector<unsigned char>& buffer, unsigned int value)
+		{
+			buffer.push_back((unsigned char)(value & 0xFF));
+			buffer.push_back((unsigned char)((value >> 8) & 0xFF));
+		}
+
+		inline void put_u32_le(std::vector<unsigned char>& buffer, unsigned long value)
+		{
+			put_u16_le(buffer, (unsigned int)(value & 0xFFFF));
+			put_u16_le(buffer, (unsigned int)((value >> 16) & 0xFFFF));
+		}
+
+		inline void put_u32_be(std::vector<unsigned char>& buffer, unsigned long value)
+		{
+			buffer.push_back((unsigned char)((value >> 24) & 0xFF));
+			buffer.push_back((unsigned char)((value >> 16) & 0xFF));
+			buffer.push_back((unsigned char)((value >> 8) & 0xFF));
+			buffer.push_back((unsigned char)(value & 0xFF));
+		}
+
+		// CRC-32 remainders of the bytes
+		struct Crc32Table
+		{
+			Crc32Table()
+			{
+				for (unsigned long n = 0; n != 256; ++n)
+				{
+					unsigned long c = n;
+					for (int k = 0; k != 8; ++k)
+					{
+						c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+					}
+					values[n] = c;
+				}
+			}
+
+			unsigned long values[256];
+		};
+
+		// CRC-32 as required by the PNG chunks
+		inline unsigned long crc32(unsigned long crc, const unsigned char *data, size_t length)
+		{
+			// The table is initialized once even if images are written on several threads
+			static const Crc32Table table;
+
+			crc ^= 0xFFFFFFFFUL;
+			for (size_t i = 0; i != length; ++i)
+			{
+				crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+
+			return crc ^ 0xFFFFFFFFUL;
+		}
+
+		// Write a PNG chunk of the type and the data to the sink
+		inline bool write_png_chunk(ImageSink& sink, const char *type,
+			const unsigned char *data, size_t length)
+		{
+			std::vector<unsigned char> header;
+			put_u32_be(header, (unsigned long)length);
+			header.insert(header.end(), type, type + 4);
+
+			unsigned long crc = crc32(crc32(0, (const unsigned char *)type, 4), data, length);
+			std::vector<unsigned char> footer;
+			put_u32_be(footer, crc);
+
+			return sink.write(header.data(), header.size()) &&
+				(!length || sink.write(data, length)) &&
+				sink.write(footer.data(), footer.size());
+		}
+
+		inline unsigned char paeth(unsigned char a, unsigned char b, unsigned char c)
+		{
+			int p = (int)a + b - c;
+			int pa = abs(p - a);
+			int pb = abs(p - b);
+			int pc = abs(p - c);
+
+			if (pa <= pb && pa <= pc)
+			{
+				return a;
+			}
+
+			return pb <= pc ? b : c;
+		}
+
+		/*
+		Filter the row of length bytes with the PNG filter (None to Paeth) against
+		the previous row, which is zero for the first one. The output begins with
+		the filter type and bpp is the number of bytes of a pixel.
+		*/
+		inline void filter_row(PngFilter filter, const unsigned char *row,
+			const unsigned char *prior, size_t length, size_t bpp, unsigned char *out)
+		{
+			*out++ = (unsigned char)filter;
+
+			switch (filter)
+			{
+			case PNG_FILTER_SUB:
+				memcpy(out, row, bpp);
+				for (size_t i = bpp; i < length; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - row[i - bpp]);
+				}
+				break;
+			case PNG_FILTER_UP:
+				for (size_t i = 0; i != length; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - prior[i]);
+				}
+				break;
+			case PNG_FILTER_AVERAGE:
+				for (size_t i = 0; i != bpp; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - (prior[i] >> 1));
+				}
+				for (size_t i = bpp; i < length; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+				}
+				break;
+			case PNG_FILTER_PAETH:
+				for (size_t i = 0; i != bpp; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - prior[i]);
+				}
+				for (size_t i = bpp; i < length; ++i)
+				{
+					out[i] = (unsigned char)(row[i] - paeth(row[i - bpp], prior[i], prior[i - bpp]));
+				}
+				break;
+			default:
+				memcpy(out, row, length);
+				break;
+			}
+		}
+
+		// Sum of the filtered bytes taken as signed, the filter with
+		// the smallest sum usually compresses best
+		inline unsigned long filter_cost(const unsigned char *filtered, size_t length)
+		{
+			unsigned long sum = 0;
+			for (size_t i = 0; i != length; ++i)
+			{
+				sum += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+			}
+
+			return sum;
+		}
 	}
 
-}
\ No newline at end of file
+	// Write the framebuffer as an uncompressed 24-bit bottom-up BMP
+	inline bool WriteBMP(const Framebuffer& framebuffer, ImageSink& sink)
+	{
+		int width = framebuffer.get_width();
+		int height = framebuffer.get_height();
+		int row_size = (width * 3 + 3) & ~3;
+
+		std::vector<unsigned char> header;
+		header.push_back('B');
+		header.push_back('M');
+		Encoding::put_u32_le(header, 54 + (unsigned long)row_size * height);
+		Encoding::put_u32_le(header, 0);
+		Encoding::put_u32_le(header, 54); // offset of the pixel data
+		Encoding::put_u32_le(header, 40); // size of BITMAPINFOHEADER
+		Encoding::put_u32_le(header, width);
+		Encoding::put_u32_le(header, height);
+		Encoding::put_u16_le(header, 1); // planes
+		Encoding::put_u16_le(header, 24); // bits per pixel
+		Encoding::put_u32_le(header, 0); // no compression
+		Encoding::put_u32_le(header, (unsigned long)row_size * height);
+		Encoding::put_u32_le(header, 2835); // 72 DPI
+		Encoding::put_u32_le(header, 2835);
+		Encoding::put_u32_le(header, 0);
+		Encoding::put_u32_le(header, 0);
+
+		if (!sink.write(header.data(), header.size()))
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> row(row_size, 0);
+		for (int y = height - 1; y >= 0; --y)
+		{
+			const unsigned char *pixel = framebuffer.get_data() + (size_t)y * width * 4;
+			for (int x = 0; x != width; ++x, pixel += 4)
+			{
+				row[x * 3] = pixel[2];
+				row[x * 3 + 1] = pixel[1];
+				row[x * 3 + 2] = pixel[0];
+			}
+
+			if (!sink.write(row.data(), row.size()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Write the framebuffer as a binary PPM
+	inline bool WritePPM(const Framebuffer& framebuffer, ImageSink& sink)
+	{
+		int width = framebuffer.get_width();
+		int height = framebuffer.get_height();
+
+		char header[64];
+		int length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+		if (length < 0 || !sink.write((const unsigned char *)header, length))
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> row(width * 3);
+		for (int y = 0; y != height; ++y)
+		{
+			const unsigned char *pixel = framebuffer.get_data() + (size_t)y * width * 4;
+			for (int x = 0; x != width; ++x, pixel += 4)
+			{
+				memcpy(&row[x * 3], pixel, 3);
+			}
+
+			if (!sink.write(row.data(), row.size()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+	Write the framebuffer as a PNG, RGB if all the pixels are opaque and RGBA
+	otherwise. The rows are filtered and compressed one by one and the compressed
+	data are written in chunks of PNG_CHUNK_SIZE bytes, so the whole image is
+	never held in memory twice.
+	*/
+	inline bool WritePNG(const Framebuffer& framebuffer, ImageSink& sink,
+		const ImageOptions& options = ImageOptions())
+	{
+		int width = framebuffer.get_width();
+		int height = framebuffer.get_height();
+		const unsigned char *data = framebuffer.get_data();
+		size_t pixels = (size_t)width * height;
+
+		bool opaque = true;
+		for (size_t i = 0; i != pixels && opaque; ++i)
+		{
+			opaque = data[i * 4 + 3] == 255;
+		}
+		size_t bpp = opaque ? 3 : 4;
+		size_t row_size = width * bpp;
+
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		if (!sink.write(signature, sizeof(signature)))
+		{
+			return false;
+		}
+
+		// Header chunk -> 8-bit RGB or RGBA, no interlacing
+		std::vector<unsigned char> ihdr;
+		Encoding::put_u32_be(ihdr, width);
+		Encoding::put_u32_be(ihdr, height);
+		ihdr.push_back(8);
+		ihdr.push_back(opaque ? 2 : 6);
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		if (!Encoding::write_png_chunk(sink, "IHDR", ihdr.data(), ihdr.size()))
+		{
+			return false;
+		}
+
+		Encoding::Deflater deflater(options.compression);
+		std::vector<unsigned char>& compressed = deflater.get_output();
+
+		// The current and the previous row, the one before the first is zero
+		std::vector<unsigned char> rows[2] = { std::vector<unsigned char>(row_size, 0),
+			std::vector<unsigned char>(row_size, 0) };
+		std::vector<unsigned char> filtered(row_size + 1), candidate(row_size + 1);
+
+		// Stored data are not smaller for any filter, so the rows of level 0
+		// are not filtered
+		PngFilter filter = options.compression > 0 ? options.filter : PNG_FILTER_NONE;
+
+		for (int y = 0; y != height; ++y)
+		{
+			unsigned char *row = rows[y & 1].data();
+			const unsigned char *prior = rows[(y + 1) & 1].data();
+			const unsigned char *pixel = data + (size_t)y * width * 4;
+			if (opaque)
+			{
+				for (int x = 0; x != width; ++x, pixel += 4)
+				{
+					memcpy(row + x * 3, pixel, 3);
+				}
+			}
+			else
+			{
+				memcpy(row, pixel, row_size);
+			}
+
+			if (filter != PNG_FILTER_ADAPTIVE)
+			{
+				Encoding::filter_row(filter, row, prior, row_size, bpp, filtered.data());
+			}
+			else
+			{
+				unsigned long best = 0;
+				for (int type = PNG_FILTER_NONE; type != PNG_FILTER_ADAPTIVE; ++type)
+				{
+					Encoding::filter_row((PngFilter)type, row, prior, row_size, bpp, candidate.data());
+					unsigned long cost = Encoding::filter_cost(candidate.data() + 1, row_size);
+					if (type == PNG_FILTER_NONE || cost < best)
+					{
+						best = cost;
+						filtered.swap(candidate);
+					}
+				}
+			}
+
+			deflater.write(filtered.data(), filtered.size());
+
+			if (compressed.size() >= PNG_CHUNK_SIZE)
+			{
+				if (!Encoding::write_png_chunk(sink, "IDAT", compressed.data(), compressed.size()))
+				{
+					return false;
+				}
+				compressed.clear();
+			}
+		}
+
+		deflater.finish();
+
+		return Encoding::write_png_chunk(sink, "IDAT", compressed.data(), compressed.size()) &&
+			Encoding::write_png_chunk(sink, "IEND", nullptr, 0);
+	}
+
+	namespace Encoding
+	{
+		// Whether the extension (in lower case) is written by the built-in encoders
+		inline bool is_builtin_format(const std::string& extension)
+		{
+			return extension == "png" || extension == "bmp" || extension == "ppm";
+		}
+
+		inline std::string lower_case(std::string text)
+		{
+			std::transform(text.begin(), text.end(), text.begin(),
+				[](char c) { return (char)tolower((unsigned char)c); });
+
+			return text;
+		}
+	}
+
+	// This function encodes the framebuffer in the format of the extension
+	// (png, bmp or ppm) to the sink
+	inline bool EncodeImage(const Framebuffer& framebuffer, const std::string& extension,
+		ImageSink& sink, const ImageOptions& options = ImageOptions())
+	{
+		CPPLOT_TRACE_SCOPE("EncodeImage");
+
+		std::string format = Encoding::lower_case(extension);
+
+		if (format == "png")
+		{
+			return WritePNG(framebuffer, sink, options);
+		}
+		else if (format == "bmp")
+		{
+			return WriteBMP(framebuffer, sink);
+		}
+		else if (format == "ppm")
+		{
+			return WritePPM(framebuffer, sink);
+		}
+
+		printf("ERROR: Given encoder is not supported. Use png, bmp or ppm.\n");
+		return false;
+	}
+
+	// This function saves the framebuffer to the file in the format of the extension
+	inline bool SaveImage(const Framebuffer& framebuffer, const std::string& file,
+		const std::string& extension, const ImageOptions& options = ImageOptions())
+	{
+		std::string format = Encoding::lower_case(extension);
+
+		if (!Encoding::is_builtin_format(format))
+		{
+#ifdef _WIN32
+			// Other formats are encoded by GDI+
+			std::wstring wide_file(file.size() + 1, L'\0');
+			std::wstring wide_ext(format.size() + 1, L'\0');
+			MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1, &wide_file[0],
+				(int)wide_file.size());
+			MultiByteToWideChar(CP_UTF8, 0, format.c_str(), -1, &wide_ext[0],
+				(int)wide_ext.size());
+
+			CPPLOT_TRACE_SCOPE("CreateImage");
+			return CreateImage(framebuffer, wide_file.c_str(), wide_ext.c_str());
+#else
+			printf("ERROR: Given encoder is not supported. Use png, bmp or ppm.\n");
+			return false;
+#endif
+		}
+
+		FILE *stream = Encoding::open_file(file);
+		if (!stream)
+		{
+			printf("ERROR: File %s could not be opened for writing.\n", file.c_str());
+			return false;
+		}
+
+		FileSink sink(stream);
+		bool success = EncodeImage(framebuffer, format, sink, options);
+		success = (fclose(stream) == 0) && success;
+
+		if (!success)
+		{
+			printf("ERROR: An image could not be written to %s.\n", file.c_str());
+		}
+
+		return success;
+	}
+}
@@ -0,0 +1,545 @@
+#pragma once
+#include "Header.h"
+#include "Trace.h"
+
+#include <tuple>
+#include <unordered_map>
+
+namespace cpplot
+{
+	// Font parameters needed for the layout of the graph attributes
+	struct TextMetric
+	{
+		int height; // height of a line of text
+		int ave_char_width; // average width of a character
+	};
+
+	// Numbers of drawing objects (pens, brushes and fonts) created and reused
+	// during a frame
+	struct ResourceStats
+	{
+		size_t created;
+		size_t reused;
+	};
+
+	/*
+	Class interface of a drawing surface. All the drawing code (Figure, Window,
+	Graph, Axis and RenderObjects) paints through this interface, so the same
+	figure can be rendered either to a window (CanvasGDI) or to an in-memory
+	framebuffer (CanvasMemory). The semantics of the individual calls follow
+	their GDI counterparts (e.g. rectangle is outlined with the current pen
+	and filled with the current brush and line_to does not paint the last pixel).
+	*/
+	class Canvas
+	{
+	public:
+		virtual void select_pen(COLORREF color, int width) = 0;
+
+		virtual void select_brush(COLORREF color) = 0;
+
+		// Select the default font of the canvas rotated by escapement
+		// (in tenths of degrees) and possibly in bold
+		virtual void select_font(int escapement, bool bold) = 0;
+
+		// Set the text alignment (TA_* flags) and return the previous one
+		virtual UINT set_text_align(UINT align) = 0;
+
+		virtual TextMetric get_text_metrics() = 0;
+
+		virtual void move_to(int x, int y) = 0;
+
+		virtual void line_to(int x, int y) = 0;
+
+		virtual void polyline(const POINT *points, int count) = 0;
+
+		// Paint polylines consecutive in points, counts holds their numbers of points
+		virtual void polypolyline(const POINT *points, const DWORD *counts, 
+			int polylines) = 0;
+
+		virtual void rectangle(int left, int top, int right, int bottom) = 0;
+
+		// Paint a batch of rectangles, which do not overlap or are painted 
+		// with the pen and the brush of the same color
+		virtual void rectangles(const RECT *rects, int count) = 0;
+
+		virtual void ellipse(int left, int top, int right, int bottom) = 0;
+
+		// Paint a batch of ellipses bounded by the rectangles
+		virtual void ellipses(const RECT *rects, int count)
+		{
+			for (int i = 0; i != count; ++i)
+			{
+				this->ellipse(rects[i].left, rects[i].top, rects[i].right, rects[i].bottom);
+			}
+		}
+
+		// Render UTF-8 encoded text of length bytes
+		virtual void text_out(int x, int y, const char *text, int length) = 0;
+
+		// Copy top-down RGBA pixels to the rectangle at left and top, 
+		// pixels with zero alpha are left unchanged
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba) = 0;
+
+		// Paint only inside [left, right) x [top, bottom) of the clip rectangle, 
+		// nullptr paints everywhere again
+		virtual void set_clip(const RECT *clip) = 0;
+
+		virtual ~Canvas() = default;
+	};
+
+#ifdef _WIN32
+	/*
+	Cache of the GDI drawing objects keyed by their style, so that the objects
+	are created once and reused by all the following paints. The objects are 
+	deleted with the cache, which must outlive the canvases using it.
+	*/
+	class GDICache
+	{
+	public:
+		GDICache() : stats{ 0, 0 } {};
+
+		GDICache(const GDICache& cache) = delete;
+
+		GDICache& operator=(const GDICache& cache) = delete;
+
+		HPEN pen(COLORREF color, int width, int style = PS_SOLID);
+
+		HBRUSH brush(COLORREF color);
+
+		// Font derived from base, rotated by escapement and possibly in bold
+		HFONT font(HFONT base, int escapement, bool bold);
+
+		// UTF-16 text of the UTF-8 text of length bytes, converted once per string,
+		// valid until the next call
+		const std::wstring& text(const char *text, int length);
+
+		// Reset the statistics at the start of a frame
+		void begin_frame() { stats = ResourceStats{ 0, 0 }; }
+
+		ResourceStats get_stats() const { return stats; }
+
+		~GDICache();
+
+	private:
+		std::map<std::tuple<COLORREF, int, int>, HPEN> pens;
+		std::map<COLORREF, HBRUSH> brushes;
+		std::map<std::tuple<HFONT, int, bool>, HFONT> fonts;
+		std::unordered_map<std::string, std::wstring> texts; // at most TEXT_RUN_CACHE_LIMIT
+		std::string text_key; // kept to reuse its storage
+		ResourceStats stats; // statistics of the current frame
+	};
+
+	inline HPEN GDICache::pen(COLORREF color, int width, int style)
+	{
+		HPEN& cached = pens[std::make_tuple(color, width, style)];
+		if (cached)
+		{
+			++stats.reused;
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			return cached;
+		}
+
+		++stats.created;
+		CPPLOT_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+		cached = CreatePen(style, width, color);
+
+		return cached;
+	}
+
+	inline HBRUSH GDICache::brush(COLORREF color)
+	{
+		HBRUSH& cached = brushes[color];
+		if (cached)
+		{
+			++stats.reused;
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			return cached;
+		}
+
+		++stats.created;
+		CPPLOT_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+		cached = CreateSolidBrush(color);
+
+		return cached;
+	}
+
+	inline HFONT GDICache::font(HFONT base, int escapement, bool bold)
+	{
+		HFONT& cached = fonts[std::make_tuple(base, escapement, bold)];
+		if (cached)
+		{
+			++stats.reused;
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			return cached;
+		}
+
+		++stats.created;
+		CPPLOT_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+		LOGFONT lf;
+		GetObject(base, sizeof(LOGFONT), &lf);
+		lf.lfEscapement = escapement;
+		if (bold)
+		{
+			lf.lfWeight = FW_BOLD;
+		}
+		cached = CreateFontIndirect(&lf);
+
+		return cached;
+	}
+
+	inline const std::wstring& GDICache::text(const char *text, int length)
+	{
+		text_key.assign(text, length);
+		std::unordered_map<std::string, std::wstring>::const_iterator found = texts.find(text_key);
+		if (found != texts.end())
+		{
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			return found->second;
+		}
+
+		if (texts.size() >= TEXT_RUN_CACHE_LIMIT)
+		{
+			texts.clear();
+		}
+
+		// UTF-16 text is never longer than the UTF-8 one
+		std::wstring& wide = texts[text_key];
+		wide.resize(length + 1);
+		int wlength = MultiByteToWideChar(CP_UTF8, 0, text, length, &wide[0], length + 1);
+		wide.resize(wlength > 0 ? wlength : 0);
+
+		return wide;
+	}
+
+	inline GDICache::~GDICache()
+	{
+		for (auto it = pens.begin(); it != pens.end(); ++it)
+		{
+			DeleteObject(it->second);
+		}
+
+		for (auto it = brushes.begin(); it != brushes.end(); ++it)
+		{
+			DeleteObject(it->second);
+		}
+
+		for (auto it = fonts.begin(); it != fonts.end(); ++it)
+		{
+			DeleteObject(it->second);
+		}
+	}
+
+	// Canvas painting to a device context of a window
+	class CanvasGDI : public Canvas
+	{
+	public:
+		// Drawing objects are taken from the cache, or from a cache
+		// of the canvas if it is nullptr
+		CanvasGDI(HDC in_hdc, HFONT in_font, GDICache *in_cache = nullptr);
+
+		CanvasGDI(const CanvasGDI& canvas) = delete;
+
+		CanvasGDI& operator=(const CanvasGDI& canvas) = delete;
+
+		virtual void select_pen(COLORREF color, int width);
+
+		virtual void select_brush(COLORREF color);
+
+		virtual void select_font(int escapement, bool bold);
+
+		virtual UINT set_text_align(UINT align);
+
+		virtual TextMetric get_text_metrics();
+
+		virtual void move_to(int x, int y);
+
+		virtual void line_to(int x, int y);
+
+		virtual void polyline(const POINT *points, int count);
+
+		virtual void polypolyline(const POINT *points, const DWORD *counts, 
+			int polylines);
+
+		virtual void rectangle(int left, int top, int right, int bottom);
+
+		virtual void rectangles(const RECT *rects, int count);
+
+		virtual void ellipse(int left, int top, int right, int bottom);
+
+		virtual void text_out(int x, int y, const char *text, int length);
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba);
+
+		virtual void set_clip(const RECT *clip);
+
+		virtual ~CanvasGDI();
+
+	private:
+		HDC hdc;
+		HFONT font; // default font, owned by the caller
+		std::unique_ptr<GDICache> own_cache; // used if no cache is given
+		GDICache *cache; // cache of the pens, brushes and derived fonts
+
+		// Objects selected in the device context before the canvas was created
+		HGDIOBJ prev_pen, prev_brush, prev_font;
+		bool clipped; // whether the canvas set a clipping region
+
+		// Buffers of the batched rectangles, kept between the calls
+		std::vector<POINT> rect_points;
+		std::vector<INT> rect_counts;
+	};
+
+	inline CanvasGDI::CanvasGDI(HDC in_hdc, HFONT in_font, GDICache *in_cache) : 
+		hdc(in_hdc), font(in_font), cache(in_cache), clipped(false)
+	{
+		if (!cache)
+		{
+			own_cache.reset(new GDICache());
+			cache = own_cache.get();
+		}
+
+		prev_pen = GetCurrentObject(hdc, OBJ_PEN);
+		prev_brush = GetCurrentObject(hdc, OBJ_BRUSH);
+		prev_font = SelectObject(hdc, font);
+	}
+
+	inline void CanvasGDI::select_pen(COLORREF color, int width)
+	{
+		SelectObject(hdc, cache->pen(color, width));
+	}
+
+	inline void CanvasGDI::select_brush(COLORREF color)
+	{
+		SelectObject(hdc, cache->brush(color));
+	}
+
+	inline void CanvasGDI::select_font(int escapement, bool bold)
+	{
+		if (escapement == 0 && !bold)
+		{
+			SelectObject(hdc, font);
+			return;
+		}
+
+		SelectObject(hdc, cache->font(font, escapement, bold));
+	}
+
+	inline UINT CanvasGDI::set_text_align(UINT align)
+	{
+		return SetTextAlign(hdc, align);
+	}
+
+	inline TextMetric CanvasGDI::get_text_metrics()
+	{
+		TEXTMETRIC textMetric;
+		GetTextMetrics(hdc, &textMetric);
+
+		return TextMetric{ textMetric.tmHeight, textMetric.tmAveCharWidth };
+	}
+
+	inline void CanvasGDI::move_to(int x, int y)
+	{
+		MoveToEx(hdc, x, y, NULL);
+	}
+
+	inline void CanvasGDI::line_to(int x, int y)
+	{
+		LineTo(hdc, x, y);
+	}
+
+	inline void CanvasGDI::polyline(const POINT *points, int count)
+	{
+		Polyline(hdc, points, count);
+	}
+
+	inline void CanvasGDI::polypolyline(const POINT *points, const DWORD *counts,
+		int polylines)
+	{
+		PolyPolyline(hdc, points, counts, polylines);
+	}
+
+	inline void CanvasGDI::rectangle(int left, int top, int right, int bottom)
+	{
+		Rectangle(hdc, left, top, right, bottom);
+	}
+
+	inline void CanvasGDI::rectangles(const RECT *rects, int count)
+	{
+		// The rectangles are submitted as polygons of a single call, 
+		// outlined along the last pixels inside as by Rectangle
+		rect_points.resize(4 * (size_t)count);
+		rect_counts.assign(count, 4);
+		for (int i = 0; i != count; ++i)
+		{
+			LONG left = rects[i].left < rects[i].right ? rects[i].left : rects[i].right;
+			LONG right = rects[i].left < rects[i].right ? rects[i].right : rects[i].left;
+			LONG top = rects[i].top < rects[i].bottom ? rects[i].top : rects[i].bottom;
+			LONG bottom = rects[i].top < rects[i].bottom ? rects[i].bottom : rects[i].top;
+
+			POINT *corners = &rect_points[4 * (size_t)i];
+			corners[0] = POINT{ left, top };
+			corners[1] = POINT{ right - 1, top };
+			corners[2] = POINT{ right - 1, bottom - 1 };
+			corners[3] = POINT{ left, bottom - 1 };
+		}
+
+		// Overlapping polygons are filled as well
+		int prev_mode = SetPolyFillMode(hdc, WINDING);
+		PolyPolygon(hdc, rect_points.data(), rect_counts.data(), count);
+		SetPolyFillMode(hdc, prev_mode);
+	}
+
+	inline void CanvasGDI::ellipse(int left, int top, int right, int bottom)
+	{
+		Ellipse(hdc, left, top, right, bottom);
+	}
+
+	inline void CanvasGDI::text_out(int x, int y, const char *text, int length)
+	{
+		// GDI keeps the rasterised glyphs of the cached fonts,
+		// the texts are converted once
+		const std::wstring& wide = cache->text(text, length);
+
+		TextOut(hdc, x, y, wide.c_str(), (int)wide.size());
+	}
+
+	inline void CanvasGDI::image(int left, int top, int width, int height,
+		const unsigned char *rgba)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			return;
+		}
+
+		// Top-down 32-bit DIB section holding the current content of the rectangle
+		BITMAPINFO info;
+		ZeroMemory(&info, sizeof(BITMAPINFO));
+		info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		info.bmiHeader.biWidth = width;
+		info.bmiHeader.biHeight = -height;
+		info.bmiHeader.biPlanes = 1;
+		info.bmiHeader.biBitCount = 32;
+		info.bmiHeader.biCompression = BI_RGB;
+
+		void *bits = NULL;
+		HDC memdc = CreateCompatibleDC(hdc);
+		HBITMAP hbitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+		HGDIOBJ oldbmp = SelectObject(memdc, hbitmap);
+		BitBlt(memdc, 0, 0, width, height, hdc, left, top, SRCCOPY);
+		GdiFlush();
+
+		// Compose the visible pixels, the DIB is in the BGRA order
+		unsigned char *pixel = (unsigned char*)bits;
+		size_t size = (size_t)width * height;
+		for (size_t i = 0; i != size; ++i, pixel += 4, rgba += 4)
+		{
+			if (rgba[3])
+			{
+				pixel[0] = rgba[2];
+				pixel[1] = rgba[1];
+				pixel[2] = rgba[0];
+			}
+		}
+
+		BitBlt(hdc, left, top, width, height, memdc, 0, 0, SRCCOPY);
+
+		// Clean the objects
+		SelectObject(memdc, oldbmp);
+		DeleteObject(hbitmap);
+		DeleteDC(memdc);
+	}
+
+	inline void CanvasGDI::set_clip(const RECT *clip)
+	{
+		if (!clip)
+		{
+			SelectClipRgn(hdc, NULL);
+			clipped = false;
+
+			return;
+		}
+
+		// The region is copied by the device context
+		HRGN region = CreateRectRgn(clip->left, clip->top, clip->right, clip->bottom);
+		SelectClipRgn(hdc, region);
+		DeleteObject(region);
+		clipped = true;
+	}
+
+	inline CanvasGDI::~CanvasGDI()
+	{
+		// Set previous graphic properties, the objects are deleted by the cache
+		SelectObject(hdc, prev_pen);
+		SelectObject(hdc, prev_brush);
+		SelectObject(hdc, prev_font);
+
+		if (clipped)
+		{
+			SelectClipRgn(hdc, NULL);
+		}
+	}
+
+	// Off-screen bitmap with a memory device context for drawing to it
+	class SurfaceGDI
+	{
+	public:
+		SurfaceGDI() : hdc(NULL), bitmap(NULL), prev_bitmap(NULL), width(0), height(0) {};
+
+		SurfaceGDI(const SurfaceGDI& surface) = delete;
+
+		SurfaceGDI& operator=(const SurfaceGDI& surface) = delete;
+
+		// Make the surface compatible with the reference and of the given size,
+		// return whether it was created again and its contents are lost
+		bool resize(HDC reference, int in_width, int in_height);
+
+		HDC get_dc() const { return hdc; }
+
+		~SurfaceGDI() { this->release(); };
+
+	private:
+		void release();
+
+		HDC hdc; // memory device context with the bitmap selected
+		HBITMAP bitmap;
+		HGDIOBJ prev_bitmap; // bitmap of the device context when it was created
+		int width, height;
+	};
+
+	inline bool SurfaceGDI::resize(HDC reference, int in_width, int in_height)
+	{
+		if (hdc && width == in_width && height == in_height)
+		{
+			return false;
+		}
+
+		this->release();
+
+		hdc = CreateCompatibleDC(reference);
+		bitmap = CreateCompatibleBitmap(reference, in_width, in_height);
+		prev_bitmap = SelectObject(hdc, bitmap);
+		width = in_width;
+		height = in_height;
+
+		return true;
+	}
+
+	inline void SurfaceGDI::release()
+	{
+		if (!hdc)
+		{
+			return;
+		}
+
+		SelectObject(hdc, prev_bitmap);
+		DeleteObject(bitmap);
+		DeleteDC(hdc);
+
+		hdc = NULL;
+		bitmap = NULL;
+		width = height = 0;
+	}
+#endif
+}
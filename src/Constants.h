@@ -109,12 +109,135 @@
 #define SCIENTIFIC_FRAC_DIGITS 2
 #endif
 
+// Maximal number of significant digits of the tick labels, the values of
+// a range needing more of them, e.g. of a zoomed view of 1e9 to 1e9 + 0.01,
+// are labelled from an add-on shown with the label of the axis
+#ifndef MAX_TICK_DIGITS
+#define MAX_TICK_DIGITS 6
+#endif
+
+// Maximal length of the label of a tick, with the terminating zero
+#ifndef TICK_LABEL_LENGTH
+#define TICK_LABEL_LENGTH 32
+#endif
+
 // Maximal size of extension for saving
 #ifndef MAX_EXTENSION_SIZE
 #define MAX_EXTENSION_SIZE 10
 #endif
 
-// Size of the x data of fplot routine
+// Default compression level of the built-in PNG encoder, 0 (stored) to 9 (smallest)
+#ifndef PNG_COMPRESSION_LEVEL
+#define PNG_COMPRESSION_LEVEL 6
+#endif
+
+// Compressed bytes collected before they are written as one PNG data chunk
+#ifndef PNG_CHUNK_SIZE
+#define PNG_CHUNK_SIZE 65536
+#endif
+
+// Bytes of a vector document (svg or pdf) collected before they are written
+#ifndef VECTOR_BUFFER_SIZE
+#define VECTOR_BUFFER_SIZE 65536
+#endif
+
+// Number of values summarized by an entry of the finest level of the min/max
+// pyramid of a line, also the granularity at which index builds are cancelled
+#ifndef LOD_BLOCK
+#define LOD_BLOCK 256
+#endif
+
+// Number of tiles along each axis of the spatial index of a scatterplot
+#ifndef LOD_TILES
+#define LOD_TILES 64
+#endif
+
+// Minimal number of points of a line or a scatterplot for which the index
+// of its viewports is built in the background, 0 disables the indices
+#ifndef LOD_MIN_LENGTH
+#define LOD_MIN_LENGTH (1 << 20)
+#endif
+
+// Factor of the zoom by one notch of the mouse wheel
+#ifndef ZOOM_STEP
+#define ZOOM_STEP 1.25
+#endif
+
+// Width in pixels of the band around a graph, at which the lines leaving it
+// are cut, so that the pixels of the points of zoomed views stay within int
+#ifndef PIXEL_GUARD_BAND
+#define PIXEL_GUARD_BAND 4096
+#endif
+
+// Minimal width and height in pixels of a box selected to zoom to
+#ifndef SELECTION_MIN_SIZE
+#define SELECTION_MIN_SIZE 4
+#endif
+
+// Duration of a frame in milliseconds, the overlay marks longer paints
+#ifndef FRAME_BUDGET_MS
+#define FRAME_BUDGET_MS 16.0
+#endif
+
+// Space in pixels around the text of the overlay of the paint statistics
+#ifndef OVERLAY_MARGIN
+#define OVERLAY_MARGIN 4
+#endif
+
+// Maximal number of evaluations of the function by fplot
 #ifndef FPLOT_LENGTH
 #define FPLOT_LENGTH 1000
-#endif
\ No newline at end of file
+#endif
+
+// Number of equal intervals the adaptive sampling of fplot starts from
+#ifndef FPLOT_INITIAL
+#define FPLOT_INITIAL 128
+#endif
+
+// Error in pixels up to which the adaptive sampling of fplot does not refine
+#ifndef FPLOT_TOLERANCE
+#define FPLOT_TOLERANCE 0.25
+#endif
+
+// Interval in milliseconds of repainting the windows with appended data
+#ifndef UPDATE_INTERVAL
+#define UPDATE_INTERVAL 30
+#endif
+
+// Scale of the built-in bitmap font used when rendering to memory
+#ifndef FONT_SCALE
+#define FONT_SCALE 2
+#endif
+
+// Maximal number of the texts whose composed glyphs are kept for drawing them again
+#ifndef TEXT_RUN_CACHE_LIMIT
+#define TEXT_RUN_CACHE_LIMIT 4096
+#endif
+
+// Number of points above which a Scatter without an explicit RenderObjects
+// is rendered as a density image (RenderScatterDensity), 0 disables the switch
+#ifndef DENSITY_SCATTER_THRESHOLD
+#define DENSITY_SCATTER_THRESHOLD 0
+#endif
+
+// Minimal number of elements processed by a single thread of parallel algorithms
+#ifndef PARALLEL_MIN_LENGTH
+#define PARALLEL_MIN_LENGTH 65536
+#endif
+
+// Maximal number of events kept by the trace of a figure (see CPPLOT_TRACE)
+#ifndef TRACE_EVENT_LIMIT
+#define TRACE_EVENT_LIMIT (1 << 20)
+#endif
+
+// Maximal size in bytes of the retained drawing of a window, larger
+// drawings are painted again on every repaint, 0 disables the retention
+#ifndef DISPLAY_LIST_LIMIT
+#define DISPLAY_LIST_LIMIT (64 << 20)
+#endif
+
+// Width of the border around a window painted in parallel, to which it may
+// draw without being painted again serially
+#ifndef PARALLEL_PAINT_MARGIN
+#define PARALLEL_PAINT_MARGIN 16
+#endif
@@ -0,0 +1,253 @@
+#pragma once
+#include "Header.h"
+
+namespace cpplot
+{
+	/*
+	Non-owning view of a series of numbers: a pointer, a length and a stride
+	in bytes, with elements of type double, float, int64_t, int32_t, int16_t
+	or uint16_t. The caller
+	guarantees the data outlive the plot, or passes a shared owner, which
+	is kept alive by the view and all its copies. A sequence view holds
+	no data and its values are first, first + 1, ...
+	*/
+	class DataView
+	{
+	public:
+		enum Type { FLOAT64, FLOAT32, INT64, INT32, INT16, UINT16, SEQUENCE };
+
+		DataView() : data(nullptr), length(0), stride(0), type(FLOAT64), first(0.0) {};
+
+		DataView(const double *in_data, size_t in_length, size_t in_stride = sizeof(double),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		DataView(const float *in_data, size_t in_length, size_t in_stride = sizeof(float),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		DataView(const int64_t *in_data, size_t in_length, size_t in_stride = sizeof(int64_t),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		DataView(const int32_t *in_data, size_t in_length, size_t in_stride = sizeof(int32_t),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		DataView(const int16_t *in_data, size_t in_length, size_t in_stride = sizeof(int16_t),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		DataView(const uint16_t *in_data, size_t in_length, size_t in_stride = sizeof(uint16_t),
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		// View of raw bytes holding values of the type, e.g. read from a file
+		DataView(const void *in_data, Type in_type, size_t in_length, size_t in_stride,
+			std::shared_ptr<const void> in_owner = nullptr);
+
+		// View of a vector, which must outlive the view
+		explicit DataView(const std::vector<double>& in_data);
+
+		// View sharing the ownership of the vector
+		explicit DataView(std::shared_ptr<const std::vector<double>> in_data);
+
+		static DataView sequence(size_t in_length, double in_first);
+
+		// Size of an element of the type in bytes, 0 for a sequence
+		static size_t element_size(Type in_type);
+
+		double operator[](size_t i) const;
+
+		size_t size() const { return length; }
+
+		bool empty() const { return length == 0; }
+
+		// Pointer to the values if they are contiguous doubles, nullptr otherwise
+		const double* contiguous() const;
+
+		// Convert count values starting at begin to doubles
+		void read(size_t begin, size_t count, double *out) const;
+
+		// View of at most count values starting at begin
+		DataView slice(size_t begin, size_t count) const;
+
+	private:
+		const unsigned char *data;
+		size_t length, stride;
+		Type type;
+		double first; // first value of a sequence
+		std::shared_ptr<const void> owner;
+	};
+
+	inline DataView::DataView(const double *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(FLOAT64), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const float *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(FLOAT32), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const int64_t *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(INT64), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const int32_t *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(INT32), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const int16_t *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(INT16), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const uint16_t *in_data, size_t in_length, size_t in_stride,
+		std::shared_ptr<const void> in_owner) : data((const unsigned char*)in_data),
+		length(in_length), stride(in_stride), type(UINT16), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const void *in_data, Type in_type, size_t in_length,
+		size_t in_stride, std::shared_ptr<const void> in_owner) :
+		data((const unsigned char*)in_data), length(in_length), stride(in_stride),
+		type(in_type), first(0.0), owner(in_owner) {}
+
+	inline DataView::DataView(const std::vector<double>& in_data) :
+		DataView(in_data.data(), in_data.size()) {}
+
+	inline DataView::DataView(std::shared_ptr<const std::vector<double>> in_data) :
+		DataView(in_data->data(), in_data->size(), sizeof(double), in_data) {}
+
+	inline DataView DataView::sequence(size_t in_length, double in_first)
+	{
+		DataView view;
+		view.length = in_length;
+		view.type = SEQUENCE;
+		view.first = in_first;
+
+		return view;
+	}
+
+	inline size_t DataView::element_size(Type in_type)
+	{
+		switch (in_type)
+		{
+		case FLOAT32: return sizeof(float);
+		case INT64: return sizeof(int64_t);
+		case INT32: return sizeof(int32_t);
+		case INT16: return sizeof(int16_t);
+		case UINT16: return sizeof(uint16_t);
+		case SEQUENCE: return 0;
+		default: return sizeof(double);
+		}
+	}
+
+	inline double DataView::operator[](size_t i) const
+	{
+		// Elements are copied, as the stride does not need to keep their alignment
+		const unsigned char *element = data + i * stride;
+		switch (type)
+		{
+		case FLOAT32:
+		{
+			float value;
+			memcpy(&value, element, sizeof(float));
+			return value;
+		}
+		case INT64:
+		{
+			int64_t value;
+			memcpy(&value, element, sizeof(int64_t));
+			return (double)value;
+		}
+		case INT32:
+		{
+			int32_t value;
+			memcpy(&value, element, sizeof(int32_t));
+			return value;
+		}
+		case INT16:
+		{
+			int16_t value;
+			memcpy(&value, element, sizeof(int16_t));
+			return value;
+		}
+		case UINT16:
+		{
+			uint16_t value;
+			memcpy(&value, element, sizeof(uint16_t));
+			return value;
+		}
+		case SEQUENCE:
+		{
+			return first + (double)i;
+		}
+		default:
+		{
+			double value;
+			memcpy(&value, element, sizeof(double));
+			return value;
+		}
+		}
+	}
+
+	inline const double* DataView::contiguous() const
+	{
+		if (type == FLOAT64 && stride == sizeof(double) &&
+			(size_t)data % alignof(double) == 0)
+		{
+			return (const double*)data;
+		}
+
+		return nullptr;
+	}
+
+	inline DataView DataView::slice(size_t begin, size_t count) const
+	{
+		DataView view = *this;
+		begin = begin < length ? begin : length;
+		view.length = length - begin < count ? length - begin : count;
+
+		if (type == SEQUENCE)
+		{
+			view.first += (double)begin;
+		}
+		else
+		{
+			view.data += begin * stride;
+		}
+
+		return view;
+	}
+
+	inline void DataView::read(size_t begin, size_t count, double *out) const
+	{
+		const double *values = this->contiguous();
+		if (values && count)
+		{
+			memcpy(out, values + begin, count * sizeof(double));
+			return;
+		}
+
+		for (size_t i = 0; i != count; ++i)
+		{
+			out[i] = (*this)[begin + i];
+		}
+	}
+
+	// Find the minimum and maximum of the values, infinities for an empty view
+	inline void minmax(const DataView& data, double& min, double& max)
+	{
+		min = INFINITY;
+		max = -INFINITY;
+
+		const double *values = data.contiguous();
+		if (values && !data.empty())
+		{
+			std::pair<const double*, const double*> min_max = 
+				std::minmax_element(values, values + data.size());
+			min = *min_max.first;
+			max = *min_max.second;
+
+			return;
+		}
+
+		for (size_t i = 0; i != data.size(); ++i)
+		{
+			double value = data[i];
+			min = value < min ? value : min;
+			max = value > max ? value : max;
+		}
+	}
+}
@@ -0,0 +1,715 @@
+#pragma once
+#include "Header.h"
+
+#include <functional>
+#include <queue>
+
+namespace cpplot
+{
+	namespace Encoding
+	{
+		// Codes of the lengths and distances of the deflate matches and the fixed Huffman code
+		struct DeflateTables
+		{
+			DeflateTables();
+
+			unsigned short length_base[29];
+			unsigned char length_extra[29];
+			unsigned short dist_base[30];
+			unsigned char dist_extra[30];
+
+			// Code (minus 257) of the match lengths 3 to 258
+			unsigned char length_code[259];
+
+			// Code of the distance d is dist_code[d - 1] for d <= 256,
+			// dist_code[256 + ((d - 1) >> 7)] otherwise
+			unsigned char dist_code[512];
+
+			unsigned char fixed_litlen_lengths[288];
+			unsigned char fixed_dist_lengths[30];
+			unsigned short fixed_litlen_codes[288];
+			unsigned short fixed_dist_codes[30];
+		};
+
+		// Lengths of the Huffman code of the frequencies limited to max_length bits,
+		// at least two symbols get a code, so that the code is complete
+		inline void huffman_lengths(const unsigned long *freqs, int count, int max_length,
+			unsigned char *lengths)
+		{
+			std::vector<int> used;
+			for (int i = 0; i != count; ++i)
+			{
+				lengths[i] = 0;
+				if (freqs[i])
+				{
+					used.push_back(i);
+				}
+			}
+
+			// A single code would be incomplete, so a second one is added
+			if (used.size() < 2)
+			{
+				int first = used.empty() ? 0 : used[0];
+				lengths[first] = 1;
+				lengths[first ? 0 : 1] = 1;
+
+				return;
+			}
+
+			// Build the tree by joining the two least frequent nodes
+			size_t leaves = used.size();
+			std::vector<unsigned long long> weight(2 * leaves - 1);
+			std::vector<int> parent(2 * leaves - 1, -1);
+			typedef std::pair<unsigned long long, int> Node;
+			std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+			for (size_t i = 0; i != leaves; ++i)
+			{
+				weight[i] = freqs[used[i]];
+				queue.push(Node(weight[i], (int)i));
+			}
+
+			for (size_t next = leaves; queue.size() > 1; ++next)
+			{
+				Node a = queue.top();
+				queue.pop();
+				Node b = queue.top();
+				queue.pop();
+
+				weight[next] = a.first + b.first;
+				parent[a.second] = parent[b.second] = (int)next;
+				queue.push(Node(weight[next], (int)next));
+			}
+
+			// Numbers of the leaves of every depth, the deepest are moved up
+			// while the code stays complete
+			std::vector<int> depth(2 * leaves - 1, 0);
+			std::vector<int> depth_count(max_length + 1, 0);
+			for (int i = (int)(2 * leaves - 3); i >= 0; --i)
+			{
+				depth[i] = depth[parent[i]] + 1;
+			}
+			for (size_t i = 0; i != leaves; ++i)
+			{
+				++depth_count[depth[i] < max_length ? depth[i] : max_length];
+			}
+
+			unsigned long total = 0;
+			for (int i = 1; i <= max_length; ++i)
+			{
+				total += (unsigned long)depth_count[i] << (max_length - i);
+			}
+
+			while (total > (1UL << max_length))
+			{
+				--depth_count[max_length];
+				for (int i = max_length - 1; i > 0; --i)
+				{
+					if (depth_count[i])
+					{
+						--depth_count[i];
+						depth_count[i + 1] += 2;
+						break;
+					}
+				}
+				--total;
+			}
+
+			// The most frequent symbols get the shortest codes
+			std::stable_sort(used.begin(), used.end(), [freqs](int a, int b)
+			{
+				return freqs[a] > freqs[b];
+			});
+
+			size_t symbol = 0;
+			for (int length = 1; length <= max_length; ++length)
+			{
+				for (int i = 0; i != depth_count[length]; ++i)
+				{
+					lengths[used[symbol++]] = (unsigned char)length;
+				}
+			}
+		}
+
+		// Canonical Huffman codes of the lengths, bit-reversed as deflate writes them
+		inline void huffman_codes(const unsigned char *lengths, int count, unsigned short *codes)
+		{
+			int length_count[16] = { 0 };
+			for (int i = 0; i != count; ++i)
+			{
+				++length_count[lengths[i]];
+			}
+			length_count[0] = 0;
+
+			int next_code[16] = { 0 };
+			for (int length = 1, code = 0; length != 16; ++length)
+			{
+				code = (code + length_count[length - 1]) << 1;
+				next_code[length] = code;
+			}
+
+			for (int i = 0; i != count; ++i)
+			{
+				int length = lengths[i];
+				int code = length ? next_code[length]++ : 0;
+
+				int reversed = 0;
+				for (int bit = 0; bit != length; ++bit)
+				{
+					reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+				}
+				codes[i] = (unsigned short)reversed;
+			}
+		}
+
+		inline DeflateTables::DeflateTables()
+		{
+			for (int code = 0, base = 3; code != 28; ++code)
+			{
+				length_extra[code] = (unsigned char)(code < 8 ? 0 : (code - 4) / 4);
+				length_base[code] = (unsigned short)base;
+				for (int i = 0; i != (1 << length_extra[code]); ++i)
+				{
+					length_code[base + i] = (unsigned char)code;
+				}
+				base += 1 << length_extra[code];
+			}
+			length_extra[28] = 0;
+			length_base[28] = 258;
+			length_code[258] = 28;
+			length_code[0] = length_code[1] = length_code[2] = 0;
+
+			for (int code = 0, base = 1; code != 30; ++code)
+			{
+				dist_extra[code] = (unsigned char)(code < 4 ? 0 : (code - 2) / 2);
+				dist_base[code] = (unsigned short)base;
+				for (int i = 0; i != (1 << dist_extra[code]); ++i)
+				{
+					int distance = base + i;
+					if (distance <= 256)
+					{
+						dist_code[distance - 1] = (unsigned char)code;
+					}
+					else
+					{
+						dist_code[256 + ((distance - 1) >> 7)] = (unsigned char)code;
+					}
+				}
+				base += 1 << dist_extra[code];
+			}
+
+			for (int i = 0; i != 288; ++i)
+			{
+				fixed_litlen_lengths[i] = i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8));
+			}
+			for (int i = 0; i != 30; ++i)
+			{
+				fixed_dist_lengths[i] = 5;
+			}
+			huffman_codes(fixed_litlen_lengths, 288, fixed_litlen_codes);
+			huffman_codes(fixed_dist_lengths, 30, fixed_dist_codes);
+		}
+
+		inline const DeflateTables& deflate_tables()
+		{
+			// The tables are initialized once even if images are written on several threads
+			static const DeflateTables tables;
+
+			return tables;
+		}
+
+		/*
+		Compressor of a zlib stream (RFC 1950 and 1951). The input is given piece
+		by piece and compressed in blocks by LZ77 matching with hash chains, which
+		are searched longer with a higher level. Every block is written with the
+		smallest of its own Huffman code, the fixed code and no compression. Level
+		0 only stores the data. The compressed bytes are collected in the output,
+		from which the caller takes them while writing.
+		*/
+		class Deflater
+		{
+		public:
+			Deflater(int in_level);
+
+			void write(const unsigned char *data, size_t length);
+
+			// Compress the rest of the input and end the stream
+			void finish();
+
+			// Compressed bytes, the caller clears them once they are written
+			std::vector<unsigned char>& get_output() { return output; }
+
+		private:
+			enum
+			{
+				window = 32768, // maximal distance of a match
+				block = 65536, // input compressed in one block
+				min_match = 3,
+				max_match = 258,
+				hash_bits = 15
+			};
+
+			struct Symbol
+			{
+				unsigned short length; // byte of a literal or length of a match
+				unsigned short distance; // 0 for a literal
+			};
+
+			// Compress the input up to the position limit to one block
+			void compress(size_t limit, bool final);
+
+			size_t hash(size_t position) const
+			{
+				const unsigned char *p = &data[position - base];
+				return (((size_t)p[0] << 10) ^ ((size_t)p[1] << 5) ^ p[2]) & ((1 << hash_bits) - 1);
+			}
+
+			void insert(size_t position);
+
+			// Length of the longest match at the position (0 if shorter than
+			// min_match) and its distance
+			int find_match(size_t position, int& distance) const;
+
+			// Write the symbols and the input between begin and end as a block
+			void write_block(size_t begin, size_t end, bool final);
+
+			void write_stored(size_t begin, size_t end, bool final);
+
+			void write_symbols(const unsigned char *litlen_lengths, const unsigned short *litlen_codes,
+				const unsigned char *dist_lengths, const unsigned short *dist_codes);
+
+			void put_bits(unsigned long value, int count);
+
+			// Fill the last byte with zero bits
+			void align();
+
+			int level;
+			int max_chain; // number of matches tried at a position
+			int nice_length; // length of a match, which is good enough
+			bool lazy; // whether a match is deferred if the next position has a longer one
+
+			std::vector<unsigned char> data; // window before the position and the input after it
+			size_t base; // position of the first byte of data in the stream
+			size_t position; // position of the first byte not compressed yet
+			std::vector<size_t> head; // newest position + 1 of every hash
+			std::vector<size_t> prev; // previous position + 1 with the hash of a position
+
+			std::vector<Symbol> symbols; // symbols of the current block
+			unsigned long adler_a, adler_b; // Adler-32 checksum of the input
+
+			std::vector<unsigned char> output;
+			unsigned long long bits; // bits not written to the output yet
+			int bit_count;
+		};
+
+		inline Deflater::Deflater(int in_level) : level(in_level < 0 ? 0 : (in_level > 9 ? 9 : in_level)),
+			base(0), position(0), adler_a(1), adler_b(0), bits(0), bit_count(0)
+		{
+			// Searched matches, good enough length and lazy matching of the levels
+			static const int parameters[10][3] = {
+				{ 0, 0, 0 }, { 4, 8, 0 }, { 8, 16, 0 }, { 16, 32, 0 }, { 16, 32, 1 },
+				{ 32, 64, 1 }, { 128, 128, 1 }, { 256, 258, 1 }, { 1024, 258, 1 }, { 4096, 258, 1 }
+			};
+			max_chain = parameters[level][0];
+			nice_length = parameters[level][1];
+			lazy = parameters[level][2] != 0;
+
+			if (level)
+			{
+				head.assign((size_t)1 << hash_bits, 0);
+				prev.assign(window, 0);
+			}
+
+			// zlib header with the compression level hint
+			int flevel = level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3));
+			int flags = flevel << 6;
+			flags += 31 - ((0x78 << 8 | flags) % 31);
+			output.push_back(0x78);
+			output.push_back((unsigned char)flags);
+		}
+
+		inline void Deflater::write(const unsigned char *in_data, size_t length)
+		{
+			// Adler-32 with the sums reduced before they can overflow
+			for (size_t i = 0; i < length; i += 5552)
+			{
+				size_t end = length - i < 5552 ? length : i + 5552;
+				for (size_t j = i; j != end; ++j)
+				{
+					adler_a += in_data[j];
+					adler_b += adler_a;
+				}
+				adler_a %= 65521;
+				adler_b %= 65521;
+			}
+
+			data.insert(data.end(), in_data, in_data + length);
+
+			// A block is compressed once the longest match after it is known
+			while (base + data.size() - position >= block + max_match)
+			{
+				this->compress(position + block, false);
+			}
+		}
+
+		inline void Deflater::finish()
+		{
+			this->compress(base + data.size(), true);
+			this->align();
+
+			output.push_back((unsigned char)(adler_b >> 8));
+			output.push_back((unsigned char)adler_b);
+			output.push_back((unsigned char)(adler_a >> 8));
+			output.push_back((unsigned char)adler_a);
+		}
+
+		inline void Deflater::insert(size_t at)
+		{
+			if (at + min_match > base + data.size())
+			{
+				return;
+			}
+
+			size_t h = this->hash(at);
+			prev[at & (window - 1)] = head[h];
+			head[h] = at + 1;
+		}
+
+		inline int Deflater::find_match(size_t at, int& distance) const
+		{
+			size_t available = base + data.size() - at;
+			int max_length = available < (size_t)max_match ? (int)available : max_match;
+			if (max_length < min_match)
+			{
+				return 0;
+			}
+
+			const unsigned char *current = &data[at - base];
+			int best = min_match - 1;
+			int chain = max_chain;
+
+			// Older positions of the hash chain are sooner out of the window
+			for (size_t candidate = head[this->hash(at)]; candidate && chain--;
+				candidate = prev[(candidate - 1) & (window - 1)])
+			{
+				size_t match = candidate - 1;
+				if (match >= at || at - match > window || match < base)
+				{
+					break;
+				}
+
+				const unsigned char *previous = &data[match - base];
+				if (previous[best] != current[best] || previous[0] != current[0])
+				{
+					continue;
+				}
+
+				int length = 0;
+				while (length < max_length && previous[length] == current[length])
+				{
+					++length;
+				}
+
+				if (length > best)
+				{
+					best = length;
+					distance = (int)(at - match);
+					if (length >= nice_length || length == max_length)
+					{
+						break;
+					}
+				}
+			}
+
+			return best >= min_match ? best : 0;
+		}
+
+		inline void Deflater::compress(size_t limit, bool final)
+		{
+			size_t begin = position;
+			symbols.clear();
+
+			if (!level)
+			{
+				position = limit;
+			}
+
+			// Matches at the end of the block may reach after the limit
+			int length = 0, distance = 0;
+			bool found = false; // whether length and distance belong to the position
+			while (position < limit)
+			{
+				if (!found)
+				{
+					length = this->find_match(position, distance);
+				}
+				found = false;
+
+				this->insert(position);
+
+				if (lazy && length && length < nice_length)
+				{
+					int next_distance = 0;
+					int next_length = this->find_match(position + 1, next_distance);
+					if (next_length > length)
+					{
+						symbols.push_back(Symbol{ data[position - base], 0 });
+						++position;
+
+						length = next_length;
+						distance = next_distance;
+						found = true;
+						continue;
+					}
+				}
+
+				if (length)
+				{
+					symbols.push_back(Symbol{ (unsigned short)length, (unsigned short)distance });
+					for (int i = 1; i != length; ++i)
+					{
+						this->insert(position + i);
+					}
+					position += length;
+				}
+				else
+				{
+					symbols.push_back(Symbol{ data[position - base], 0 });
+					++position;
+				}
+			}
+
+			this->write_block(begin, position, final);
+
+			// Keep only the window before the position
+			if (position - base > window + block)
+			{
+				size_t drop = position - window - base;
+				data.erase(data.begin(), data.begin() + drop);
+				base += drop;
+			}
+		}
+
+		inline void Deflater::put_bits(unsigned long value, int count)
+		{
+			bits |= (unsigned long long)value << bit_count;
+			bit_count += count;
+
+			while (bit_count >= 8)
+			{
+				output.push_back((unsigned char)bits);
+				bits >>= 8;
+				bit_count -= 8;
+			}
+		}
+
+		inline void Deflater::align()
+		{
+			if (bit_count)
+			{
+				this->put_bits(0, 8 - bit_count);
+			}
+		}
+
+		inline void Deflater::write_stored(size_t begin, size_t end, bool final)
+		{
+			do
+			{
+				size_t length = end - begin < 65535 ? end - begin : 65535;
+				bool last = final && begin + length == end;
+
+				this->put_bits(last ? 1 : 0, 1);
+				this->put_bits(0, 2);
+				this->align();
+				this->put_bits((unsigned long)length, 16);
+				this->put_bits((unsigned long)(~length & 0xFFFF), 16);
+
+				const unsigned char *p = &data[begin - base];
+				output.insert(output.end(), p, p + length);
+				begin += length;
+			} while (begin < end);
+		}
+
+		inline void Deflater::write_symbols(const unsigned char *litlen_lengths,
+			const unsigned short *litlen_codes, const unsigned char *dist_lengths,
+			const unsigned short *dist_codes)
+		{
+			const DeflateTables& tables = deflate_tables();
+
+			for (size_t i = 0; i != symbols.size(); ++i)
+			{
+				const Symbol& symbol = symbols[i];
+				if (!symbol.distance)
+				{
+					this->put_bits(litlen_codes[symbol.length], litlen_lengths[symbol.length]);
+					continue;
+				}
+
+				int code = tables.length_code[symbol.length];
+				this->put_bits(litlen_codes[257 + code], litlen_lengths[257 + code]);
+				this->put_bits(symbol.length - tables.length_base[code], tables.length_extra[code]);
+
+				int d = symbol.distance - 1;
+				code = d < 256 ? tables.dist_code[d] : tables.dist_code[256 + (d >> 7)];
+				this->put_bits(dist_codes[code], dist_lengths[code]);
+				this->put_bits(symbol.distance - tables.dist_base[code], tables.dist_extra[code]);
+			}
+
+			this->put_bits(litlen_codes[256], litlen_lengths[256]);
+		}
+
+		inline void Deflater::write_block(size_t begin, size_t end, bool final)
+		{
+			if (!level)
+			{
+				this->write_stored(begin, end, final);
+				return;
+			}
+
+			const DeflateTables& tables = deflate_tables();
+
+			unsigned long litlen_freqs[286] = { 0 };
+			unsigned long dist_freqs[30] = { 0 };
+			for (size_t i = 0; i != symbols.size(); ++i)
+			{
+				if (!symbols[i].distance)
+				{
+					++litlen_freqs[symbols[i].length];
+					continue;
+				}
+
+				int d = symbols[i].distance - 1;
+				++litlen_freqs[257 + tables.length_code[symbols[i].length]];
+				++dist_freqs[d < 256 ? tables.dist_code[d] : tables.dist_code[256 + (d >> 7)]];
+			}
+			litlen_freqs[256] = 1;
+
+			unsigned char litlen_lengths[286], dist_lengths[30];
+			huffman_lengths(litlen_freqs, 286, 15, litlen_lengths);
+			huffman_lengths(dist_freqs, 30, 15, dist_lengths);
+
+			// Bits of the symbols, which are the same for both Huffman codes
+			unsigned long long extra_bits = 0, dynamic_bits = 0, fixed_bits = 0;
+			for (int i = 0; i != 286; ++i)
+			{
+				extra_bits += i > 256 ? litlen_freqs[i] * tables.length_extra[i - 257] : 0;
+				dynamic_bits += (unsigned long long)litlen_freqs[i] * litlen_lengths[i];
+				fixed_bits += (unsigned long long)litlen_freqs[i] * tables.fixed_litlen_lengths[i];
+			}
+			for (int i = 0; i != 30; ++i)
+			{
+				extra_bits += (unsigned long long)dist_freqs[i] * tables.dist_extra[i];
+				dynamic_bits += (unsigned long long)dist_freqs[i] * dist_lengths[i];
+				fixed_bits += (unsigned long long)dist_freqs[i] * 5;
+			}
+
+			// Code lengths of both codes compressed by runs (16 repeats the
+			// previous length, 17 and 18 repeat zeros)
+			int litlen_count = 286, dist_count = 30;
+			while (litlen_count > 257 && !litlen_lengths[litlen_count - 1]) { --litlen_count; }
+			while (dist_count > 1 && !dist_lengths[dist_count - 1]) { --dist_count; }
+
+			std::vector<unsigned char> lengths(litlen_lengths, litlen_lengths + litlen_count);
+			lengths.insert(lengths.end(), dist_lengths, dist_lengths + dist_count);
+
+			// Code length symbols and their extra bits
+			std::vector<std::pair<unsigned char, unsigned char>> runs;
+			for (size_t i = 0; i < lengths.size();)
+			{
+				size_t run = 1;
+				while (i + run < lengths.size() && lengths[i + run] == lengths[i]) { ++run; }
+
+				if (!lengths[i] && run >= 11)
+				{
+					run = run < 138 ? run : 138;
+					runs.push_back(std::make_pair((unsigned char)18, (unsigned char)(run - 11)));
+				}
+				else if (!lengths[i] && run >= 3)
+				{
+					runs.push_back(std::make_pair((unsigned char)17, (unsigned char)(run - 3)));
+				}
+				else if (lengths[i] && run >= 4)
+				{
+					// The length itself and 3 to 6 repetitions of it
+					run = run < 7 ? run : 7;
+					runs.push_back(std::make_pair(lengths[i], (unsigned char)0));
+					runs.push_back(std::make_pair((unsigned char)16, (unsigned char)(run - 4)));
+				}
+				else
+				{
+					run = 1;
+					runs.push_back(std::make_pair(lengths[i], (unsigned char)0));
+				}
+
+				i += run;
+			}
+
+			unsigned long code_freqs[19] = { 0 };
+			for (size_t r = 0; r != runs.size(); ++r)
+			{
+				++code_freqs[runs[r].first];
+			}
+
+			unsigned char code_lengths[19];
+			unsigned short code_codes[19];
+			huffman_lengths(code_freqs, 19, 7, code_lengths);
+			huffman_codes(code_lengths, 19, code_codes);
+
+			static const unsigned char order[19] =
+				{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			int code_count = 19;
+			while (code_count > 4 && !code_lengths[order[code_count - 1]]) { --code_count; }
+
+			unsigned long long header_bits = 5 + 5 + 4 + 3 * code_count;
+			for (size_t r = 0; r != runs.size(); ++r)
+			{
+				static const int run_extra[3] = { 2, 3, 7 };
+				header_bits += code_lengths[runs[r].first] + (runs[r].first >= 16 ? run_extra[runs[r].first - 16] : 0);
+			}
+
+			dynamic_bits += extra_bits + header_bits;
+			fixed_bits += extra_bits;
+			unsigned long long stored_bits = ((end - begin) / 65535 + 1) * (3 + 7 + 32) + 8 * (unsigned long long)(end - begin);
+
+			if (stored_bits <= dynamic_bits && stored_bits <= fixed_bits)
+			{
+				this->write_stored(begin, end, final);
+			}
+			else if (fixed_bits <= dynamic_bits)
+			{
+				this->put_bits(final ? 1 : 0, 1);
+				this->put_bits(1, 2);
+				this->write_symbols(tables.fixed_litlen_lengths, tables.fixed_litlen_codes,
+					tables.fixed_dist_lengths, tables.fixed_dist_codes);
+			}
+			else
+			{
+				unsigned short litlen_codes[286], dist_codes[30];
+				huffman_codes(litlen_lengths, 286, litlen_codes);
+				huffman_codes(dist_lengths, 30, dist_codes);
+
+				this->put_bits(final ? 1 : 0, 1);
+				this->put_bits(2, 2);
+				this->put_bits(litlen_count - 257, 5);
+				this->put_bits(dist_count - 1, 5);
+				this->put_bits(code_count - 4, 4);
+				for (int i = 0; i != code_count; ++i)
+				{
+					this->put_bits(code_lengths[order[i]], 3);
+				}
+
+				for (size_t r = 0; r != runs.size(); ++r)
+				{
+					static const int run_extra[3] = { 2, 3, 7 };
+					unsigned char symbol = runs[r].first;
+					this->put_bits(code_codes[symbol], code_lengths[symbol]);
+					if (symbol >= 16)
+					{
+						this->put_bits(runs[r].second, run_extra[symbol - 16]);
+					}
+				}
+
+				this->write_symbols(litlen_lengths, litlen_codes, dist_lengths, dist_codes);
+			}
+		}
+	}
+}
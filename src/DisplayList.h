@@ -0,0 +1,469 @@
+#pragma once
+#include "Header.h"
+#include "Canvas.h"
+#include "Trace.h"
+
+namespace cpplot
+{
+	/*
+	Canvas recording the drawing calls in pixel space, so that they can be
+	replayed later without laying out and transforming the data again. While
+	recording, every call is also forwarded to the target canvas, which
+	provides the text metrics. A recording larger than its limit is dropped
+	and the rest of the calls is only forwarded.
+	*/
+	class DisplayList : public Canvas
+	{
+	public:
+		DisplayList() : target(nullptr), align(TA_LEFT | TA_TOP), limit(0), 
+			size(0), overflow(false) {};
+
+		// Clear the list and start recording the calls forwarded to in_target,
+		// at most in_limit bytes of them
+		void record(Canvas *in_target, size_t in_limit = DISPLAY_LIST_LIMIT);
+
+		// Stop forwarding the calls and return whether the whole recording was kept
+		bool stop();
+
+		// Repeat the recorded calls on the canvas
+		void replay(Canvas *canvas) const;
+
+		void clear();
+
+		bool empty() const { return commands.empty(); }
+
+		virtual void select_pen(COLORREF color, int width);
+
+		virtual void select_brush(COLORREF color);
+
+		virtual void select_font(int escapement, bool bold);
+
+		virtual UINT set_text_align(UINT align);
+
+		virtual TextMetric get_text_metrics();
+
+		virtual void move_to(int x, int y);
+
+		virtual void line_to(int x, int y);
+
+		virtual void polyline(const POINT *points, int count);
+
+		virtual void polypolyline(const POINT *points, const DWORD *counts,
+			int polylines);
+
+		virtual void rectangle(int left, int top, int right, int bottom);
+
+		virtual void rectangles(const RECT *rects, int count);
+
+		virtual void ellipse(int left, int top, int right, int bottom);
+
+		virtual void ellipses(const RECT *rects, int count);
+
+		virtual void text_out(int x, int y, const char *text, int length);
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba);
+
+		virtual void set_clip(const RECT *clip);
+
+	private:
+		enum Type
+		{
+			PEN, BRUSH, FONT, ALIGN, MOVE_TO, LINE_TO, POLYLINE, POLYPOLYLINE,
+			RECTANGLE, RECTANGLES, ELLIPSE, ELLIPSES, TEXT, IMAGE, CLIP, NO_CLIP
+		};
+
+		// Call with its integer arguments and the position and length
+		// of its array argument in the storage of its type, polypolyline
+		// has the points from the offset of points_offset
+		struct Command
+		{
+			Type type;
+			int args[4];
+			size_t offset, length, points_offset;
+		};
+
+		// Whether a call with bytes of array arguments can be recorded
+		bool reserve(size_t bytes);
+
+		void push(Type type, int a = 0, int b = 0, int c = 0, int d = 0,
+			size_t offset = 0, size_t length = 0);
+
+		Canvas *target; // canvas the calls are forwarded to while recording
+		UINT align; // text alignment set by the recorded calls
+		size_t limit, size; // maximal and current size of the recording in bytes
+		bool overflow; // whether the recording exceeded the limit
+
+		std::vector<Command> commands;
+		std::vector<POINT> points;
+		std::vector<DWORD> counts;
+		std::vector<RECT> rects;
+		std::string text;
+		std::vector<unsigned char> pixels;
+	};
+
+	inline void DisplayList::record(Canvas *in_target, size_t in_limit)
+	{
+		this->clear();
+		target = in_target;
+		limit = in_limit;
+	}
+
+	inline bool DisplayList::stop()
+	{
+		target = nullptr;
+
+		return !overflow;
+	}
+
+	inline bool DisplayList::reserve(size_t bytes)
+	{
+		CPPLOT_TRACE_COUNT(TRACE_PRIMITIVES, 1);
+
+		if (overflow)
+		{
+			return false;
+		}
+
+		size += sizeof(Command) + bytes;
+		if (size > limit)
+		{
+			// Release the memory of the dropped recording
+			this->clear();
+			commands.shrink_to_fit();
+			points.shrink_to_fit();
+			counts.shrink_to_fit();
+			rects.shrink_to_fit();
+			text.shrink_to_fit();
+			pixels.shrink_to_fit();
+			overflow = true;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	inline void DisplayList::clear()
+	{
+		commands.clear();
+		points.clear();
+		counts.clear();
+		rects.clear();
+		text.clear();
+		pixels.clear();
+		size = 0;
+		overflow = false;
+	}
+
+	inline void DisplayList::push(Type type, int a, int b, int c, int d,
+		size_t offset, size_t length)
+	{
+		Command command;
+		command.type = type;
+		command.args[0] = a;
+		command.args[1] = b;
+		command.args[2] = c;
+		command.args[3] = d;
+		command.offset = offset;
+		command.length = length;
+		command.points_offset = 0;
+
+		commands.push_back(command);
+	}
+
+	inline void DisplayList::select_pen(COLORREF color, int width)
+	{
+		if (this->reserve(0))
+		{
+			this->push(PEN, (int)color, width);
+		}
+
+		if (target)
+		{
+			target->select_pen(color, width);
+		}
+	}
+
+	inline void DisplayList::select_brush(COLORREF color)
+	{
+		if (this->reserve(0))
+		{
+			this->push(BRUSH, (int)color);
+		}
+
+		if (target)
+		{
+			target->select_brush(color);
+		}
+	}
+
+	inline void DisplayList::select_font(int escapement, bool bold)
+	{
+		if (this->reserve(0))
+		{
+			this->push(FONT, escapement, bold);
+		}
+
+		if (target)
+		{
+			target->select_font(escapement, bold);
+		}
+	}
+
+	inline UINT DisplayList::set_text_align(UINT in_align)
+	{
+		if (this->reserve(0))
+		{
+			this->push(ALIGN, (int)in_align);
+		}
+
+		UINT prev_align = align;
+		align = in_align;
+
+		return target ? target->set_text_align(in_align) : prev_align;
+	}
+
+	inline TextMetric DisplayList::get_text_metrics()
+	{
+		// Metrics do not change the canvas, so they are not recorded
+		return target ? target->get_text_metrics() : TextMetric{ 0, 0 };
+	}
+
+	inline void DisplayList::move_to(int x, int y)
+	{
+		if (this->reserve(0))
+		{
+			this->push(MOVE_TO, x, y);
+		}
+
+		if (target)
+		{
+			target->move_to(x, y);
+		}
+	}
+
+	inline void DisplayList::line_to(int x, int y)
+	{
+		if (this->reserve(0))
+		{
+			this->push(LINE_TO, x, y);
+		}
+
+		if (target)
+		{
+			target->line_to(x, y);
+		}
+	}
+
+	inline void DisplayList::polyline(const POINT *in_points, int count)
+	{
+		if (this->reserve(count * sizeof(POINT)))
+		{
+			this->push(POLYLINE, 0, 0, 0, 0, points.size(), count);
+			points.insert(points.end(), in_points, in_points + count);
+		}
+
+		if (target)
+		{
+			target->polyline(in_points, count);
+		}
+	}
+
+	inline void DisplayList::polypolyline(const POINT *in_points, const DWORD *in_counts,
+		int polylines)
+	{
+		size_t total = 0;
+		for (int i = 0; i != polylines; ++i)
+		{
+			total += in_counts[i];
+		}
+
+		if (this->reserve(polylines * sizeof(DWORD) + total * sizeof(POINT)))
+		{
+			this->push(POLYPOLYLINE, 0, 0, 0, 0, counts.size(), polylines);
+			commands.back().points_offset = points.size();
+			counts.insert(counts.end(), in_counts, in_counts + polylines);
+			points.insert(points.end(), in_points, in_points + total);
+		}
+
+		if (target)
+		{
+			target->polypolyline(in_points, in_counts, polylines);
+		}
+	}
+
+	inline void DisplayList::rectangle(int left, int top, int right, int bottom)
+	{
+		if (this->reserve(0))
+		{
+			this->push(RECTANGLE, left, top, right, bottom);
+		}
+
+		if (target)
+		{
+			target->rectangle(left, top, right, bottom);
+		}
+	}
+
+	inline void DisplayList::rectangles(const RECT *in_rects, int count)
+	{
+		if (this->reserve(count * sizeof(RECT)))
+		{
+			this->push(RECTANGLES, 0, 0, 0, 0, rects.size(), count);
+			rects.insert(rects.end(), in_rects, in_rects + count);
+		}
+
+		if (target)
+		{
+			target->rectangles(in_rects, count);
+		}
+	}
+
+	inline void DisplayList::ellipse(int left, int top, int right, int bottom)
+	{
+		if (this->reserve(0))
+		{
+			this->push(ELLIPSE, left, top, right, bottom);
+		}
+
+		if (target)
+		{
+			target->ellipse(left, top, right, bottom);
+		}
+	}
+
+	inline void DisplayList::ellipses(const RECT *in_rects, int count)
+	{
+		if (this->reserve(count * sizeof(RECT)))
+		{
+			this->push(ELLIPSES, 0, 0, 0, 0, rects.size(), count);
+			rects.insert(rects.end(), in_rects, in_rects + count);
+		}
+
+		if (target)
+		{
+			target->ellipses(in_rects, count);
+		}
+	}
+
+	inline void DisplayList::text_out(int x, int y, const char *in_text, int length)
+	{
+		if (this->reserve(length))
+		{
+			this->push(TEXT, x, y, 0, 0, text.size(), length);
+			text.append(in_text, length);
+		}
+
+		if (target)
+		{
+			target->text_out(x, y, in_text, length);
+		}
+	}
+
+	inline void DisplayList::image(int left, int top, int width, int height,
+		const unsigned char *rgba)
+	{
+		size_t bytes = width > 0 && height > 0 ? (size_t)width * height * 4 : 0;
+		if (this->reserve(bytes))
+		{
+			this->push(IMAGE, left, top, width, height, pixels.size(), bytes);
+			pixels.insert(pixels.end(), rgba, rgba + bytes);
+		}
+
+		if (target)
+		{
+			target->image(left, top, width, height, rgba);
+		}
+	}
+
+	inline void DisplayList::set_clip(const RECT *clip)
+	{
+		if (this->reserve(0))
+		{
+			if (clip)
+			{
+				this->push(CLIP, clip->left, clip->top, clip->right, clip->bottom);
+			}
+			else
+			{
+				this->push(NO_CLIP);
+			}
+		}
+
+		if (target)
+		{
+			target->set_clip(clip);
+		}
+	}
+
+	inline void DisplayList::replay(Canvas *canvas) const
+	{
+		CPPLOT_TRACE_SCOPE("DisplayList::replay");
+		CPPLOT_TRACE_COUNT(TRACE_PRIMITIVES, commands.size());
+
+		for (size_t i = 0; i != commands.size(); ++i)
+		{
+			const Command& command = commands[i];
+			const int *args = command.args;
+
+			switch (command.type)
+			{
+			case PEN:
+				canvas->select_pen((COLORREF)args[0], args[1]);
+				break;
+			case BRUSH:
+				canvas->select_brush((COLORREF)args[0]);
+				break;
+			case FONT:
+				canvas->select_font(args[0], args[1] != 0);
+				break;
+			case ALIGN:
+				canvas->set_text_align((UINT)args[0]);
+				break;
+			case MOVE_TO:
+				canvas->move_to(args[0], args[1]);
+				break;
+			case LINE_TO:
+				canvas->line_to(args[0], args[1]);
+				break;
+			case POLYLINE:
+				canvas->polyline(points.data() + command.offset, (int)command.length);
+				break;
+			case POLYPOLYLINE:
+				canvas->polypolyline(points.data() + command.points_offset,
+					counts.data() + command.offset, (int)command.length);
+				break;
+			case RECTANGLE:
+				canvas->rectangle(args[0], args[1], args[2], args[3]);
+				break;
+			case RECTANGLES:
+				canvas->rectangles(rects.data() + command.offset, (int)command.length);
+				break;
+			case ELLIPSE:
+				canvas->ellipse(args[0], args[1], args[2], args[3]);
+				break;
+			case ELLIPSES:
+				canvas->ellipses(rects.data() + command.offset, (int)command.length);
+				break;
+			case TEXT:
+				canvas->text_out(args[0], args[1], text.data() + command.offset,
+					(int)command.length);
+				break;
+			case IMAGE:
+				canvas->image(args[0], args[1], args[2], args[3],
+					pixels.data() + command.offset);
+				break;
+			case CLIP:
+			{
+				RECT clip = { args[0], args[1], args[2], args[3] };
+				canvas->set_clip(&clip);
+				break;
+			}
+			case NO_CLIP:
+				canvas->set_clip(nullptr);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,251 @@
+#pragma once
+#include "Header.h"
+#include "Figure.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace cpplot
+{
+	// Result and durations of the export of one figure
+	struct ExportResult
+	{
+		std::string file; // name of the written file with its suffix
+		bool success;
+		double build_ms; // duration of the creation of the figure by the job
+		double render_ms; // duration of the rendering to memory
+		double encode_ms; // duration of the encoding and writing of the image (with the painting of svg and pdf)
+	};
+
+	/*
+	Saves figures to image files on a pool of threads. The figures are rendered
+	to memory, so no window or global state is involved and every thread works
+	on its own figure. Jobs wait in a queue of a limited length, so that a
+	producer submitting faster than the images are written is blocked instead
+	of holding all the figures in memory.
+	*/
+	class Exporter
+	{
+	public:
+		// Start threads workers (all hardware threads if 0) with a queue of
+		// capacity jobs (twice the number of workers if 0), the images are
+		// encoded with the options
+		Exporter(unsigned int threads = 0, size_t capacity = 0,
+			const ImageOptions& options = ImageOptions());
+
+		Exporter(const Exporter& exporter) = delete;
+
+		Exporter& operator=(const Exporter& exporter) = delete;
+
+		// Queue the figure to be saved as file.extension and deleted,
+		// blocks while the queue is full
+		void submit(std::unique_ptr<Figure> figure, std::string file,
+			std::string extension);
+
+		// Queue a job creating the figure on a worker, so that also the plotting
+		// of the data is done in parallel
+		void submit(std::function<std::unique_ptr<Figure>()> build, std::string file,
+			std::string extension);
+
+		// Wait until all the submitted jobs are done and return their results
+		// in the order of submission, the results are not kept afterwards
+		std::vector<ExportResult> wait();
+
+		// Finish the queued jobs and stop the workers
+		~Exporter();
+
+	private:
+		struct Job
+		{
+			std::unique_ptr<Figure> figure;
+			std::function<std::unique_ptr<Figure>()> build;
+			std::string file, extension;
+			size_t index; // position of the result
+		};
+
+		void push(Job job);
+
+		void work();
+
+		void run(Job& job);
+
+		std::vector<std::thread> workers;
+		size_t capacity;
+		ImageOptions options;
+
+		std::deque<Job> queue;
+		size_t active; // number of jobs taken by the workers and not yet done
+		std::vector<ExportResult> results;
+		bool stopping;
+
+		std::mutex mutex; // guards the queue, the results and the counters
+		std::condition_variable queue_changed; // a job was pushed or stopping is set
+		std::condition_variable job_done; // a job left the queue or was finished
+	};
+
+	inline Exporter::Exporter(unsigned int threads, size_t in_capacity,
+		const ImageOptions& in_options) : options(in_options), active(0), stopping(false)
+	{
+		size_t count = threads ? threads : Parallel::thread_count();
+		capacity = in_capacity ? in_capacity : 2 * count;
+
+		workers.reserve(count);
+		for (size_t i = 0; i != count; ++i)
+		{
+			workers.emplace_back(&Exporter::work, this);
+		}
+	}
+
+	inline void Exporter::submit(std::unique_ptr<Figure> figure, std::string file,
+		std::string extension)
+	{
+		Job job;
+		job.figure = std::move(figure);
+		job.file = file;
+		job.extension = extension;
+
+		this->push(std::move(job));
+	}
+
+	inline void Exporter::submit(std::function<std::unique_ptr<Figure>()> build,
+		std::string file, std::string extension)
+	{
+		Job job;
+		job.build = build;
+		job.file = file;
+		job.extension = extension;
+
+		this->push(std::move(job));
+	}
+
+	inline void Exporter::push(Job job)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		job_done.wait(lock, [this]() { return queue.size() < capacity; });
+
+		job.index = results.size();
+		results.push_back(ExportResult{ job.file + "." + job.extension, false, 0.0, 0.0, 0.0 });
+		queue.push_back(std::move(job));
+
+		queue_changed.notify_one();
+	}
+
+	inline std::vector<ExportResult> Exporter::wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		job_done.wait(lock, [this]() { return queue.empty() && !active; });
+
+		std::vector<ExportResult> done;
+		done.swap(results);
+
+		return done;
+	}
+
+	inline void Exporter::work()
+	{
+		// The figures are already rendered in parallel, so the parallel
+		// algorithms they call run on the worker only
+		Parallel::thread_limit() = 1;
+
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				queue_changed.wait(lock, [this]() { return stopping || !queue.empty(); });
+				if (queue.empty())
+				{
+					return;
+				}
+
+				job = std::move(queue.front());
+				queue.pop_front();
+				++active;
+			}
+			job_done.notify_all();
+
+			this->run(job);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--active;
+			}
+			job_done.notify_all();
+		}
+	}
+
+	inline void Exporter::run(Job& job)
+	{
+		typedef std::chrono::steady_clock Clock;
+		ExportResult result{ job.file + "." + job.extension, false, 0.0, 0.0, 0.0 };
+
+		Clock::time_point start = Clock::now();
+		if (job.build)
+		{
+			job.figure = job.build();
+		}
+		Clock::time_point built = Clock::now();
+
+		if (job.figure && Encoding::is_vector_format(Encoding::lower_case(job.extension)))
+		{
+			// Vector documents are written while they are painted
+			FILE *stream = Encoding::open_file(result.file);
+			if (stream)
+			{
+				FileSink sink(stream);
+				result.success = job.figure->write_vector(sink, job.extension, options);
+				result.success = (fclose(stream) == 0) && result.success;
+			}
+			if (!result.success)
+			{
+				printf("ERROR: An image could not be written to %s.\n", result.file.c_str());
+			}
+
+			result.encode_ms = std::chrono::duration<double, std::milli>(Clock::now() - built).count();
+		}
+		else if (job.figure)
+		{
+			Framebuffer framebuffer = job.figure->render();
+			Clock::time_point rendered = Clock::now();
+
+			result.success = SaveImage(framebuffer, result.file, job.extension, options);
+			Clock::time_point encoded = Clock::now();
+
+			result.render_ms = std::chrono::duration<double, std::milli>(rendered - built).count();
+			result.encode_ms = std::chrono::duration<double, std::milli>(encoded - rendered).count();
+		}
+		else
+		{
+			printf("Warning: No figure was given for %s. No action taken.\n", result.file.c_str());
+		}
+		result.build_ms = std::chrono::duration<double, std::milli>(built - start).count();
+
+		// The figure is released on the worker as well
+		job.figure.reset();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results[job.index] = result;
+	}
+
+	inline Exporter::~Exporter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		queue_changed.notify_all();
+
+		for (size_t i = 0; i != workers.size(); ++i)
+		{
+			workers[i].join();
+		}
+	}
+}
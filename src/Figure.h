@@ -1,11 +1,31 @@
+#pragma once
 #include "Header.h"
+#include "DataView.h"
+#include "Canvas.h"
+#include "Framebuffer.h"
+#include "Parallel.h"
 #include "Window.h"
 #include "Bitmap.h"
+#include "Vector.h"
 #include "Render.h"
+#include "Sampling.h"
+#include "Trace.h"
+
+#include <chrono>
 
 namespace cpplot
 {
+#ifdef _WIN32
 	int InitializeWindow(int width, int height);
+#endif
+
+	// Duration of a paint and the numbers of windows it drew and replayed
+	struct FrameStats
+	{
+		double paint_ms; // duration of the paint in milliseconds
+		int drawn; // windows laid out and drawn from their data
+		int replayed; // windows replayed from their retained drawing
+	};
 
 	class Figure
 	{
@@ -26,24 +46,70 @@ namespace cpplot
 		from CircularArray for that particular window shall be assigned if not.
 		*/
 		template<typename T = bool>
-		void plot(const std::vector<double>& x, const std::vector<double>& y,
+		Series plot(const std::vector<double>& x, const std::vector<double>& y,
+			std::string name = "", std::string type = "line", int width = 1,
+			T color = false, const std::vector<int>& position =
+			std::vector<int>{}, RenderObjects *render_ptr = nullptr);
+
+		template<typename T = bool>
+		Series plot(const std::vector<double>& y, std::string name = "", std::string
+			type = "line", int width = 1, T color = false,
+			const std::vector<int>& position = std::vector<int>{},
+			RenderObjects *render_ptr = nullptr);
+
+		// The vector overloads copy the data, while the views are used without
+		// copying -> the data must outlive the Figure unless the view owns them
+		template<typename T = bool>
+		Series plot(const DataView& x, const DataView& y,
 			std::string name = "", std::string type = "line", int width = 1,
 			T color = false, const std::vector<int>& position =
 			std::vector<int>{}, RenderObjects *render_ptr = nullptr);
 
 		template<typename T = bool>
-		void plot(const std::vector<double>& y, std::string name = "", std::string
+		Series plot(const DataView& y, std::string name = "", std::string
 			type = "line", int width = 1, T color = false,
 			const std::vector<int>& position = std::vector<int>{},
 			RenderObjects *render_ptr = nullptr);
 
+		// Create an empty series, which is filled by appending through the handle, 
+		// with a ring buffer of capacity points (0 keeps all points)
+		template<typename T = bool>
+		Series stream(std::string name = "", std::string type = "line",
+			size_t capacity = 0, int width = 1, T color = false,
+			const std::vector<int>& position = std::vector<int>{},
+			RenderObjects *render_ptr = nullptr);
+
+		// Plot the function on [from, to] sampled adaptively to the resolution
+		// of the figure (see SampleFunction), func may be any callable taking
+		// and returning a double
 		template<typename T = bool>
-		void fplot(double(*func)(double x), double from, double to,
+		Series fplot(double(*func)(double x), double from, double to,
+			std::string name = "", std::string type = "line",
+			int width = 1, T color = false,
+			const std::vector<int>& position = std::vector<int>{},
+			RenderObjects *render_ptr = nullptr);
+
+		template<typename T = bool, typename Function>
+		Series fplot(Function func, double from, double to,
 			std::string name = "", std::string type = "line",
 			int width = 1, T color = false,
 			const std::vector<int>& position = std::vector<int>{},
 			RenderObjects *render_ptr = nullptr);
 
+		template<typename T = bool>
+		Series fplot(double(*func)(double x), double from, double to,
+			const SampleOptions& options, std::string name = "",
+			std::string type = "line", int width = 1, T color = false,
+			const std::vector<int>& position = std::vector<int>{},
+			RenderObjects *render_ptr = nullptr);
+
+		template<typename T = bool, typename Function>
+		Series fplot(Function func, double from, double to,
+			const SampleOptions& options, std::string name = "",
+			std::string type = "line", int width = 1, T color = false,
+			const std::vector<int>& position = std::vector<int>{},
+			RenderObjects *render_ptr = nullptr);
+
 		template<typename T = bool>
 		void hist(const std::vector<double>& data, int bins, std::vector<double> range = {},
 			std::string name = "", int size = 1.0, T color = false,
@@ -56,6 +122,33 @@ namespace cpplot
 			bool normed = false, const std::vector<int>&
 			position = std::vector<int>{});
 
+		template<typename T = bool>
+		void hist(const DataView& data, int bins, std::vector<double> range = {},
+			std::string name = "", int size = 1.0, T color = false,
+			bool normed = false, const std::vector<int>& position =
+			std::vector<int>{});
+
+		template<typename T = bool>
+		void hist(const DataView& data, const std::vector<double>& bins,
+			std::string name = "", int size = 1.0, T color = false,
+			bool normed = false, const std::vector<int>&
+			position = std::vector<int>{});
+
+		// Create an empty histogram, which counts the chunks of values added
+		// through the handle, with bins between the range, or adapted to the
+		// data if the range is empty
+		template<typename T = bool>
+		Series stream_hist(int bins, std::vector<double> range = {},
+			std::string name = "", int size = 1, T color = false,
+			bool normed = false, const std::vector<int>& position =
+			std::vector<int>{});
+
+		template<typename T = bool>
+		Series stream_hist(const std::vector<double>& bins,
+			std::string name = "", int size = 1, T color = false,
+			bool normed = false, const std::vector<int>& position =
+			std::vector<int>{});
+
 		void xlabel(std::string xlab);
 
 		void ylabel(std::string ylab);
@@ -64,15 +157,101 @@ namespace cpplot
 
 		void legend();
 
+#ifdef _WIN32
 		void show()
 		{
+			// The window procedure paints the figure shown last
+			Globals::figure = this;
+
 			// Initialize the window with adjusted window coordinates
 			cpplot::InitializeWindow(win_width, win_height);
 		};
 
-		void paint(HDC hdc, HWND hwnd, RECT client_area);
+		void paint(HDC hdc, HWND hwnd, RECT client_area, const RECT *invalid = nullptr);
+
+		// Invalidate the windows with appended data or a changed view
+		void update(HWND hwnd);
+
+		// Handle a mouse message: the wheel zooms, dragging pans, dragging with
+		// the right button or with shift zooms to the box and a double-click
+		// shows all the data again
+		void mouse(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+		// Handle a key: F toggles the overlay and Home shows all the data
+		// of all the windows again
+		void keyboard(HWND hwnd, WPARAM key);
+
+		// Rubber band of a selected box drawn over the figure, nullptr removes it
+		void set_selection(const RECT *selection);
+
+		// Draw the statistics of the paints over the figure in its window
+		void set_overlay(bool enabled) { overlay = enabled; }
+#endif
+
+		// Zoom the window under the point (in the client area of the last paint)
+		// by the factor, > 1 zooms in. The view changes return whether a view
+		// changed, the window is then drawn again by the next paint.
+		bool zoom(POINT at, double factor);
+
+		// Move the view of the window under from as if its contents were dragged to
+		bool pan(POINT from, POINT to);
+
+		// Zoom the window under from to the box between from and to
+		bool zoom_box(POINT from, POINT to);
+
+		// Show all the data of the window under the point again
+		bool reset_view(POINT at);
+
+		// Show the range (min_x, max_x, min_y, max_y) in the window at the position
+		// (the active window if empty), an empty range follows the data again
+		void set_view(const std::vector<double>& range,
+			const std::vector<int>& position = std::vector<int>{});
+
+		// Paint the figure, only the windows intersecting invalid if it is given
+		void paint(Canvas *canvas, RECT client_area, const RECT *invalid = nullptr);
+
+		// Paint the figure to the whole framebuffer, the windows are painted 
+		// on paint threads and composed in order
+		void paint(Framebuffer& framebuffer, const RECT *invalid = nullptr);
+
+		// Number of threads painting the windows of the figure to the framebuffer
+		// of save or to the screen, 0 uses all hardware threads and 1 (default) 
+		// paints the windows one by one on the calling thread
+		void set_paint_threads(unsigned int threads) { paint_threads = threads; }
+
+		// Render the figure in its original size to memory, no window is needed
+		Framebuffer render();
+
+		// Render the figure and write it to file with the suffix of the extension,
+		// distinct figures can be saved on different threads at once. The options
+		// set the compression of the built-in encoders (png, bmp and ppm). Svg
+		// and pdf files are drawn as vector documents instead of pixels.
+		void save(std::string file, std::string extension,
+			const ImageOptions& options = ImageOptions());
 
-		void save(std::string file, std::string extension);
+		// Paint the figure as a vector document in the format (svg or pdf)
+		// streamed to the sink
+		bool write_vector(ImageSink& sink, const std::string& format,
+			const ImageOptions& options = ImageOptions());
+
+		// Numbers of the drawing objects created and reused by the last paint
+		// to a window, the in-memory rendering of save does not use any
+		ResourceStats get_resource_stats() const { return resource_stats; }
+
+		// Statistics of the last paint, to a window or by save
+		FrameStats get_frame_stats() const { return frame_stats; }
+
+		// Timings of the phases and counters of the work of the last paint, with
+		// the plotting since the previous paint. Empty unless compiled with
+		// CPPLOT_TRACE defined.
+		TraceStats get_trace_stats() const { return trace.get_frame_stats(); }
+
+		// Write the traced phases and the counters of the frames to file in the
+		// Chrome trace-event format (json), which chrome://tracing and Perfetto open
+		bool write_trace(const std::string& file) const;
+
+		// Drop the traced events and statistics
+		void clear_trace() { trace.clear(); }
 
 		~Figure();
 
@@ -80,6 +259,31 @@ namespace cpplot
 		void plot_check(const std::vector<int>& position, int&
 			local_window);
 
+		// Scale the widths and heights of the windows to the client area
+		void layout(RECT client_area);
+
+		// Rectangle of the index-th window in the last layout
+		RECT window_rect(int index) const;
+
+		void paint_dividers(Canvas *canvas, RECT client_area);
+
+#ifdef _WIN32
+		// Paint the rubber band and the overlay over the painted windows
+		void paint_overlay(Canvas *canvas, RECT client_area, 
+			std::chrono::steady_clock::time_point start);
+#endif
+
+		// Index of the window containing the point in the last layout, -1 if none
+		int window_at(POINT point) const;
+
+		// Lay the windows out and find those intersecting invalid,
+		// returns false if the figure cannot be painted
+		bool collect_windows(RECT client_area, const RECT *invalid, std::vector<int>& indices);
+
+		// Split the windows to groups painted on one thread, windows sharing 
+		// a renderer of the user are in the same group
+		std::vector<std::vector<int>> paint_groups(const std::vector<int>& indices);
+
 		struct CircularArray
 		{
 			CircularArray() : value(0),
@@ -106,8 +310,27 @@ namespace cpplot
 		std::vector<int> width, height; // user specified width and height
 		std::vector<int> width_copy, height_copy; // width and height vectors for resizing
 		std::vector<COLORREF> colors; // user specified colors of the windows
+#ifdef _WIN32
 		HFONT font; // font of the rendering
+		GDICache gdi_cache; // drawing objects reused by the paints
+		SurfaceGDI back_buffer; // frame composed before it is copied to the window
+		std::unique_ptr<SurfaceGDI[]> surfaces; // last drawing of every window
+		std::vector<unsigned long> surface_versions; // versions of the windows on the surfaces
+		std::vector<std::unique_ptr<GDICache>> worker_caches; // drawing objects of the other painting threads
+
+		enum Drag { DRAG_NONE, DRAG_PAN, DRAG_SELECT };
+		Drag drag; // action of the mouse button held down
+		int drag_window; // window in which the drag started
+		POINT drag_from, drag_last; // points where the drag started and was last seen
+		bool overlay; // whether the statistics of the paints are drawn over the figure
+		bool selecting; // whether the rubber band is drawn
+		RECT selection; // rubber band of the selected box
+#endif
+		ResourceStats resource_stats; // statistics of the last paint
+		FrameStats frame_stats; // statistics of the last paint
+		Trace trace; // timings and counters of the work, if traced
 		bool divided; // indicator whether individual windows should be divided by black line
+		unsigned int paint_threads; // threads painting the windows, 0 for all hardware threads
 
 		int active_window; // currently active window
 	};
@@ -116,12 +339,22 @@ namespace cpplot
 		const std::vector<COLORREF>& in_colors, bool in_divided) : x_dim((int)in_width.size()),
 		y_dim((int)in_height.size()), width(in_width), height(in_height),
 		width_copy(in_width.size()), height_copy(in_height.size()), colors(in_colors),
-		win_height(0), win_width(0), active_window(-1), divided(in_divided)
+		win_height(0), win_width(0), resource_stats{ 0, 0 }, frame_stats{ 0.0, 0, 0 },
+		divided(in_divided), paint_threads(1), active_window(-1)
 	{
+#ifdef _WIN32
+		drag = DRAG_NONE;
+		drag_window = -1;
+		drag_from = drag_last = POINT{ 0, 0 };
+		overlay = false;
+		selecting = false;
+		selection = RECT();
+
 		// Save default font
 		LOGFONT lf;
 		SystemParametersInfo(SPI_GETICONTITLELOGFONT, sizeof(LOGFONT), &lf, 0);
 		font = CreateFontIndirect(&lf);
+#endif
 
 		// Check if dimensions of individual vectors are nonzero
 		if ((x_dim == 0) || (y_dim == 0))
@@ -148,9 +381,6 @@ namespace cpplot
 			}
 		}
 
-		// Set the Globals::figure to current Figure instance
-		Globals::figure = this;
-
 		// Compute the overall width and height
 		for (int i = 0; i != x_dim; ++i)
 		{
@@ -175,15 +405,22 @@ namespace cpplot
 
 	Figure::Figure(int in_width, int in_height, COLORREF colors, bool in_divided) :
 		x_dim(1), y_dim(1), width(1, in_width), height(1, in_height),
-		width_copy(1), height_copy(1), active_window(-1), divided(in_divided)
+		width_copy(1), height_copy(1), resource_stats{ 0, 0 }, frame_stats{ 0.0, 0, 0 },
+		divided(in_divided), paint_threads(1), active_window(-1)
 	{
+#ifdef _WIN32
+		drag = DRAG_NONE;
+		drag_window = -1;
+		drag_from = drag_last = POINT{ 0, 0 };
+		overlay = false;
+		selecting = false;
+		selection = RECT();
+
 		// Set default font
 		LOGFONT lf;
 		SystemParametersInfo(SPI_GETICONTITLELOGFONT, sizeof(LOGFONT), &lf, 0);
 		font = CreateFontIndirect(&lf);
-
-		// Set the Globals::figure to current Figure instance
-		Globals::figure = this;
+#endif
 
 		// Set overall height and width
 		win_height = height[0];
@@ -198,15 +435,38 @@ namespace cpplot
 	}
 
 	template<typename T>
-	inline void Figure::plot(const std::vector<double>& x, const std::vector<double>& y,
+	inline Series Figure::plot(const std::vector<double>& x, const std::vector<double>& y,
 		std::string name, std::string type, int width, T color,
 		const std::vector<int>& position, RenderObjects *render_ptr)
 	{
+		// The copies are owned by the views
+		return this->plot(DataView(std::make_shared<const std::vector<double>>(x)),
+			DataView(std::make_shared<const std::vector<double>>(y)), name, type, 
+			width, color, position, render_ptr);
+	}
+
+	template<typename T>
+	inline Series Figure::plot(const std::vector<double>& y, std::string name,
+		std::string type, int width, T color,
+		const std::vector<int>& position, RenderObjects *render_ptr)
+	{
+		return this->plot(DataView(std::make_shared<const std::vector<double>>(y)), 
+			name, type, width, color, position, render_ptr);
+	}
+
+	template<typename T>
+	inline Series Figure::plot(const DataView& x, const DataView& y,
+		std::string name, std::string type, int width, T color,
+		const std::vector<int>& position, RenderObjects *render_ptr)
+	{
+		CPPLOT_TRACE_BIND(&trace);
+		CPPLOT_TRACE_SCOPE("Figure::plot");
+
 		// Check whether at least one data point in each container
 		if (x.empty() || y.empty())
 		{
 			printf("Warning: X or Y container is empty. No action taken.\n");
-			return;
+			return Series();
 		}
 
 		int loc_active_window = 0;
@@ -222,19 +482,23 @@ namespace cpplot
 		}
 
 		// Send the variables to the selected Window
-		windows[loc_active_window].prepare(x, y, name, type, width, loc_color, render_ptr);
+		return windows[loc_active_window].prepare(x, y, name, type, width, 
+			loc_color, render_ptr);
 	}
 
 	template<typename T>
-	inline void Figure::plot(const std::vector<double>& y, std::string name,
+	inline Series Figure::plot(const DataView& y, std::string name,
 		std::string type, int width, T color,
 		const std::vector<int>& position, RenderObjects *render_ptr)
 	{
+		CPPLOT_TRACE_BIND(&trace);
+		CPPLOT_TRACE_SCOPE("Figure::plot");
+
 		// Check whether at least one data point in the container
 		if (y.empty())
 		{
 			printf("Warning: Y container is empty. No action taken.\n");
-			return;
+			return Series();
 		}
 
 		int loc_active_window = 0;
@@ -250,26 +514,95 @@ namespace cpplot
 		}
 
 		// Send the variables to the selected Window
-		windows[loc_active_window].prepare(y, name, type, width, loc_color, render_ptr);
+		return windows[loc_active_window].prepare(y, name, type, width, 
+			loc_color, render_ptr);
 	}
 
 	template<typename T>
-	void Figure::fplot(double(*func)(double x), double from, double to,
+	inline Series Figure::stream(std::string name, std::string type, size_t capacity,
+		int width, T color, const std::vector<int>& position, RenderObjects *render_ptr)
+	{
+		int loc_active_window = 0;
+
+		// Perform all the necessary controls of input position
+		// and fill in current active window
+		this->plot_check(position, loc_active_window);
+
+		COLORREF loc_color = color;
+		if (typeid(color) != typeid(COLORREF))
+		{
+			loc_color = circular[loc_active_window].pop();
+		}
+
+		// Send empty data to the selected Window
+		Series series = windows[loc_active_window].prepare(DataView(), DataView(),
+			name, type, width, loc_color, render_ptr);
+
+		if (capacity)
+		{
+			series.set_capacity(capacity);
+		}
+
+		return series;
+	}
+
+	template<typename T>
+	Series Figure::fplot(double(*func)(double x), double from, double to,
+		std::string name, std::string type, int width,
+		T color, const std::vector<int>& position,
+		RenderObjects *render_ptr)
+	{
+		return this->fplot(func, from, to, SampleOptions(), name, type, width,
+			color, position, render_ptr);
+	}
+
+	template<typename T, typename Function>
+	Series Figure::fplot(Function func, double from, double to,
 		std::string name, std::string type, int width,
 		T color, const std::vector<int>& position,
 		RenderObjects *render_ptr)
 	{
-		static constexpr int length = FPLOT_LENGTH;
-		std::vector<double> x(length);
-		std::vector<double> y(length);
+		return this->fplot(func, from, to, SampleOptions(), name, type, width,
+			color, position, render_ptr);
+	}
+
+	template<typename T>
+	Series Figure::fplot(double(*func)(double x), double from, double to,
+		const SampleOptions& options, std::string name, std::string type,
+		int width, T color, const std::vector<int>& position,
+		RenderObjects *render_ptr)
+	{
+		return this->fplot<T, double(*)(double)>(func, from, to, options, name, type,
+			width, color, position, render_ptr);
+	}
+
+	template<typename T, typename Function>
+	Series Figure::fplot(Function func, double from, double to,
+		const SampleOptions& options, std::string name, std::string type,
+		int width, T color, const std::vector<int>& position,
+		RenderObjects *render_ptr)
+	{
+		CPPLOT_TRACE_BIND(&trace);
+		CPPLOT_TRACE_SCOPE("Figure::fplot");
 
-		for (int i = 0; i != length; ++i)
+		// The window of the graph is not known yet, so the sampling 
+		// is fine enough for the largest of the windows
+		int resolution_x = 0, resolution_y = 0;
+		for (size_t i = 0; i != this->width.size(); ++i)
+		{
+			resolution_x = this->width[i] > resolution_x ? this->width[i] : resolution_x;
+		}
+		for (size_t i = 0; i != this->height.size(); ++i)
 		{
-			x[i] = from + i * (to - from) / length;
-			y[i] = func(x[i]);
+			resolution_y = this->height[i] > resolution_y ? this->height[i] : resolution_y;
 		}
 
-		this->plot(x, y, name, type, width, color, position, render_ptr);
+		std::shared_ptr<std::vector<double>> x = std::make_shared<std::vector<double>>();
+		std::shared_ptr<std::vector<double>> y = std::make_shared<std::vector<double>>();
+		SampleFunction(func, from, to, options, resolution_x, resolution_y, *x, *y);
+
+		return this->plot(DataView(x), DataView(y), name, type, width, color, 
+			position, render_ptr);
 	}
 
 	template<typename T>
@@ -277,6 +610,26 @@ namespace cpplot
 		std::vector<double> range, std::string name, int size, T color,
 		bool normed, const std::vector<int>& position)
 	{
+		// Histogram does not keep the data, so they are not copied
+		this->hist(DataView(data), bins, range, name, size, color, normed, position);
+	}
+
+	template<typename T>
+	inline void Figure::hist(const std::vector<double>& data, const std::vector<double>&
+		bins, std::string name, int size, T color, bool normed,
+		const std::vector<int>& position)
+	{
+		this->hist(DataView(data), bins, name, size, color, normed, position);
+	}
+
+	template<typename T>
+	inline void Figure::hist(const DataView& data, int bins,
+		std::vector<double> range, std::string name, int size, T color,
+		bool normed, const std::vector<int>& position)
+	{
+		CPPLOT_TRACE_BIND(&trace);
+		CPPLOT_TRACE_SCOPE("Figure::hist");
+
 		// Check whether at least one data point in the container
 		if (data.empty())
 		{
@@ -301,10 +654,13 @@ namespace cpplot
 	}
 
 	template<typename T>
-	inline void Figure::hist(const std::vector<double>& data, const std::vector<double>&
+	inline void Figure::hist(const DataView& data, const std::vector<double>&
 		bins, std::string name, int size, T color, bool normed,
 		const std::vector<int>& position)
 	{
+		CPPLOT_TRACE_BIND(&trace);
+		CPPLOT_TRACE_SCOPE("Figure::hist");
+
 		// Check whether at least one data point in the container
 		if (data.empty())
 		{
@@ -328,6 +684,52 @@ namespace cpplot
 		windows[loc_active_window].hist(data, bins, name, size, loc_color, normed);
 	}
 
+	template<typename T>
+	inline Series Figure::stream_hist(int bins, std::vector<double> range,
+		std::string name, int size, T color, bool normed,
+		const std::vector<int>& position)
+	{
+		if (bins < 1 || (!range.empty() && range.size() != 2))
+		{
+			printf("Warning: Incompatible bins or range. No action taken.\n");
+			return Series();
+		}
+
+		int loc_active_window = 0;
+
+		// Perform all the necessary controls of input position
+		// and fill in current active window
+		this->plot_check(position, loc_active_window);
+
+		COLORREF loc_color = color;
+		if (typeid(color) != typeid(COLORREF))
+		{
+			loc_color = circular[loc_active_window].pop();
+		}
+
+		return windows[loc_active_window].hist(bins, range, name, size, loc_color, normed);
+	}
+
+	template<typename T>
+	inline Series Figure::stream_hist(const std::vector<double>& bins,
+		std::string name, int size, T color, bool normed,
+		const std::vector<int>& position)
+	{
+		int loc_active_window = 0;
+
+		// Perform all the necessary controls of input position
+		// and fill in current active window
+		this->plot_check(position, loc_active_window);
+
+		COLORREF loc_color = color;
+		if (typeid(color) != typeid(COLORREF))
+		{
+			loc_color = circular[loc_active_window].pop();
+		}
+
+		return windows[loc_active_window].hist(bins, name, size, loc_color, normed);
+	}
+
 	inline void Figure::plot_check(const std::vector<int>& position, int& local_window)
 	{
 		// Check if the input position is default
@@ -369,160 +771,834 @@ namespace cpplot
 		}
 	}
 
-	inline void Figure::paint(HDC hdc, HWND hwnd, RECT client_area)
+#ifdef _WIN32
+	inline void Figure::paint(HDC hdc, HWND hwnd, RECT client_area, const RECT *invalid)
 	{
-		if (active_window == -1)
-		{
-			printf("Warning: No window was properly initialized. No action taken.\n");
+		CPPLOT_TRACE_FRAME(&trace, "Figure::paint");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-			SendMessage(hwnd, WM_CLOSE, NULL, NULL);
-
-			return;
+		// The overlay and the rubber band are drawn over the whole frame, 
+		// which covers their previous drawing
+		if (overlay || selecting)
+		{
+			invalid = nullptr;
 		}
 
-		// In case the window is distorted (e.g. minimized), do not paint
-		if (client_area.right - client_area.left <= 0 ||
-			client_area.bottom - client_area.top <= 0)
+		std::vector<int> indices;
+		if (!this->collect_windows(client_area, invalid, indices))
 		{
+			if (active_window == -1)
+			{
+				SendMessage(hwnd, WM_CLOSE, NULL, NULL);
+			}
+
 			return;
 		}
 
-		// Select default font
-		SelectObject(hdc, font);
-
-		// Set default text alignment 
-		SetTextAlign(hdc, TA_CENTER | TA_TOP);
+		frame_stats = FrameStats{ 0.0, 0, 0 };
 
-		// Adjust new coordinates to the possibly resized window
-		double width_ratio =
-			(double)(client_area.right - client_area.left) / (double)win_width;
-		double height_ratio =
-			(double)(client_area.bottom - client_area.top) / (double)win_height;
-		for (int i = 0; i != width.size(); ++i)
+		if (!surfaces)
 		{
-			width_copy[i] = (int)(width[i] * width_ratio);
+			surfaces.reset(new SurfaceGDI[x_dim * y_dim]);
+			surface_versions.assign(x_dim * y_dim, 0);
 		}
-		for (int i = 0; i != height.size(); ++i)
+
+		// The frame is composed off-screen and copied to the window at once,
+		// so that the windows do not flicker while they are painted one by one
+		HBRUSH background = GetSysColorBrush(COLOR_WINDOW);
+		if (back_buffer.resize(hdc, client_area.right - client_area.left, 
+			client_area.bottom - client_area.top))
 		{
-			height_copy[i] = (int)(height[i] * height_ratio);
+			FillRect(back_buffer.get_dc(), &client_area, background);
 		}
 
-		// Divide the windows by black line if the user requested it
-		if (divided)
+		// Windows are drawn to their surfaces only if their size or contents changed
+		std::vector<int> stale;
+		for (size_t k = 0; k != indices.size(); ++k)
 		{
-			HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-			HGDIOBJ prev_hBoxPen = SelectObject(hdc, hBoxPen);
+			int i = indices[k];
+			RECT rect = this->window_rect(i);
 
-			int agg_width = 0, agg_height = 0;
-			for (int i = 1; i != width.size(); ++i)
+			unsigned long version = windows[i].get_version();
+			if (surfaces[i].resize(hdc, rect.right - rect.left, rect.bottom - rect.top) ||
+				version != surface_versions[i])
 			{
-				agg_width += width_copy[i];
-
-				MoveToEx(hdc, agg_width, client_area.bottom, NULL);
-				LineTo(hdc, agg_width, client_area.top);
-			}
-			for (int i = 1; i != height.size(); ++i)
-			{
-				agg_height += height_copy[i];
-
-				MoveToEx(hdc, client_area.left, agg_height, NULL);
-				LineTo(hdc, client_area.right, agg_height);
+				stale.push_back(i);
+				surface_versions[i] = version;
 			}
+		}
 
-			// Set previous options and delete graphics objects
-			SelectObject(hdc, prev_hBoxPen);
-			DeleteObject(hBoxPen);
+		// Every painting thread selects the drawing objects from its own cache
+		std::vector<std::vector<int>> groups = this->paint_groups(stale);
+		size_t workers = Parallel::worker_count(groups.size(), paint_threads);
+		while (worker_caches.size() + 1 < workers)
+		{
+			worker_caches.emplace_back(new GDICache());
 		}
 
-		// Plot the individual windows
-		int pos_x, pos_y;
-		RECT rect;
+		gdi_cache.begin_frame();
+		for (size_t w = 0; w + 1 < workers; ++w)
+		{
+			worker_caches[w]->begin_frame();
+		}
 
-		for (int i = 0; i != (x_dim * y_dim); ++i)
+		Parallel::for_tasks(groups.size(), paint_threads, [&](size_t worker, size_t task)
 		{
-			if (!windows[i].is_window_initialized())
+			CPPLOT_TRACE_BIND(&trace);
+			GDICache *cache = worker ? worker_caches[worker - 1].get() : &gdi_cache;
+
+			for (size_t k = 0; k != groups[task].size(); ++k)
 			{
-				printf("Warning: The window is not initialized. No action taken.\n");
+				int i = groups[task][k];
+				RECT rect = this->window_rect(i);
+				RECT local_rect = { 0, 0, rect.right - rect.left, rect.bottom - rect.top };
 
-				return;
-			}
+				HDC surface = surfaces[i].get_dc();
+				FillRect(surface, &local_rect, background);
 
-			// Compute the beginning position x and y of the window in the plot
-			pos_x = i / y_dim;
-			pos_y = i - pos_x * y_dim;
+				CanvasGDI canvas(surface, font, cache);
+				canvas.set_text_align(TA_CENTER | TA_TOP);
+				windows[i].show(&canvas, local_rect);
+			}
 
-			// Compute the RECT of that position
-			rect.top = cumulative_sum(height_copy, pos_y);
-			rect.bottom = cumulative_sum(height_copy, pos_y + 1);
-			rect.left = cumulative_sum(width_copy, pos_x);
-			rect.right = cumulative_sum(width_copy, pos_x + 1);
+			// Drawing calls are batched per thread, so they must be done before the composition
+			GdiFlush();
+		});
 
-			// Generate and show contents of individual windows
-			windows[i].show(hdc, hwnd, rect, font);
-		}
-	};
+		frame_stats.drawn = (int)stale.size();
+		frame_stats.replayed = (int)(indices.size() - stale.size());
 
-	inline void Figure::xlabel(std::string lab)
-	{
-		if (active_window > -1)
+		for (size_t k = 0; k != indices.size(); ++k)
 		{
-			windows[active_window].set_xlabel(lab);
+			RECT rect = this->window_rect(indices[k]);
+
+			BitBlt(back_buffer.get_dc(), rect.left, rect.top, rect.right - rect.left,
+				rect.bottom - rect.top, surfaces[indices[k]].get_dc(), 0, 0, SRCCOPY);
 		}
-	}
 
-	inline void Figure::ylabel(std::string lab)
-	{
-		if (active_window > -1)
+		// The dividing lines are on the edges of the windows, so they are drawn over them
 		{
-			windows[active_window].set_ylabel(lab);
+			CanvasGDI canvas(back_buffer.get_dc(), font, &gdi_cache);
+			this->paint_dividers(&canvas, client_area);
+			this->paint_overlay(&canvas, client_area, start);
 		}
-	}
 
-	inline void Figure::title(std::string lab)
-	{
-		if (active_window > -1)
+		RECT area = invalid ? *invalid : client_area;
+		BitBlt(hdc, area.left, area.top, area.right - area.left, area.bottom - area.top,
+			back_buffer.get_dc(), area.left, area.top, SRCCOPY);
+
+		resource_stats = gdi_cache.get_stats();
+		for (size_t w = 0; w + 1 < workers; ++w)
 		{
-			windows[active_window].set_title(lab);
+			ResourceStats stats = worker_caches[w]->get_stats();
+			resource_stats.created += stats.created;
+			resource_stats.reused += stats.reused;
 		}
+
+		frame_stats.paint_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
 	}
 
-	inline void Figure::legend()
+	inline void Figure::update(HWND hwnd)
 	{
+		// The background is not erased, the windows are copied over it
 		for (int i = 0; i != (x_dim * y_dim); ++i)
 		{
-			if (active_window > -1)
+			if (windows[i].is_dirty())
 			{
-				windows[i].activate_legend();
+				RECT rect = this->window_rect(i);
+				InvalidateRect(hwnd, &rect, FALSE);
 			}
 		}
 	}
 
-	inline void Figure::save(std::string file, std::string extension)
+	inline void Figure::paint_overlay(Canvas *canvas, RECT client_area,
+		std::chrono::steady_clock::time_point start)
 	{
-		// Set the suffix type of saved image
-		wchar_t *ext_dir = new wchar_t[extension.size() + 1];
-		MultiByteToWideChar(CP_UTF8, 0, extension.c_str(), -1, ext_dir, (int)extension.size() + 1);
-
-		// Allocate enough space to hold also the suffix of type 
-		// +2 because of dot and null termination
-		wchar_t *file_dir = new wchar_t[file.size() + (int)extension.size() + 2];
+		if (selecting)
+		{
+			POINT band[5] = { { selection.left, selection.top }, { selection.right, selection.top },
+				{ selection.right, selection.bottom }, { selection.left, selection.bottom },
+				{ selection.left, selection.top } };
 
-		// Copy the original string to the file_dir buffer
-		MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1, file_dir, (int)file.size() + 1);
-		file_dir[file.size()] = L'.';
+			canvas->select_pen(GREY, 1);
+			canvas->polyline(band, 5);
+		}
 
-		// Copy the suffix type to the buffer
-		wcscpy_s(file_dir + file.size() + 1, (int)extension.size() + 1, ext_dir);
+		if (!overlay)
+		{
+			return;
+		}
 
-		// Set the Globals::dir and Globals::ext, so the CALLBACK function can see it
-		cpplot::Globals::dir = file_dir;
-		cpplot::Globals::ext = ext_dir;
+		// The rest of the paint only copies the frame
+		double paint_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+		bool late = paint_ms > FRAME_BUDGET_MS;
+
+		char text[128];
+		int length = snprintf(text, sizeof(text), "%.1f ms, %d drawn, %d replayed%s",
+			paint_ms, frame_stats.drawn, frame_stats.replayed, late ? ", over budget" : "");
+		length = length < (int)sizeof(text) ? length : (int)sizeof(text) - 1;
+
+		TextMetric text_metric = canvas->get_text_metrics();
+		int left = client_area.left + OVERLAY_MARGIN;
+		int top = client_area.top + OVERLAY_MARGIN;
+
+		canvas->select_pen(BLACK, 1);
+		canvas->select_brush(late ? ORANGE : WHITE);
+		canvas->rectangle(left, top, left + length * text_metric.ave_char_width + 2 * OVERLAY_MARGIN,
+			top + text_metric.height + 2 * OVERLAY_MARGIN);
+
+		canvas->select_font(0, false);
+		UINT align = canvas->set_text_align(TA_LEFT | TA_TOP);
+		canvas->text_out(left + OVERLAY_MARGIN, top + OVERLAY_MARGIN, text, length);
+		canvas->set_text_align(align);
+	}
 
-		// Finally, show the whole figure
-		this->show();
+	inline void Figure::set_selection(const RECT *in_selection)
+	{
+		selecting = in_selection != nullptr;
+		selection = selecting ? *in_selection : RECT();
+	}
+
+	inline void Figure::mouse(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		POINT point = { (short)LOWORD(lParam), (short)HIWORD(lParam) };
+		bool changed = false;
+
+		switch (msg)
+		{
+		case WM_MOUSEWHEEL:
+		{
+			// The wheel reports the point on the screen
+			ScreenToClient(hwnd, &point);
+
+			double notches = (double)GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+			changed = this->zoom(point, pow(ZOOM_STEP, notches));
+			break;
+		}
+
+		case WM_LBUTTONDOWN:
+		case WM_RBUTTONDOWN:
+		{
+			drag_window = this->window_at(point);
+			if (drag_window == -1)
+			{
+				break;
+			}
+
+			drag = (msg == WM_RBUTTONDOWN || (wParam & MK_SHIFT)) ? DRAG_SELECT : DRAG_PAN;
+			drag_from = point;
+			drag_last = point;
+			SetCapture(hwnd);
+			break;
+		}
+
+		case WM_MOUSEMOVE:
+		{
+			if (drag == DRAG_PAN)
+			{
+				// The moves between two paints add up in the view, which is drawn once
+				changed = windows[drag_window].pan(point.x - drag_last.x, point.y - drag_last.y);
+				drag_last = point;
+			}
+			else if (drag == DRAG_SELECT)
+			{
+				RECT band = { drag_from.x < point.x ? drag_from.x : point.x,
+					drag_from.y < point.y ? drag_from.y : point.y,
+					drag_from.x < point.x ? point.x : drag_from.x,
+					drag_from.y < point.y ? point.y : drag_from.y };
+
+				// Only the band changes, the windows are copied from their surfaces
+				this->set_selection(&band);
+				InvalidateRect(hwnd, NULL, FALSE);
+			}
+			break;
+		}
+
+		case WM_LBUTTONUP:
+		case WM_RBUTTONUP:
+		{
+			if (drag == DRAG_SELECT)
+			{
+				this->set_selection(nullptr);
+				InvalidateRect(hwnd, NULL, FALSE);
+
+				changed = this->zoom_box(drag_from, point);
+			}
+
+			drag = DRAG_NONE;
+			ReleaseCapture();
+			break;
+		}
+
+		case WM_CAPTURECHANGED:
+		{
+			// The drag is cancelled if another window takes the mouse
+			if (drag == DRAG_SELECT)
+			{
+				this->set_selection(nullptr);
+				InvalidateRect(hwnd, NULL, FALSE);
+			}
+
+			drag = DRAG_NONE;
+			break;
+		}
 
-		delete[] ext_dir;
-		delete[] file_dir;
+		case WM_LBUTTONDBLCLK:
+		{
+			changed = this->reset_view(point);
+			break;
+		}
+		}
+
+		if (changed)
+		{
+			this->update(hwnd);
+		}
+	}
+
+	inline void Figure::keyboard(HWND hwnd, WPARAM key)
+	{
+		if (key == 'F')
+		{
+			overlay = !overlay;
+			InvalidateRect(hwnd, NULL, FALSE);
+		}
+		else if (key == VK_HOME)
+		{
+			for (int i = 0; i != (x_dim * y_dim); ++i)
+			{
+				windows[i].set_view(std::vector<double>());
+			}
+
+			this->update(hwnd);
+		}
+	}
+#endif
+
+	inline void Figure::layout(RECT client_area)
+	{
+		// Adjust new coordinates to the possibly resized window
+		double width_ratio =
+			(double)(client_area.right - client_area.left) / (double)win_width;
+		double height_ratio =
+			(double)(client_area.bottom - client_area.top) / (double)win_height;
+		for (int i = 0; i != width.size(); ++i)
+		{
+			width_copy[i] = (int)(width[i] * width_ratio);
+		}
+		for (int i = 0; i != height.size(); ++i)
+		{
+			height_copy[i] = (int)(height[i] * height_ratio);
+		}
+	}
+
+	inline RECT Figure::window_rect(int index) const
+	{
+		// Compute the beginning position x and y of the window in the plot
+		int pos_x = index / y_dim;
+		int pos_y = index - pos_x * y_dim;
+
+		// Compute the RECT of that position
+		RECT rect;
+		rect.top = cumulative_sum(height_copy, pos_y);
+		rect.bottom = cumulative_sum(height_copy, pos_y + 1);
+		rect.left = cumulative_sum(width_copy, pos_x);
+		rect.right = cumulative_sum(width_copy, pos_x + 1);
+
+		return rect;
+	}
+
+	inline void Figure::paint_dividers(Canvas *canvas, RECT client_area)
+	{
+		// Divide the windows by black line if the user requested it
+		if (!divided)
+		{
+			return;
+		}
+
+		canvas->select_pen(BLACK, 1);
+
+		int agg_width = 0, agg_height = 0;
+		for (int i = 1; i != width.size(); ++i)
+		{
+			agg_width += width_copy[i];
+
+			canvas->move_to(agg_width, client_area.bottom);
+			canvas->line_to(agg_width, client_area.top);
+		}
+		for (int i = 1; i != height.size(); ++i)
+		{
+			agg_height += height_copy[i];
+
+			canvas->move_to(client_area.left, agg_height);
+			canvas->line_to(client_area.right, agg_height);
+		}
+	}
+
+	inline bool Figure::collect_windows(RECT client_area, const RECT *invalid,
+		std::vector<int>& indices)
+	{
+		if (active_window == -1)
+		{
+			printf("Warning: No window was properly initialized. No action taken.\n");
+
+			return false;
+		}
+
+		// In case the window is distorted (e.g. minimized), do not paint
+		if (client_area.right - client_area.left <= 0 ||
+			client_area.bottom - client_area.top <= 0)
+		{
+			return false;
+		}
+
+		this->layout(client_area);
+
+		for (int i = 0; i != (x_dim * y_dim); ++i)
+		{
+			if (!windows[i].is_window_initialized())
+			{
+				printf("Warning: The window is not initialized. No action taken.\n");
+
+				return false;
+			}
+
+			RECT rect = this->window_rect(i);
+
+			// Skip the windows that do not need repainting
+			if (rect.right <= rect.left || rect.bottom <= rect.top || (invalid && 
+				(rect.right <= invalid->left || rect.left >= invalid->right ||
+				rect.bottom <= invalid->top || rect.top >= invalid->bottom)))
+			{
+				continue;
+			}
+
+			indices.push_back(i);
+		}
+
+		return true;
+	}
+
+	inline std::vector<std::vector<int>> Figure::paint_groups(const std::vector<int>& indices)
+	{
+		// Renderers keep buffers between the calls, so they cannot paint
+		// on two threads at once
+		std::vector<std::vector<int>> groups;
+		std::map<const RenderObjects*, size_t> renderer_groups;
+		std::vector<const RenderObjects*> renderers;
+
+		for (size_t k = 0; k != indices.size(); ++k)
+		{
+			renderers.clear();
+			windows[indices[k]].get_shared_renderers(renderers);
+
+			// Join the groups of all the renderers of the window
+			size_t group = groups.size();
+			for (size_t r = 0; r != renderers.size(); ++r)
+			{
+				std::map<const RenderObjects*, size_t>::iterator it = renderer_groups.find(renderers[r]);
+				if (it == renderer_groups.end() || it->second == group)
+				{
+					continue;
+				}
+
+				if (group == groups.size())
+				{
+					group = it->second;
+					continue;
+				}
+
+				size_t other = it->second;
+				groups[group].insert(groups[group].end(), groups[other].begin(), groups[other].end());
+				groups[other].clear();
+				for (it = renderer_groups.begin(); it != renderer_groups.end(); ++it)
+				{
+					it->second = it->second == other ? group : it->second;
+				}
+			}
+
+			if (group == groups.size())
+			{
+				groups.emplace_back();
+			}
+
+			groups[group].push_back(indices[k]);
+			for (size_t r = 0; r != renderers.size(); ++r)
+			{
+				renderer_groups[renderers[r]] = group;
+			}
+		}
+
+		// Windows of a group are painted in their order
+		std::vector<std::vector<int>> result;
+		for (size_t g = 0; g != groups.size(); ++g)
+		{
+			if (!groups[g].empty())
+			{
+				std::sort(groups[g].begin(), groups[g].end());
+				result.push_back(std::move(groups[g]));
+			}
+		}
+
+		return result;
+	}
+
+	inline void Figure::paint(Canvas *canvas, RECT client_area, const RECT *invalid)
+	{
+		CPPLOT_TRACE_FRAME(&trace, "Figure::paint");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::vector<int> indices;
+		if (!this->collect_windows(client_area, invalid, indices))
+		{
+			return;
+		}
+
+		frame_stats = FrameStats{ 0.0, 0, 0 };
+
+		// Set default text alignment 
+		canvas->set_text_align(TA_CENTER | TA_TOP);
+
+		this->paint_dividers(canvas, client_area);
+
+		// Generate and show contents of individual windows
+		for (size_t k = 0; k != indices.size(); ++k)
+		{
+			RECT rect = this->window_rect(indices[k]);
+
+			if (windows[indices[k]].show(canvas, rect))
+			{
+				++frame_stats.replayed;
+			}
+			else
+			{
+				++frame_stats.drawn;
+			}
+		}
+
+		frame_stats.paint_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	};
+
+	inline void Figure::paint(Framebuffer& framebuffer, const RECT *invalid)
+	{
+		CanvasMemory canvas(framebuffer);
+		RECT client_area = { 0, 0, framebuffer.get_width(), framebuffer.get_height() };
+
+		if (paint_threads == 1)
+		{
+			this->paint(&canvas, client_area, invalid);
+
+			return;
+		}
+
+		CPPLOT_TRACE_FRAME(&trace, "Figure::paint");
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::vector<int> indices;
+		if (!this->collect_windows(client_area, invalid, indices))
+		{
+			return;
+		}
+
+		frame_stats = FrameStats{ 0.0, 0, 0 };
+
+		canvas.set_text_align(TA_CENTER | TA_TOP);
+		this->paint_dividers(&canvas, client_area);
+
+		// Every window is painted to its own transparent layer, which covers
+		// its rectangle with a margin clipped to the framebuffer
+		size_t count = indices.size();
+		std::vector<RECT> areas(count);
+		std::vector<int> position(x_dim * y_dim, -1);
+		for (size_t k = 0; k != count; ++k)
+		{
+			RECT rect = this->window_rect(indices[k]);
+			areas[k].left = rect.left > PARALLEL_PAINT_MARGIN ? rect.left - PARALLEL_PAINT_MARGIN : 0;
+			areas[k].top = rect.top > PARALLEL_PAINT_MARGIN ? rect.top - PARALLEL_PAINT_MARGIN : 0;
+			areas[k].right = rect.right + PARALLEL_PAINT_MARGIN < client_area.right ?
+				rect.right + PARALLEL_PAINT_MARGIN : client_area.right;
+			areas[k].bottom = rect.bottom + PARALLEL_PAINT_MARGIN < client_area.bottom ?
+				rect.bottom + PARALLEL_PAINT_MARGIN : client_area.bottom;
+
+			position[indices[k]] = (int)k;
+		}
+
+		std::vector<std::unique_ptr<Framebuffer>> layers(count);
+		std::vector<char> replayed(count, 0);
+		std::vector<std::vector<int>> groups = this->paint_groups(indices);
+
+		Parallel::for_tasks(groups.size(), paint_threads, [&](size_t, size_t task)
+		{
+			CPPLOT_TRACE_BIND(&trace);
+
+			for (size_t g = 0; g != groups[task].size(); ++g)
+			{
+				int i = groups[task][g];
+				size_t k = position[i];
+
+				// The layer is placed at its area, so that the window is painted 
+				// to the same coordinates as on the calling thread
+				layers[k].reset(new Framebuffer(areas[k].right - areas[k].left,
+					areas[k].bottom - areas[k].top));
+				layers[k]->erase();
+				layers[k]->set_origin(areas[k].left, areas[k].top);
+
+				CanvasMemory layer_canvas(*layers[k]);
+				layer_canvas.set_text_align(TA_CENTER | TA_TOP);
+				replayed[k] = windows[i].show(&layer_canvas, this->window_rect(i));
+			}
+		});
+
+		for (size_t k = 0; k != count; ++k)
+		{
+			// A drawing leaving the layer within the framebuffer was cut or 
+			// rounded differently than on the framebuffer, such a window is 
+			// painted again directly to the framebuffer
+			RECT painted = layers[k]->get_painted();
+			painted.left = painted.left > client_area.left ? painted.left : client_area.left;
+			painted.top = painted.top > client_area.top ? painted.top : client_area.top;
+			painted.right = painted.right < client_area.right ? painted.right : client_area.right;
+			painted.bottom = painted.bottom < client_area.bottom ? painted.bottom : client_area.bottom;
+
+			if (painted.left < painted.right && painted.top < painted.bottom &&
+				(painted.left < areas[k].left || painted.top < areas[k].top ||
+				painted.right > areas[k].right || painted.bottom > areas[k].bottom))
+			{
+				bool replay = windows[indices[k]].show(&canvas, this->window_rect(indices[k]));
+				replayed[k] = replayed[k] && replay;
+			}
+			else
+			{
+				framebuffer.compose(*layers[k]);
+			}
+
+			if (replayed[k])
+			{
+				++frame_stats.replayed;
+			}
+			else
+			{
+				++frame_stats.drawn;
+			}
+		}
+
+		frame_stats.paint_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline int Figure::window_at(POINT point) const
+	{
+		for (int i = 0; i != (x_dim * y_dim); ++i)
+		{
+			RECT rect = this->window_rect(i);
+			if (point.x >= rect.left && point.x < rect.right &&
+				point.y >= rect.top && point.y < rect.bottom)
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	inline bool Figure::zoom(POINT at, double factor)
+	{
+		int i = this->window_at(at);
+		if (i == -1)
+		{
+			return false;
+		}
+
+		RECT rect = this->window_rect(i);
+
+		return windows[i].zoom(POINT{ at.x - rect.left, at.y - rect.top }, factor);
+	}
+
+	inline bool Figure::pan(POINT from, POINT to)
+	{
+		int i = this->window_at(from);
+		if (i == -1)
+		{
+			return false;
+		}
+
+		return windows[i].pan(to.x - from.x, to.y - from.y);
+	}
+
+	inline bool Figure::zoom_box(POINT from, POINT to)
+	{
+		int i = this->window_at(from);
+		if (i == -1)
+		{
+			return false;
+		}
+
+		RECT rect = this->window_rect(i);
+		RECT box = { from.x - rect.left, from.y - rect.top, to.x - rect.left, to.y - rect.top };
+
+		return windows[i].zoom_to(box);
+	}
+
+	inline bool Figure::reset_view(POINT at)
+	{
+		int i = this->window_at(at);
+		if (i == -1)
+		{
+			return false;
+		}
+
+		return windows[i].set_view(std::vector<double>());
+	}
+
+	inline void Figure::set_view(const std::vector<double>& range,
+		const std::vector<int>& position)
+	{
+		int index = active_window;
+		if (position.size() == 2)
+		{
+			index = x_dim * position[0] + position[1];
+		}
+
+		if (index < 0 || index >= (x_dim * y_dim))
+		{
+			printf("Warning: No window was found for the view. No action taken.\n");
+
+			return;
+		}
+
+		windows[index].set_view(range);
+	}
+
+	inline void Figure::xlabel(std::string lab)
+	{
+		if (active_window > -1)
+		{
+			windows[active_window].set_xlabel(lab);
+		}
+	}
+
+	inline void Figure::ylabel(std::string lab)
+	{
+		if (active_window > -1)
+		{
+			windows[active_window].set_ylabel(lab);
+		}
+	}
+
+	inline void Figure::title(std::string lab)
+	{
+		if (active_window > -1)
+		{
+			windows[active_window].set_title(lab);
+		}
+	}
+
+	inline void Figure::legend()
+	{
+		for (int i = 0; i != (x_dim * y_dim); ++i)
+		{
+			if (active_window > -1)
+			{
+				windows[i].activate_legend();
+			}
+		}
+	}
+
+	inline Framebuffer Figure::render()
+	{
+		CPPLOT_TRACE_FRAME(&trace, "Figure::render");
+
+		Framebuffer framebuffer(win_width, win_height);
+		this->paint(framebuffer);
+
+		return framebuffer;
+	}
+
+	inline void Figure::save(std::string file, std::string extension,
+		const ImageOptions& options)
+	{
+		CPPLOT_TRACE_FRAME(&trace, "Figure::save");
+
+		// Write the image with the suffix of its type
+		file += "." + extension;
+
+		std::string format = Encoding::lower_case(extension);
+		if (!Encoding::is_vector_format(format))
+		{
+			SaveImage(this->render(), file, extension, options);
+			return;
+		}
+
+		FILE *stream = Encoding::open_file(file);
+		if (!stream)
+		{
+			printf("ERROR: File %s could not be opened for writing.\n", file.c_str());
+			return;
+		}
+
+		FileSink sink(stream);
+		bool success = this->write_vector(sink, format, options);
+		if (!((fclose(stream) == 0) && success))
+		{
+			printf("ERROR: An image could not be written to %s.\n", file.c_str());
+		}
+	}
+
+	inline bool Figure::write_vector(ImageSink& sink, const std::string& format,
+		const ImageOptions& options)
+	{
+		CPPLOT_TRACE_FRAME(&trace, "Figure::write_vector");
+
+		std::unique_ptr<CanvasVector> canvas;
+		if (Encoding::lower_case(format) == "svg")
+		{
+			canvas.reset(new CanvasSVG(sink, win_width, win_height, options));
+		}
+		else if (Encoding::lower_case(format) == "pdf")
+		{
+			canvas.reset(new CanvasPDF(sink, win_width, win_height, options));
+		}
+		else
+		{
+			printf("ERROR: Given vector format is not supported. Use svg or pdf.\n");
+			return false;
+		}
+
+		RECT client_area = { 0, 0, win_width, win_height };
+		this->paint(canvas.get(), client_area);
+
+		return canvas->finish();
+	}
+
+	inline bool Figure::write_trace(const std::string& file) const
+	{
+		if (!Trace::enabled())
+		{
+			printf("Warning: Tracing is not compiled in, define CPPLOT_TRACE to enable it.\n");
+		}
+
+		std::string json;
+		trace.write_json(json);
+
+		FILE *stream = Encoding::open_file(file);
+		if (!stream)
+		{
+			printf("ERROR: File %s could not be opened for writing.\n", file.c_str());
+			return false;
+		}
+
+		bool success = fwrite(json.data(), 1, json.size(), stream) == json.size();
+		if (!((fclose(stream) == 0) && success))
+		{
+			printf("ERROR: The trace could not be written to %s.\n", file.c_str());
+			return false;
+		}
+
+		return true;
 	}
 
 	Figure::~Figure()
@@ -537,14 +1613,16 @@ namespace cpplot
 		// Free the buffer allocated by allocate
 		alloc_windows.deallocate(windows, x_dim * y_dim);
 		alloc_circular.deallocate(circular, x_dim * y_dim);
+
+#ifdef _WIN32
+		DeleteObject(font);
+#endif
 	};
 
+#ifdef _WIN32
 	// Callback function
 	LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	{
-		// Variable for the readiness of the window
-		static bool window_ready = false;
-
 		switch (msg)
 		{
 
@@ -556,30 +1634,21 @@ namespace cpplot
 			GetClientRect(hwnd, &client_area);
 
 			HDC hdc = BeginPaint(hwnd, &ps);
-			cpplot::Globals::figure->paint(hdc, hwnd, client_area);
-
-			// Save the image and destroy window
-			if (window_ready && cpplot::Globals::dir && cpplot::Globals::ext)
-			{
-				CreateImage(hwnd, hdc, cpplot::Globals::dir, cpplot::Globals::ext);
-				cpplot::Globals::dir = nullptr;
-				cpplot::Globals::ext = nullptr;
-				DestroyWindow(hwnd);
-			}
+			cpplot::Globals::figure->paint(hdc, hwnd, client_area, &ps.rcPaint);
 
 			EndPaint(hwnd, &ps);
 		}
 		break;
 
-		case WM_SHOWWINDOW:
+		case WM_ERASEBKGND:
 		{
-			window_ready = true;
+			// Every pixel is copied from the back buffer, erasing would only flicker
+			return 1;
 		}
-		break;
 
-		case WM_WINDOWPOSCHANGED:
+		case WM_TIMER:
 		{
-			SendMessage(hwnd, WM_PAINT, NULL, NULL);
+			cpplot::Globals::figure->update(hwnd);
 		}
 		break;
 
@@ -589,6 +1658,23 @@ namespace cpplot
 			{
 				DestroyWindow(hwnd);
 			}
+			else
+			{
+				cpplot::Globals::figure->keyboard(hwnd, wParam);
+			}
+		}
+		break;
+
+		case WM_MOUSEWHEEL:
+		case WM_MOUSEMOVE:
+		case WM_LBUTTONDOWN:
+		case WM_LBUTTONUP:
+		case WM_LBUTTONDBLCLK:
+		case WM_RBUTTONDOWN:
+		case WM_RBUTTONUP:
+		case WM_CAPTURECHANGED:
+		{
+			cpplot::Globals::figure->mouse(hwnd, msg, wParam, lParam);
 		}
 		break;
 
@@ -636,7 +1722,7 @@ namespace cpplot
 										 // increment 1 to the id
 		wc.lpszClassName = cpplot::Globals::FigureName;
 		wc.hIconSm = LoadIcon(NULL, IDI_APPLICATION);
-		wc.style = CS_HREDRAW | CS_VREDRAW;
+		wc.style = CS_HREDRAW | CS_VREDRAW | CS_DBLCLKS;
 
 		if (!RegisterClassEx(&wc))
 		{
@@ -669,6 +1755,9 @@ namespace cpplot
 
 		SetWindowPos(hwnd, NULL, 0, 0, rc.right - rc.left, rc.bottom - rc.top, NULL);
 
+		// Check for appended data periodically
+		SetTimer(hwnd, 1, UPDATE_INTERVAL, NULL);
+
 		// Show the window
 		ShowWindow(hwnd, SW_SHOW);
 		UpdateWindow(hwnd);
@@ -682,4 +1771,5 @@ namespace cpplot
 
 		return 0;
 	}
+#endif
 }
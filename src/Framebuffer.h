@@ -0,0 +1,669 @@
+#pragma once
+#include "Header.h"
+#include "Canvas.h"
+#include "Text.h"
+#include "Trace.h"
+
+namespace cpplot
+{
+	// In-memory image used as the target of the CanvasMemory
+	class Framebuffer
+	{
+	public:
+		Framebuffer(int in_width, int in_height, COLORREF background = WHITE);
+
+		int get_width() const { return width; }
+
+		int get_height() const { return height; }
+
+		// Position of the image on the drawing surface, the coordinates of the
+		// pixels and of the drawing to the image are relative to the surface
+		void set_origin(int x, int y) { origin_x = x; origin_y = y; }
+
+		int get_origin_x() const { return origin_x; }
+
+		int get_origin_y() const { return origin_y; }
+
+		// Pixels are stored top-down, row after row, as RGBA bytes
+		const unsigned char *get_data() const { return pixels.data(); }
+
+		unsigned char *get_data() { return pixels.data(); }
+
+		void clear(COLORREF color);
+
+		// Fill [left, right) x [top, bottom) clipped to the size of the image
+		// and to the clip rectangle
+		void fill_rect(int left, int top, int right, int bottom, COLORREF color);
+
+		void set_pixel(int x, int y, COLORREF color);
+
+		COLORREF get_pixel(int x, int y) const;
+
+		// Make all pixels transparent, so that the image can be drawn as a layer
+		void erase();
+
+		// Copy the painted (non-transparent) pixels of the layer to its origin
+		void compose(const Framebuffer& layer);
+
+		// Extent of the drawing since the last erase in the coordinates of the
+		// surface, including the parts outside of the image but not those
+		// outside of the clip rectangle
+		RECT get_painted() const { return painted; }
+
+		// Extend the painted extent by [left, right) x [top, bottom) clipped to
+		// the clip rectangle expanded by the margin
+		void mark_painted(int left, int top, int right, int bottom, int margin = 0);
+
+		// Restrict the painting to the rectangle in the coordinates of the
+		// surface, nullptr paints the whole image again
+		void set_clip(const RECT *in_clip);
+
+		// Area that can be painted, the image intersected with the clip rectangle
+		RECT get_bounds() const;
+
+	private:
+		int width, height;
+		int origin_x, origin_y;
+		std::vector<unsigned char> pixels;
+
+		RECT clip; // clip rectangle in the coordinates of the surface
+		bool clipped; // whether the clip rectangle is set
+		RECT painted; // extent of the drawing, empty if left >= right
+	};
+
+	inline Framebuffer::Framebuffer(int in_width, int in_height, COLORREF background) :
+		width(in_width > 0 ? in_width : 0), height(in_height > 0 ? in_height : 0),
+		origin_x(0), origin_y(0), pixels((size_t)width * height * 4), clip(),
+		clipped(false), painted()
+	{
+		CPPLOT_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+		this->clear(background);
+	}
+
+	inline void Framebuffer::clear(COLORREF color)
+	{
+		this->fill_rect(origin_x, origin_y, origin_x + width, origin_y + height, color);
+	}
+
+	inline void Framebuffer::fill_rect(int left, int top, int right, int bottom,
+		COLORREF color)
+	{
+		if (clipped)
+		{
+			left = left > clip.left ? left : clip.left;
+			top = top > clip.top ? top : clip.top;
+			right = right < clip.right ? right : clip.right;
+			bottom = bottom < clip.bottom ? bottom : clip.bottom;
+		}
+
+		this->mark_painted(left, top, right, bottom);
+
+		left -= origin_x;
+		right -= origin_x;
+		top -= origin_y;
+		bottom -= origin_y;
+
+		left = left < 0 ? 0 : left;
+		top = top < 0 ? 0 : top;
+		right = right > width ? width : right;
+		bottom = bottom > height ? height : bottom;
+
+		if (left >= right || top >= bottom)
+		{
+			return;
+		}
+
+		const unsigned char rgba[4] = { GetRValue(color), GetGValue(color),
+			GetBValue(color), 255 };
+
+		for (int y = top; y != bottom; ++y)
+		{
+			unsigned char *pixel = &pixels[((size_t)y * width + left) * 4];
+			for (int x = left; x != right; ++x, pixel += 4)
+			{
+				memcpy(pixel, rgba, 4);
+			}
+		}
+	}
+
+	inline void Framebuffer::set_pixel(int x, int y, COLORREF color)
+	{
+		if (clipped && (x < clip.left || y < clip.top || x >= clip.right || y >= clip.bottom))
+		{
+			return;
+		}
+
+		x -= origin_x;
+		y -= origin_y;
+		if (x < 0 || y < 0 || x >= width || y >= height)
+		{
+			return;
+		}
+
+		unsigned char *pixel = &pixels[((size_t)y * width + x) * 4];
+		pixel[0] = GetRValue(color);
+		pixel[1] = GetGValue(color);
+		pixel[2] = GetBValue(color);
+		pixel[3] = 255;
+	}
+
+	inline COLORREF Framebuffer::get_pixel(int x, int y) const
+	{
+		x -= origin_x;
+		y -= origin_y;
+		if (x < 0 || y < 0 || x >= width || y >= height)
+		{
+			return BLACK;
+		}
+
+		const unsigned char *pixel = &pixels[((size_t)y * width + x) * 4];
+
+		return RGB(pixel[0], pixel[1], pixel[2]);
+	}
+
+	inline void Framebuffer::erase()
+	{
+		std::fill(pixels.begin(), pixels.end(), (unsigned char)0);
+		painted = RECT();
+	}
+
+	inline void Framebuffer::compose(const Framebuffer& layer)
+	{
+		int left = layer.origin_x - origin_x;
+		int top = layer.origin_y - origin_y;
+
+		// Clip the layer to the image
+		int begin_x = left < 0 ? -left : 0;
+		int begin_y = top < 0 ? -top : 0;
+		int end_x = left + layer.width > width ? width - left : layer.width;
+		int end_y = top + layer.height > height ? height - top : layer.height;
+
+		for (int y = begin_y; y < end_y; ++y)
+		{
+			const unsigned char *source = &layer.pixels[((size_t)y * layer.width + begin_x) * 4];
+			unsigned char *target = &pixels[((size_t)(top + y) * width + left + begin_x) * 4];
+
+			for (int x = begin_x; x < end_x; ++x, source += 4, target += 4)
+			{
+				if (source[3])
+				{
+					memcpy(target, source, 4);
+				}
+			}
+		}
+	}
+
+	inline void Framebuffer::mark_painted(int left, int top, int right, int bottom,
+		int margin)
+	{
+		if (clipped)
+		{
+			left = left > clip.left - margin ? left : clip.left - margin;
+			top = top > clip.top - margin ? top : clip.top - margin;
+			right = right < clip.right + margin ? right : clip.right + margin;
+			bottom = bottom < clip.bottom + margin ? bottom : clip.bottom + margin;
+		}
+
+		if (left >= right || top >= bottom)
+		{
+			return;
+		}
+
+		if (painted.left >= painted.right)
+		{
+			painted = RECT{ left, top, right, bottom };
+
+			return;
+		}
+
+		painted.left = left < painted.left ? left : painted.left;
+		painted.top = top < painted.top ? top : painted.top;
+		painted.right = right > painted.right ? right : painted.right;
+		painted.bottom = bottom > painted.bottom ? bottom : painted.bottom;
+	}
+
+	inline void Framebuffer::set_clip(const RECT *in_clip)
+	{
+		clipped = in_clip != nullptr;
+		clip = clipped ? *in_clip : RECT();
+	}
+
+	inline RECT Framebuffer::get_bounds() const
+	{
+		RECT bounds = { origin_x, origin_y, origin_x + width, origin_y + height };
+		if (clipped)
+		{
+			bounds.left = bounds.left > clip.left ? bounds.left : clip.left;
+			bounds.top = bounds.top > clip.top ? bounds.top : clip.top;
+			bounds.right = bounds.right < clip.right ? bounds.right : clip.right;
+			bounds.bottom = bounds.bottom < clip.bottom ? bounds.bottom : clip.bottom;
+		}
+
+		return bounds;
+	}
+
+	/*
+	Software rasterizer painting to a Framebuffer, so that figures can be 
+	rendered without a window or GDI. Pens wider than one pixel are painted 
+	with round caps, text is rendered by the built-in bitmap font scaled by 
+	font_scale and rotated by multiples of 90 degrees.
+	*/
+	class CanvasMemory : public Canvas
+	{
+	public:
+		CanvasMemory(Framebuffer& in_framebuffer, int in_font_scale = FONT_SCALE);
+
+		virtual void select_pen(COLORREF color, int width);
+
+		virtual void select_brush(COLORREF color);
+
+		virtual void select_font(int escapement, bool bold);
+
+		virtual UINT set_text_align(UINT align);
+
+		virtual TextMetric get_text_metrics();
+
+		virtual void move_to(int x, int y);
+
+		virtual void line_to(int x, int y);
+
+		virtual void polyline(const POINT *points, int count);
+
+		virtual void polypolyline(const POINT *points, const DWORD *counts, 
+			int polylines);
+
+		virtual void rectangle(int left, int top, int right, int bottom);
+
+		virtual void rectangles(const RECT *rects, int count);
+
+		virtual void ellipse(int left, int top, int right, int bottom);
+
+		virtual void text_out(int x, int y, const char *text, int length);
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba);
+
+		virtual void set_clip(const RECT *clip);
+
+	private:
+		// Paint the current pen centered at the point
+		void stamp(int x, int y);
+
+		// Paint a line with the current pen, including the last point or not
+		void draw_line(int x0, int y0, int x1, int y1, bool last);
+
+		// Clip the line to the painted area extended by the pen width
+		bool clip_line(int& x0, int& y0, int& x1, int& y1) const;
+
+		Framebuffer& framebuffer;
+
+		COLORREF pen_color, brush_color, text_color;
+		int pen_width;
+		std::vector<int> pen_spans; // half-widths of the rows of the round pen
+
+		int pos_x, pos_y; // current position
+		UINT text_align;
+		int escapement; // font rotation in tenths of degrees
+		bool bold;
+		int font_scale;
+	};
+
+	inline CanvasMemory::CanvasMemory(Framebuffer& in_framebuffer, int in_font_scale) :
+		framebuffer(in_framebuffer), pen_color(BLACK), brush_color(WHITE), 
+		text_color(BLACK), pen_width(1), pen_spans(1, 0), pos_x(0), pos_y(0), 
+		text_align(TA_LEFT | TA_TOP), escapement(0), bold(false),
+		font_scale(in_font_scale > 0 ? in_font_scale : 1) {}
+
+	inline void CanvasMemory::select_pen(COLORREF color, int width)
+	{
+		pen_color = color;
+		pen_width = width > 1 ? width : 1;
+
+		// Pre-compute the shape of the round pen
+		double radius = pen_width * 0.5;
+		int half_height = pen_width > 1 ? (int)radius : 0;
+		pen_spans.resize(2 * half_height + 1);
+		for (int dy = -half_height; dy <= half_height; ++dy)
+		{
+			pen_spans[dy + half_height] = 
+				(int)sqrt(radius * radius - (double)dy * dy + FP_ERROR);
+		}
+
+		if (pen_width == 1)
+		{
+			pen_spans[0] = 0;
+		}
+	}
+
+	inline void CanvasMemory::select_brush(COLORREF color)
+	{
+		brush_color = color;
+	}
+
+	inline void CanvasMemory::select_font(int in_escapement, bool in_bold)
+	{
+		escapement = in_escapement;
+		bold = in_bold;
+	}
+
+	inline UINT CanvasMemory::set_text_align(UINT align)
+	{
+		UINT prev_align = text_align;
+		text_align = align;
+
+		return prev_align;
+	}
+
+	inline TextMetric CanvasMemory::get_text_metrics()
+	{
+		return TextMetric{ Font::cell_height * font_scale, Font::cell_width * font_scale };
+	}
+
+	inline void CanvasMemory::move_to(int x, int y)
+	{
+		pos_x = x;
+		pos_y = y;
+	}
+
+	inline void CanvasMemory::line_to(int x, int y)
+	{
+		this->draw_line(pos_x, pos_y, x, y, pen_width > 1);
+
+		pos_x = x;
+		pos_y = y;
+	}
+
+	inline void CanvasMemory::polyline(const POINT *points, int count)
+	{
+		for (int i = 1; i < count; ++i)
+		{
+			this->draw_line(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y,
+				pen_width > 1);
+		}
+	}
+
+	inline void CanvasMemory::polypolyline(const POINT *points, const DWORD *counts,
+		int polylines)
+	{
+		for (int i = 0; i != polylines; ++i)
+		{
+			this->polyline(points, (int)counts[i]);
+			points += counts[i];
+		}
+	}
+
+	inline void CanvasMemory::rectangle(int left, int top, int right, int bottom)
+	{
+		if (right < left) { std::swap(left, right); }
+		if (bottom < top) { std::swap(top, bottom); }
+
+		// Fill the interior and outline it with the current pen
+		framebuffer.fill_rect(left, top, right, bottom, brush_color);
+
+		this->draw_line(left, top, right - 1, top, true);
+		this->draw_line(right - 1, top, right - 1, bottom - 1, true);
+		this->draw_line(right - 1, bottom - 1, left, bottom - 1, true);
+		this->draw_line(left, bottom - 1, left, top, true);
+	}
+
+	inline void CanvasMemory::rectangles(const RECT *rects, int count)
+	{
+		for (int i = 0; i != count; ++i)
+		{
+			this->rectangle(rects[i].left, rects[i].top, rects[i].right, rects[i].bottom);
+		}
+	}
+
+	inline void CanvasMemory::ellipse(int left, int top, int right, int bottom)
+	{
+		if (right < left) { std::swap(left, right); }
+		if (bottom < top) { std::swap(top, bottom); }
+
+		double centre_x = (left + right - 1) * 0.5;
+		double centre_y = (top + bottom - 1) * 0.5;
+		double radius_x = (right - left - 1) * 0.5;
+		double radius_y = (bottom - top - 1) * 0.5;
+
+		// Fill the interior row by row
+		for (int y = top; y < bottom; ++y)
+		{
+			double half_width = radius_x;
+			if (radius_y > 0.0)
+			{
+				double dy = (y - centre_y) / radius_y;
+				if (dy * dy > 1.0)
+				{
+					continue;
+				}
+
+				half_width = radius_x * sqrt(1.0 - dy * dy);
+			}
+
+			framebuffer.fill_rect((int)ceil(centre_x - half_width), y,
+				(int)floor(centre_x + half_width) + 1, y + 1, brush_color);
+		}
+
+		// Outline the ellipse by stamping the pen along its perimeter
+		int steps = (int)(4.0 * (radius_x + radius_y)) + 8;
+		for (int i = 0; i != steps; ++i)
+		{
+			double angle = 2.0 * 3.14159265358979323846 * i / steps;
+			this->stamp((int)round(centre_x + radius_x * cos(angle)),
+				(int)round(centre_y + radius_y * sin(angle)));
+		}
+	}
+
+	inline void CanvasMemory::text_out(int x, int y, const char *text, int length)
+	{
+		// Rotation of the text in multiples of 90 degrees
+		int quadrant = ((escapement % 3600 + 3600) % 3600 + 450) / 900 % 4;
+
+		// The glyphs are composed once per text and the run is only copied,
+		// UTF-8 continuation bytes are skipped and characters outside of
+		// the font are rendered as '?'
+		const GlyphAtlas& atlas = GlyphAtlas::get(font_scale, bold, quadrant);
+		std::shared_ptr<const TextRun> run = TextRunCache::get(atlas, text, length);
+
+		// Extent of the text along and perpendicular to its direction
+		int text_width = run->count * Font::cell_width * font_scale;
+		int text_height = Font::cell_height * font_scale;
+
+		// Offsets of the reference point w.r.t. the text alignment
+		int ref_u = 0, ref_v = 0;
+		if ((text_align & TA_CENTER) == TA_CENTER)
+		{
+			ref_u = text_width / 2;
+		}
+		else if (text_align & TA_RIGHT)
+		{
+			ref_u = text_width;
+		}
+
+		if ((text_align & TA_BASELINE) == TA_BASELINE)
+		{
+			ref_v = (Font::glyph_height - 1) * font_scale;
+		}
+		else if (text_align & TA_BOTTOM)
+		{
+			ref_v = text_height;
+		}
+
+		// The offsets rotated to the device
+		switch (quadrant)
+		{
+		case 0:
+			x -= ref_u;
+			y -= ref_v;
+			break;
+		case 1:
+			x -= ref_v;
+			y += ref_u;
+			break;
+		case 2:
+			x += ref_u;
+			y += ref_v;
+			break;
+		case 3:
+			x += ref_v;
+			y -= ref_u;
+			break;
+		}
+
+		for (size_t i = 0; i != run->rects.size(); ++i)
+		{
+			const TextRect& rect = run->rects[i];
+			framebuffer.fill_rect(x + rect.x, y + rect.y, x + rect.x + rect.width,
+				y + rect.y + rect.height, text_color);
+		}
+	}
+
+	inline void CanvasMemory::image(int left, int top, int width, int height,
+		const unsigned char *rgba)
+	{
+		framebuffer.mark_painted(left, top, left + width, top + height);
+
+		// Clip the image to the painted area
+		RECT bounds = framebuffer.get_bounds();
+		int begin_x = left < bounds.left ? bounds.left - left : 0;
+		int begin_y = top < bounds.top ? bounds.top - top : 0;
+		int end_x = left + width > bounds.right ? bounds.right - left : width;
+		int end_y = top + height > bounds.bottom ? bounds.bottom - top : height;
+
+		left -= framebuffer.get_origin_x();
+		top -= framebuffer.get_origin_y();
+
+		for (int y = begin_y; y < end_y; ++y)
+		{
+			const unsigned char *source = rgba + ((size_t)y * width + begin_x) * 4;
+			unsigned char *target = framebuffer.get_data() +
+				((size_t)(top + y) * framebuffer.get_width() + left + begin_x) * 4;
+
+			for (int x = begin_x; x < end_x; ++x, source += 4, target += 4)
+			{
+				if (source[3])
+				{
+					target[0] = source[0];
+					target[1] = source[1];
+					target[2] = source[2];
+					target[3] = 255;
+				}
+			}
+		}
+	}
+
+	inline void CanvasMemory::set_clip(const RECT *clip)
+	{
+		framebuffer.set_clip(clip);
+	}
+
+	inline void CanvasMemory::stamp(int x, int y)
+	{
+		int half_height = (int)pen_spans.size() / 2;
+		for (int dy = -half_height; dy <= half_height; ++dy)
+		{
+			int half_width = pen_spans[dy + half_height];
+			framebuffer.fill_rect(x - half_width, y + dy, x + half_width + 1, 
+				y + dy + 1, pen_color);
+		}
+	}
+
+	inline void CanvasMemory::draw_line(int x0, int y0, int x1, int y1, bool last)
+	{
+		// The part of the line inside the clip rectangle is recorded with the
+		// parts outside of the image, since the clipping to the image changes
+		// the rounding of the line
+		framebuffer.mark_painted((x0 < x1 ? x0 : x1) - pen_width, (y0 < y1 ? y0 : y1) - pen_width,
+			(x0 > x1 ? x0 : x1) + pen_width + 1, (y0 > y1 ? y0 : y1) + pen_width + 1, pen_width);
+
+		if (!this->clip_line(x0, y0, x1, y1))
+		{
+			return;
+		}
+
+		// Bresenham's line algorithm
+		int dx = abs(x1 - x0), step_x = x0 < x1 ? 1 : -1;
+		int dy = -abs(y1 - y0), step_y = y0 < y1 ? 1 : -1;
+		int error = dx + dy;
+
+		while (x0 != x1 || y0 != y1)
+		{
+			this->stamp(x0, y0);
+
+			int error2 = 2 * error;
+			if (error2 >= dy)
+			{
+				error += dy;
+				x0 += step_x;
+			}
+			if (error2 <= dx)
+			{
+				error += dx;
+				y0 += step_y;
+			}
+		}
+
+		if (last)
+		{
+			this->stamp(x1, y1);
+		}
+	}
+
+	inline bool CanvasMemory::clip_line(int& x0, int& y0, int& x1, int& y1) const
+	{
+		int margin = pen_width;
+		RECT bounds = framebuffer.get_bounds();
+		double min_x = bounds.left - margin;
+		double min_y = bounds.top - margin;
+		double max_x = bounds.right + margin;
+		double max_y = bounds.bottom + margin;
+
+		// Lines inside the framebuffer are painted unchanged
+		if (x0 >= min_x && x0 <= max_x && y0 >= min_y && y0 <= max_y &&
+			x1 >= min_x && x1 <= max_x && y1 >= min_y && y1 <= max_y)
+		{
+			return true;
+		}
+
+		// Liang-Barsky clipping
+		double t0 = 0.0, t1 = 1.0;
+		double dx = (double)x1 - x0, dy = (double)y1 - y0;
+		double p[4] = { -dx, dx, -dy, dy };
+		double q[4] = { x0 - min_x, max_x - x0, y0 - min_y, max_y - y0 };
+
+		for (int i = 0; i != 4; ++i)
+		{
+			if (p[i] == 0.0)
+			{
+				if (q[i] < 0.0)
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			double t = q[i] / p[i];
+			if (p[i] < 0.0)
+			{
+				t0 = t > t0 ? t : t0;
+			}
+			else
+			{
+				t1 = t < t1 ? t : t1;
+			}
+		}
+
+		if (t0 > t1)
+		{
+			return false;
+		}
+
+		double start_x = x0, start_y = y0;
+		x0 = (int)round(start_x + t0 * dx);
+		y0 = (int)round(start_y + t0 * dy);
+		x1 = (int)round(start_x + t1 * dx);
+		y1 = (int)round(start_y + t1 * dy);
+
+		return true;
+	}
+}
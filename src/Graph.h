@@ -2,6 +2,12 @@
 #include "Header.h"
 #include "Constants.h"
 #include "Render.h"
+#include "Parallel.h"
+#include "RingBuffer.h"
+#include "Binning.h"
+#include "Pyramid.h"
+#include "Layout.h"
+#include "Trace.h"
 
 namespace cpplot {
 
@@ -18,372 +24,1012 @@ namespace cpplot {
 		return cum_sum;
 	}
 
-	inline int get_frac_digits(double x, int precision)
+	// Global variables
+	namespace Globals
 	{
-		int no_digits = precision;
-		int power = (int)pow(10, precision);
-		int modulo = 10;
+		// Maximum length of the ID (as wchar) of the Figure
+		static constexpr int size = 10;
+
+#ifdef _WIN32
+		// Buffer holding ID of the Figure
+		static wchar_t FigureName[size];
+
+		// ID of the current Figure
+		static int id = 0;
+
+		// Pointer to the Figure painted by the window procedure
+		static cpplot::Figure *figure = nullptr;
+#endif
+	};
+
+	// ABC
+	class Graph
+	{
+	public:
+		Graph(COLORREF in_color, int in_size) :
+			color(in_color), size(in_size), render_pointer(nullptr), 
+			ownership_render_pointer(true) {};
 
-		int int_part = (int)(abs(x));
-		double decim_part = abs(x) - int_part;
+		Graph(COLORREF in_color, int in_size, RenderObjects *render_ptr) :
+			color(in_color), size(in_size), render_pointer(render_ptr),
+			ownership_render_pointer(false) {};
 
-		int indicator;
+		virtual void show(Canvas *canvas, RECT rect,
+			const std::vector<double>& range) const = 0;
 
-		while (modulo <= power)
+		// Append a point and set range to the range of the graph data,
+		// returns false if the graph cannot be appended to
+		virtual bool append(double in_x, double in_y, std::vector<double>& range)
 		{
-			indicator = (int)(decim_part * power + FP_ERROR) % modulo;
+			return false;
+		};
+
+		// Keep only the newest capacity points, 0 keeps all of them
+		virtual bool set_capacity(size_t capacity, std::vector<double>& range)
+		{
+			return false;
+		};
+
+		// Count a chunk of values and set range to the range of the graph,
+		// returns false if the graph does not count values
+		virtual bool add(const DataView& data, std::vector<double>& range)
+		{
+			return false;
+		};
+
+		// Bring the data for show up to date with the appended points
+		virtual void flush() {};
+
+		// Renderer given by the user, which may be shared with other graphs,
+		// nullptr if the graph owns its renderer
+		const RenderObjects *get_shared_renderer() const
+		{
+			return ownership_render_pointer ? nullptr : render_pointer;
+		}
+
+		virtual ~Graph() = default;
+
+	protected:
+		COLORREF color;
+		int size;
+		RenderObjects *render_pointer;
+
+		bool ownership_render_pointer;
+	};
+
+	// Derived class for scatterplots
+	class Scatter : public Graph
+	{
+	public:
+		Scatter(const DataView& in_x, const DataView& in_y, int in_size,
+			COLORREF in_color, std::vector<double>& range,
+			RenderObjects *render_ptr);
+
+		// Non-constant c-ctor because the ownership of resources
+		// transfers during the copying
+		Scatter(Scatter& scatter);
+
+		virtual void show(Canvas *canvas, RECT rect,
+			const std::vector<double>& range) const;
+
+		virtual bool append(double in_x, double in_y, std::vector<double>& range);
+
+		virtual bool set_capacity(size_t capacity, std::vector<double>& range);
+
+		virtual ~Scatter();
 
-			if (indicator > 0)
+	private:
+		// Copy the viewed points to owned_x and owned_y
+		void own();
+
+		// Points -> a view of the input data, or of owned_x and owned_y
+		// once the points were appended to
+		DataView x, y;
+		std::vector<double> owned_x, owned_y;
+		bool owned;
+
+		std::vector<double> data_range; // min_x, max_x, min_y, max_y of the data
+
+		// Newest points if the capacity is limited -> the order of 
+		// the points does not matter for a scatterplot, so they 
+		// are rendered directly from the slots
+		RingBuffer ring;
+
+		// Spatial index of the points, built in the background once they are
+		// shown zoomed in, and the points of the last viewport read from it
+		mutable LazyIndex<TileIndex> tiles;
+		mutable std::vector<double> visible_x, visible_y;
+		mutable std::vector<double> visible_range;
+	};
+
+	Scatter::Scatter(const DataView& in_x, const DataView& in_y, int in_size,
+		COLORREF in_color, std::vector<double>& range, RenderObjects *render_ptr) : 
+		Graph(in_color, in_size, render_ptr), owned(false)
+	{
+		CPPLOT_TRACE_SCOPE("Scatter::Scatter");
+
+		// Initialize a RenderObjects instance and affirm 
+		// the ownership of the resources
+		if (!render_ptr)
+		{
+			// Large scatterplots are binned to a density image
+			if (DENSITY_SCATTER_THRESHOLD > 0 && in_x.size() > DENSITY_SCATTER_THRESHOLD)
+			{
+				render_pointer = new RenderScatterDensity(in_color);
+			}
+			else
 			{
-				// add 1 for the dot
-				return ++no_digits;
+				render_pointer = new RenderScatterPoints();
 			}
 
-			modulo *= 10;
-			--no_digits;
+			ownership_render_pointer = true;
+		}
+
+		// Only the points with both coordinates are kept
+		size_t length = in_x.size() < in_y.size() ? in_x.size() : in_y.size();
+		x = in_x.slice(0, length);
+		y = in_y.slice(0, length);
+
+		// Find min and max of x and y 
+		data_range = std::vector<double>(4);
+		minmax(x, data_range[0], data_range[1]);
+		minmax(y, data_range[2], data_range[3]);
+
+		// Set x and y range for Window member range
+		range[0] = range[0] < data_range[0] ? range[0] : data_range[0];
+		range[1] = range[1] > data_range[1] ? range[1] : data_range[1];
+		range[2] = range[2] < data_range[2] ? range[2] : data_range[2];
+		range[3] = range[3] > data_range[3] ? range[3] : data_range[3];
+	}
+
+	Scatter::Scatter(Scatter& scatter) :
+		Graph(scatter.color, scatter.size, scatter.render_pointer),
+		x(scatter.x), y(scatter.y), owned_x(scatter.owned_x), owned_y(scatter.owned_y),
+		owned(scatter.owned), data_range(scatter.data_range), ring(scatter.ring)
+	{
+		if (owned)
+		{
+			x = DataView(owned_x);
+			y = DataView(owned_y);
 		}
 
-		return no_digits;
+		ownership_render_pointer = scatter.ownership_render_pointer;
+		scatter.ownership_render_pointer = false;
 	}
 
-	inline int get_int_digits(double x)
+	void Scatter::show(Canvas *canvas, RECT rect,
+		const std::vector<double>& range) const
 	{
-		int no_digits = 0;
-		int int_part = (int)(abs(x) + FP_ERROR);
+		CPPLOT_TRACE_SCOPE("Scatter::show");
 
-		while (int_part >= 1)
+		// Set appropriate graph properties
+		canvas->select_pen(color, size);
+		canvas->select_brush(color);
+		
+		if (ring.get_capacity())
 		{
-			int_part /= 10;
-			++no_digits;
+			if (ring.size())
+			{
+				CPPLOT_TRACE_COUNT(TRACE_POINTS, ring.size());
+				render_pointer->renderPoints(canvas, DataView(ring.get_x()),
+					DataView(ring.get_y()), rect, range);
+			}
+
+			return;
 		}
 
-		// In case x is negative, add also - sign
-		if (x < 0.0)
+		if (x.empty())
 		{
-			++no_digits;
+			return;
 		}
 
-		// In case x is below +/-one, add one for the beginning zero 
-		if (abs(x) + FP_ERROR < 1.0)
+		// The range widened by the markers crossing the edges of the rectangle
+		double width = rect.right > rect.left ? rect.right - rect.left : 1;
+		double height = rect.bottom > rect.top ? rect.bottom - rect.top : 1;
+		double margin_x = (size + 2) * (range[1] - range[0]) / width;
+		double margin_y = (size + 2) * (range[3] - range[2]) / height;
+		std::vector<double> visible = { range[0] - margin_x, range[1] + margin_x,
+			range[2] - margin_y, range[3] + margin_y };
+
+		// Zoomed in, only the points of the tiles in the range are read
+		bool zoomed = visible[0] > data_range[0] || visible[1] < data_range[1] ||
+			visible[2] > data_range[2] || visible[3] < data_range[3];
+		if (zoomed && LOD_MIN_LENGTH > 0 && x.size() >= LOD_MIN_LENGTH)
 		{
-			++no_digits;
+			DataView view_x = x, view_y = y;
+			std::vector<double> bounds = data_range;
+			tiles.start([view_x, view_y, bounds](TileIndex& index,
+				const std::atomic<bool>& cancelled)
+			{ return index.build(view_x, view_y, bounds, cancelled); });
+
+			const TileIndex *index = tiles.get();
+			if (index && index->partial(visible))
+			{
+				if (visible_range != visible)
+				{
+					CPPLOT_TRACE_SCOPE("Scatter::query");
+					visible_x.clear();
+					visible_y.clear();
+					index->query(x, y, visible, visible_x, visible_y);
+					visible_range = visible;
+				}
+				else
+				{
+					CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+				}
+
+				if (!visible_x.empty())
+				{
+					CPPLOT_TRACE_COUNT(TRACE_POINTS, visible_x.size());
+					render_pointer->renderPoints(canvas, DataView(visible_x),
+						DataView(visible_y), rect, range);
+				}
+
+				return;
+			}
 		}
 
-		return no_digits;
+		CPPLOT_TRACE_COUNT(TRACE_POINTS, x.size());
+		render_pointer->renderPoints(canvas, x, y, rect, range);
 	}
 
-	inline void set_format(char *format, double value, bool scientific)
+	void Scatter::own()
 	{
-		if (!scientific)
+		if (owned)
 		{
+			return;
+		}
 
-			int int_digits = get_int_digits(value);
-			int frac_digits = get_frac_digits(value, MIN_RANGE_DIFF + 1);
-			int all_digits = int_digits + frac_digits;
+		owned_x.resize(x.size());
+		owned_y.resize(y.size());
+		x.read(0, x.size(), owned_x.data());
+		y.read(0, y.size(), owned_y.data());
+		owned = true;
 
-			// minus one for the dot in case the number has fractional digits
-			if (frac_digits)
-			{
-				--frac_digits;
-				--all_digits;
-			}
+		x = DataView(owned_x);
+		y = DataView(owned_y);
+	}
 
-			format[0] = '%';
-			snprintf(&format[1], 2, "%u", all_digits);
-			format[2] = '.';
-			snprintf(&format[3], 2, "%u", frac_digits);
-			format[4] = 'f';
-			format[5] = '\0';
+	bool Scatter::append(double in_x, double in_y, std::vector<double>& range)
+	{
+		if (ring.get_capacity())
+		{
+			ring.push(in_x, in_y);
+			ring.get_range(data_range);
 		}
 		else
 		{
-			format[0] = '%';
-			snprintf(&format[1], 2, "%u", 1);
-			format[2] = '.';
-			snprintf(&format[3], 2, "%u", SCIENTIFIC_FRAC_DIGITS);
-			format[4] = 'e';
-			format[5] = '\0';
+			tiles.reset();
+			visible_range.clear();
+
+			this->own();
+			owned_x.push_back(in_x);
+			owned_y.push_back(in_y);
+			x = DataView(owned_x);
+			y = DataView(owned_y);
+
+			data_range[0] = data_range[0] < in_x ? data_range[0] : in_x;
+			data_range[1] = data_range[1] > in_x ? data_range[1] : in_x;
+			data_range[2] = data_range[2] < in_y ? data_range[2] : in_y;
+			data_range[3] = data_range[3] > in_y ? data_range[3] : in_y;
 		}
-	}
 
-	// Global variables
-	namespace Globals
-	{
-		// Maximum length of the ID (as wchar) of the Figure
-		static constexpr int size = 10;
-
-		// Buffer holding ID of the Figure
-		static wchar_t FigureName[size];
+		range = data_range;
 
-		// ID of the current Figure
-		static int id = 0;
+		return true;
+	}
 
-		// Pointer to current Figure object
-		static cpplot::Figure *figure = nullptr;
+	bool Scatter::set_capacity(size_t capacity, std::vector<double>& range)
+	{
+		tiles.reset();
+		visible_range.clear();
 
-		// Pointer to directory for saving the image
-		static wchar_t *dir = nullptr;
+		// Collect the current points from the oldest
+		if (ring.get_capacity())
+		{
+			ring.unroll(owned_x, owned_y);
+			owned = true;
+		}
+		else
+		{
+			this->own();
+		}
 
-		// Type of the saved image
-		static wchar_t* ext = nullptr;
-	};
+		ring = RingBuffer(capacity);
+		if (capacity)
+		{
+			// Move the newest points to the ring buffer
+			size_t begin = owned_x.size() > capacity ? owned_x.size() - capacity : 0;
+			for (size_t i = begin; i < owned_x.size(); ++i)
+			{
+				ring.push(owned_x[i], owned_y[i]);
+			}
 
-	// ABC
-	class Graph
-	{
-	public:
-		Graph(COLORREF in_color, int in_size) :
-			color(in_color), size(in_size), render_pointer(nullptr), 
-			ownership_render_pointer(true) {};
+			owned_x.clear();
+			owned_y.clear();
+			ring.get_range(data_range);
+		}
 
-		Graph(COLORREF in_color, int in_size, RenderObjects *render_ptr) :
-			color(in_color), size(in_size), render_pointer(render_ptr),
-			ownership_render_pointer(false) {};
+		x = DataView(owned_x);
+		y = DataView(owned_y);
 
-		virtual void show(HDC hdc, HWND hwnd, RECT rect,
-			const std::vector<double>& range) const = 0;
+		range = data_range;
 
-		virtual ~Graph() = default;
+		return true;
+	}
 
-	protected:
-		COLORREF color;
-		int size;
-		RenderObjects *render_pointer;
+	Scatter::~Scatter()
+	{
+		// Wait for the build reading the points
+		tiles.reset();
 
-		bool ownership_render_pointer;
-	};
+		if (ownership_render_pointer)
+		{
+			delete render_pointer;
+		}
+	}
 
-	// Derived class for scatterplots
-	class Scatter : public Graph
+	// Derived class for line plots
+	class Line : public Graph
 	{
 	public:
-		Scatter(const std::vector<double>& in_x,
-			const std::vector<double>& in_y, int in_size,
+		Line(const DataView& in_x, const DataView& in_y, int in_size,
 			COLORREF in_color, std::vector<double>& range,
 			RenderObjects *render_ptr);
 
 		// Non-constant c-ctor because the ownership of resources
 		// transfers during the copying
-		Scatter(Scatter& scatter);
+		Line(Line& line);
 
-		virtual void show(HDC hdc, HWND hwnd, RECT rect,
+		virtual void show(Canvas *canvas, RECT rect,
 			const std::vector<double>& range) const;
 
-		virtual ~Scatter();
+		virtual bool append(double in_x, double in_y, std::vector<double>& range);
+
+		virtual bool set_capacity(size_t capacity, std::vector<double>& range);
+
+		virtual void flush();
+
+		virtual ~Line();
 
 	private:
-		std::vector<double> x, y;
+		// Set the points from the input sorted by x
+		void assign(const DataView& in_x, const DataView& in_y);
+
+		// Copy the viewed points to owned_x and owned_y
+		void own();
+
+		// Reduce the points to the first, minimal, maximal and last point 
+		// of every pixel column of the rectangle
+		void reduce(RECT rect, const std::vector<double>& range) const;
+
+		// Reduce only the pixel columns inside the rectangle, finding their
+		// points by binary search and their extremes in the pyramid
+		void reduce(RECT rect, const std::vector<double>& range,
+			const MinMaxPyramid& lod) const;
+
+		// Append the points of a column at the positions in their original order
+		void emit(size_t first, size_t min, size_t max, size_t last) const;
+
+		// Points sorted by x -> a view of the input if its x values are 
+		// increasing, otherwise of the sorted copy in owned_x and owned_y
+		DataView x, y;
+		std::vector<double> owned_x, owned_y;
+		bool owned;
+		size_t shown_begin; // position of the viewed points in owned_x and owned_y
+
+		std::vector<double> data_range; // min_x, max_x, min_y, max_y of the data
+
+		// Newest points in the order of appending if the capacity is limited,
+		// x and y are rebuilt from them by flush
+		RingBuffer ring;
+		bool ring_changed;
+		size_t ring_appended; // points appended since the last flush
+		bool ring_shown; // whether x and y are the ring in its order, then flush only appends to them
+
+		// Reduced points and the rectangle and range they were reduced for
+		mutable std::vector<double> reduced_x, reduced_y;
+		mutable RECT reduced_rect;
+		mutable std::vector<double> reduced_range;
+
+		// Min/max pyramid of y, built in the background once the points are
+		// reduced for a second viewport, and the number of the reductions
+		mutable LazyIndex<MinMaxPyramid> pyramid;
+		mutable size_t reductions;
 	};
 
-	Scatter::Scatter(const std::vector<double>& in_x,
-		const std::vector<double>& in_y, int in_size,
+	Line::Line(const DataView& in_x, const DataView& in_y, int in_size,
 		COLORREF in_color, std::vector<double>& range,
-		RenderObjects *render_ptr) : x{ in_x }, y{ in_y }, 
-		Graph(in_color, in_size, render_ptr)
+		RenderObjects *render_ptr) : Graph(in_color, in_size, render_ptr),
+		owned(false), shown_begin(0), ring_changed(false), ring_appended(0),
+		ring_shown(false), reduced_rect(), reductions(0)
 	{
+		CPPLOT_TRACE_SCOPE("Line::Line");
+
 		// Initialize a RenderObjects instance and affirm 
 		// the ownership of the resources
 		if (!render_ptr)
 		{
-			render_pointer = new RenderScatterPoints();
+			render_pointer = new RenderLinesFull();
 
 			ownership_render_pointer = true;
 		}
 
+		size_t length = in_x.size() < in_y.size() ? in_x.size() : in_y.size();
+		this->assign(in_x.slice(0, length), in_y.slice(0, length));
+
 		// Find min and max of x and y 
-		double max_x = *std::max_element(x.begin(), x.end());
-		double min_x = *std::min_element(x.begin(), x.end());
-		double max_y = *std::max_element(y.begin(), y.end());
-		double min_y = *std::min_element(y.begin(), y.end());
+		data_range = { INFINITY, -INFINITY, INFINITY, -INFINITY };
+		if (!x.empty())
+		{
+			data_range[0] = x[0];
+			data_range[1] = x[x.size() - 1];
+			minmax(y, data_range[2], data_range[3]);
+		}
 
 		// Set x and y range for Window member range
-		range[0] = range[0] < min_x ? range[0] : min_x;
-		range[1] = range[1] > max_x ? range[1] : max_x;
-		range[2] = range[2] < min_y ? range[2] : min_y;
-		range[3] = range[3] > max_y ? range[3] : max_y;
+		range[0] = range[0] < data_range[0] ? range[0] : data_range[0];
+		range[1] = range[1] > data_range[1] ? range[1] : data_range[1];
+		range[2] = range[2] < data_range[2] ? range[2] : data_range[2];
+		range[3] = range[3] > data_range[3] ? range[3] : data_range[3];
 	}
 
-	Scatter::Scatter(Scatter& scatter) : x(scatter.x), y(scatter.y),
-		Graph(scatter.color, scatter.size, scatter.render_pointer)
+	void Line::assign(const DataView& in_x, const DataView& in_y)
 	{
-		ownership_render_pointer = scatter.ownership_render_pointer;
-		scatter.ownership_render_pointer = false;
+		// Drop the reduction and the pyramid of the previous points
+		reduced_x.clear();
+		reduced_y.clear();
+		pyramid.reset();
+		reductions = 0;
+		shown_begin = 0;
+
+		size_t length = in_x.size();
+		bool increasing = true, sorted = true;
+		for (size_t i = 1; i < length && sorted; ++i)
+		{
+			double previous = in_x[i - 1], current = in_x[i];
+			increasing = increasing && previous < current;
+			sorted = !(current < previous);
+		}
+
+		// Increasing x values are used without copying
+		if (increasing)
+		{
+			x = in_x;
+			y = in_y;
+			owned = false;
+
+			return;
+		}
+
+		std::vector<double> sorted_x, sorted_y;
+		sorted_x.reserve(length);
+		sorted_y.reserve(length);
+
+		// Points with equal x values are merged and the last of them is kept
+		if (sorted)
+		{
+			for (size_t i = 0; i != length; ++i)
+			{
+				if (i + 1 != length && in_x[i + 1] == in_x[i])
+				{
+					continue;
+				}
+
+				sorted_x.push_back(in_x[i]);
+				sorted_y.push_back(in_y[i]);
+			}
+		}
+		else
+		{
+			// Sort the positions by x -> ties are ordered by position, 
+			// so that the last of the equal x values can be found
+			std::vector<std::pair<double, size_t>> order(length);
+			for (size_t i = 0; i != length; ++i)
+			{
+				order[i] = std::make_pair(in_x[i], i);
+			}
+
+			Parallel::sort(order.begin(), order.end(),
+				[](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b)
+			{ return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+			for (size_t i = 0; i != length; ++i)
+			{
+				if (i + 1 != length && order[i + 1].first == order[i].first)
+				{
+					continue;
+				}
+
+				sorted_x.push_back(order[i].first);
+				sorted_y.push_back(in_y[order[i].second]);
+			}
+		}
+
+		// The input may be a view of the owned points
+		owned_x.swap(sorted_x);
+		owned_y.swap(sorted_y);
+		owned = true;
+
+		x = DataView(owned_x);
+		y = DataView(owned_y);
+	}
+
+	Line::Line(Line& line) : Graph(line.color, line.size, line.render_pointer),
+		x(line.x), y(line.y), owned_x(line.owned_x), owned_y(line.owned_y),
+		owned(line.owned), shown_begin(line.shown_begin), data_range(line.data_range),
+		ring(line.ring), ring_changed(line.ring_changed), ring_appended(line.ring_appended),
+		ring_shown(line.ring_shown), reduced_rect(), reductions(0)
+	{
+		if (owned)
+		{
+			x = DataView(owned_x).slice(shown_begin, line.x.size());
+			y = DataView(owned_y).slice(shown_begin, line.y.size());
+		}
+
+		ownership_render_pointer = line.ownership_render_pointer;
+		line.ownership_render_pointer = false;
+	}
+
+	void Line::show(Canvas *canvas, RECT rect,
+		const std::vector<double>& range) const
+	{
+		CPPLOT_TRACE_SCOPE("Line::show");
+
+		if (x.empty())
+		{
+			return;
+		}
+
+		// Set appropriate graph properties and draw the lines
+		canvas->select_pen(color, size);
+
+		// In case there are more points than pixel columns, draw only the points
+		// that change the output -> the reduction is kept until the rectangle
+		// or the range changes
+		if (render_pointer->isReducible() && range[1] > range[0] &&
+			x.size() > 4 * (size_t)(rect.right - rect.left + 1))
+		{
+			if (reduced_x.empty() || reduced_range != range ||
+				memcmp(&reduced_rect, &rect, sizeof(RECT)) != 0)
+			{
+				CPPLOT_TRACE_SCOPE("Line::reduce");
+				const MinMaxPyramid *lod = pyramid.get();
+				if (lod)
+				{
+					this->reduce(rect, range, *lod);
+				}
+				else
+				{
+					this->reduce(rect, range);
+				}
+
+				reduced_rect = rect;
+				reduced_range = range;
+
+				// The viewport changes, e.g. by zooming or resizing, so the pyramid
+				// replaces the reading of all the points by further reductions
+				if (++reductions == 2 && LOD_MIN_LENGTH > 0 && x.size() >= LOD_MIN_LENGTH)
+				{
+					DataView values = y;
+					pyramid.start([values](MinMaxPyramid& index,
+						const std::atomic<bool>& cancelled)
+					{ return index.build(values, cancelled); });
+				}
+			}
+			else
+			{
+				CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			}
+
+			CPPLOT_TRACE_COUNT(TRACE_POINTS, reduced_x.size());
+
+			render_pointer->renderLines(canvas, DataView(reduced_x),
+				DataView(reduced_y), rect, range);
+
+			return;
+		}
+		
+		CPPLOT_TRACE_COUNT(TRACE_POINTS, x.size());
+		render_pointer->renderLines(canvas, x, y, rect, range);
 	}
 
-	void Scatter::show(HDC hdc, HWND hwnd, RECT rect,
-		const std::vector<double>& range) const
-	{
-		// Set appropriate graph properties
-		HPEN hGraphPen = CreatePen(PS_SOLID, size, color);
-		HBRUSH hGraphBrush = CreateSolidBrush(color);
-		HPEN hGraphPreviousPen = (HPEN)SelectObject(hdc, hGraphPen);
-		HBRUSH hGraphPreviousBrush = (HBRUSH)SelectObject(hdc, hGraphBrush);
-		
-		render_pointer->renderPoints(hdc, x, y, rect, range);
+	void Line::own()
+	{
+		if (owned)
+		{
+			return;
+		}
+
+		owned_x.resize(x.size());
+		owned_y.resize(y.size());
+		x.read(0, x.size(), owned_x.data());
+		y.read(0, y.size(), owned_y.data());
+		owned = true;
+
+		x = DataView(owned_x);
+		y = DataView(owned_y);
+	}
+
+	bool Line::append(double in_x, double in_y, std::vector<double>& range)
+	{
+		if (ring.get_capacity())
+		{
+			ring.push(in_x, in_y);
+			ring.get_range(data_range);
+			ring_changed = true;
+			++ring_appended;
+
+			range = data_range;
+
+			return true;
+		}
+
+		// Keep x sorted, a point with an existing x value replaces the previous one
+		pyramid.reset();
+		reductions = 0;
+
+		this->own();
+		if (owned_x.empty() || in_x > owned_x.back())
+		{
+			owned_x.push_back(in_x);
+			owned_y.push_back(in_y);
+		}
+		else
+		{
+			size_t position = 
+				std::lower_bound(owned_x.begin(), owned_x.end(), in_x) - owned_x.begin();
+			if (owned_x[position] == in_x)
+			{
+				owned_y[position] = in_y;
+			}
+			else
+			{
+				owned_x.insert(owned_x.begin() + position, in_x);
+				owned_y.insert(owned_y.begin() + position, in_y);
+			}
+		}
+
+		x = DataView(owned_x);
+		y = DataView(owned_y);
+
+		reduced_x.clear();
+		reduced_y.clear();
+
+		// The range is only extended, even if a replaced y value was an extreme
+		data_range[0] = data_range[0] < in_x ? data_range[0] : in_x;
+		data_range[1] = data_range[1] > in_x ? data_range[1] : in_x;
+		data_range[2] = data_range[2] < in_y ? data_range[2] : in_y;
+		data_range[3] = data_range[3] > in_y ? data_range[3] : in_y;
+
+		range = data_range;
+
+		return true;
+	}
+
+	bool Line::set_capacity(size_t capacity, std::vector<double>& range)
+	{
+		// The order of appending is lost for the sorted points, 
+		// so they enter the ring buffer sorted by x
+		pyramid.reset();
+		reductions = 0;
+
+		std::vector<double> current_x, current_y;
+		if (ring.get_capacity())
+		{
+			ring.unroll(current_x, current_y);
+		}
+		else
+		{
+			this->own();
+			current_x.swap(owned_x);
+			current_y.swap(owned_y);
+		}
+
+		ring = RingBuffer(capacity);
+		if (capacity)
+		{
+			size_t begin = current_x.size() > capacity ? current_x.size() - capacity : 0;
+			for (size_t i = begin; i < current_x.size(); ++i)
+			{
+				ring.push(current_x[i], current_y[i]);
+			}
+
+			ring.get_range(data_range);
+			ring_changed = true;
+		}
+		else
+		{
+			this->assign(DataView(current_x), DataView(current_y));
+			this->own();
+			ring_changed = false;
+		}
+
+		ring_appended = 0;
+		ring_shown = false;
+
+		range = data_range;
+
+		return true;
+	}
+
+	void Line::flush()
+	{
+		if (!ring_changed)
+		{
+			return;
+		}
+
+		// Points appended with increasing x values follow the shown ones, of 
+		// which the overwritten are the oldest -> only the appended are copied
+		if (ring_shown && ring.is_increasing() && ring_appended < ring.size())
+		{
+			reduced_x.clear();
+			reduced_y.clear();
+			pyramid.reset();
+			reductions = 0;
+
+			shown_begin += x.size() - (ring.size() - ring_appended);
+
+			// The overwritten points are dropped once they fill half of the storage
+			if (shown_begin > owned_x.size() / 2)
+			{
+				owned_x.erase(owned_x.begin(), owned_x.begin() + shown_begin);
+				owned_y.erase(owned_y.begin(), owned_y.begin() + shown_begin);
+				shown_begin = 0;
+			}
+
+			ring.append_newest(ring_appended, owned_x, owned_y);
+			x = DataView(owned_x).slice(shown_begin, ring.size());
+			y = DataView(owned_y).slice(shown_begin, ring.size());
+		}
+		else
+		{
+			std::vector<double> current_x, current_y;
+			ring.unroll(current_x, current_y);
+
+			// The unrolled points are temporary, so they must be owned
+			this->assign(DataView(current_x), DataView(current_y));
+			this->own();
+
+			ring_shown = ring.is_increasing();
+		}
+
+		ring_changed = false;
+		ring_appended = 0;
+	}
+
+	void Line::reduce(RECT rect, const std::vector<double>& range) const
+	{
+		// Pixel columns must be computed exactly as in the RenderObjects, the 
+		// points far outside of the rect are clamped to the columns of its band
+		PixelMap map(rect, range);
+
+		struct Column
+		{
+			int pixel;
+			size_t first, min, max, last; // positions of the points
+		};
+
+		// Find the columns of individual chunks of the data in parallel
+		size_t length = x.size();
+		size_t chunks = Parallel::chunk_count(length);
+		std::vector<std::vector<Column>> columns(chunks);
+
+		Parallel::for_chunks(length, chunks, [&](size_t index, size_t begin, size_t end)
+		{
+			std::vector<Column>& local_columns = columns[index];
+
+			for (size_t i = begin; i != end; ++i)
+			{
+				int pixel = map.clamp_x(x[i]);
+
+				if (local_columns.empty() || local_columns.back().pixel != pixel)
+				{
+					local_columns.push_back(Column{ pixel, i, i, i, i });
+					continue;
+				}
+
+				Column& column = local_columns.back();
+				column.last = i;
+				column.min = y[i] < y[column.min] ? i : column.min;
+				column.max = y[i] > y[column.max] ? i : column.max;
+			}
+		});
 
-		// Clean graphic objects
-		DeleteObject(hGraphPen);
-		DeleteObject(hGraphBrush);
+		reduced_x.clear();
+		reduced_y.clear();
 
-		// Set previous graphic properties
-		SelectObject(hdc, hGraphPreviousPen);
-		SelectObject(hdc, hGraphPreviousBrush);
-	}
+		// Join the columns that were split between the chunks
+		bool started = false;
+		Column current = Column();
+		for (size_t i = 0; i != chunks; ++i)
+		{
+			for (size_t j = 0; j != columns[i].size(); ++j)
+			{
+				const Column& column = columns[i][j];
 
-	Scatter::~Scatter()
-	{
-		if (ownership_render_pointer)
+				if (!started)
+				{
+					current = column;
+					started = true;
+				}
+				else if (column.pixel == current.pixel)
+				{
+					current.last = column.last;
+					current.min = y[column.min] < y[current.min] ? column.min : current.min;
+					current.max = y[column.max] > y[current.max] ? column.max : current.max;
+				}
+				else
+				{
+					this->emit(current.first, current.min, current.max, current.last);
+					current = column;
+				}
+			}
+		}
+
+		if (started)
 		{
-			delete render_pointer;
+			this->emit(current.first, current.min, current.max, current.last);
 		}
 	}
 
-	// Derived class for line plots
-	class Line : public Graph
+	void Line::reduce(RECT rect, const std::vector<double>& range,
+		const MinMaxPyramid& lod) const
 	{
-	public:
-		Line(const std::vector<double>& in_x,
-			const std::vector<double>& in_y, int in_size,
-			COLORREF in_color, std::vector<double>& range,
-			RenderObjects *render_ptr);
+		PixelMap map(rect, range);
+		size_t length = x.size();
 
-		// Non-constant c-ctor because the ownership of resources
-		// transfers during the copying
-		Line(Line& line);
+		// Columns clamped to the band around the rect, which stay monotonic
+		// for the points far outside of the rect of a zoomed view
+		auto pixel = [&](size_t i)
+		{
+			return map.clamp_x(x[i]);
+		};
 
-		virtual void show(HDC hdc, HWND hwnd, RECT rect,
-			const std::vector<double>& range) const;
+		// First position from begin in the column or right of it -> the 
+		// columns of the sorted points are non-decreasing
+		auto lower = [&](int column, size_t begin)
+		{
+			size_t low = begin, high = length;
+			while (low < high)
+			{
+				size_t middle = low + (high - low) / 2;
+				if (pixel(middle) < column)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
 
-		virtual ~Line();
+			return low;
+		};
 
-	private:
-		std::map<double, double> data;
-	};
+		reduced_x.clear();
+		reduced_y.clear();
 
-	Line::Line(const std::vector<double>& in_x,
-		const std::vector<double>& in_y, int in_size,
-		COLORREF in_color, std::vector<double>& range,
-		RenderObjects *render_ptr) : Graph(in_color, in_size, render_ptr)
-	{
-		// Initialize a RenderObjects instance and affirm 
-		// the ownership of the resources
-		if (!render_ptr)
+		// The last point left of the rectangle leads the line to its edge
+		size_t begin = lower(rect.left, 0);
+		if (begin != 0)
 		{
-			render_pointer = new RenderLinesFull();
-
-			ownership_render_pointer = true;
+			this->emit(begin - 1, begin - 1, begin - 1, begin - 1);
 		}
 
-		for (int i = 0; i != in_x.size(); ++i)
+		while (begin != length)
 		{
-			data[in_x[i]] = in_y[i]; // TODO : OPTIMIZE
-		}
+			int column = pixel(begin);
+			if (column > rect.right)
+			{
+				// The first point right of the rectangle leads the line out of it
+				this->emit(begin, begin, begin, begin);
+				break;
+			}
 
-		// Find min and max of x and y 
-		double min_x = data.begin()->first;
-		double max_x = (--data.end())->first;
-		double max_y = std::max_element(data.begin(), data.end(),
-			[](const std::pair<double, double>& a, const std::pair<double, double>&b)
-		{ return a.second < b.second;  })->second;
-		double min_y = std::min_element(data.begin(), data.end(),
-			[](const std::pair<double, double>& a, const std::pair<double, double>&b)
-		{ return a.second < b.second;  })->second;
+			size_t end = lower(column + 1, begin);
 
-		// Set x and y range for Window member range
-		range[0] = range[0] < min_x ? range[0] : min_x;
-		range[1] = range[1] > max_x ? range[1] : max_x;
-		range[2] = range[2] < min_y ? range[2] : min_y;
-		range[3] = range[3] > max_y ? range[3] : max_y;
-	}
+			size_t min, max;
+			lod.query(y, begin, end, min, max);
+			this->emit(begin, min, max, end - 1);
 
-	Line::Line(Line& line) : data(line.data),
-		Graph(line.color, line.size, line.render_pointer)
-	{
-		ownership_render_pointer = line.ownership_render_pointer;
-		line.ownership_render_pointer = false;
+			begin = end;
+		}
 	}
 
-	void Line::show(HDC hdc, HWND hwnd, RECT rect,
-		const std::vector<double>& range) const
+	void Line::emit(size_t first, size_t min, size_t max, size_t last) const
 	{
-		// Set appropriate graph properties and draw the lines
-		HPEN hGraphPen = CreatePen(PS_SOLID, size, color);
-		HPEN hGraphPreviousPen = (HPEN)SelectObject(hdc, hGraphPen);
-		
-		render_pointer->renderLines(hdc, data, rect, range);
-
-		// Delete graphics objects
-		DeleteObject(hGraphPen);
+		// Keep the points of a column in their original order, so that the 
+		// polyline passes through the same pixels as the full one
+		size_t positions[4] = { first, min, max, last };
+		std::sort(positions, positions + 4);
 
-		// Set previous graphic properties
-		SelectObject(hdc, hGraphPreviousPen);
+		for (int i = 0; i != 4; ++i)
+		{
+			if (i == 0 || positions[i] != positions[i - 1])
+			{
+				reduced_x.push_back(x[positions[i]]);
+				reduced_y.push_back(y[positions[i]]);
+			}
+		}
 	}
 
 	Line::~Line()
 	{
+		// Wait for the build reading the points
+		pyramid.reset();
+
 		if (ownership_render_pointer)
 		{
 			delete render_pointer;
 		}
 	}
 
+	/*
+	Histogram of the data counted to bins. The data are not kept, so further
+	chunks of values can be added to it. The bins are either fixed or, for data
+	of an unknown range, adapted by a sketch of a fixed number of bins. The
+	normalization is applied to the counts when the histogram is shown.
+	*/
 	class Histogram : public Graph
 	{
 	public:
-		Histogram(const std::vector<double>& in_x, const std::vector<double>& bins,
+		Histogram(const DataView& in_x, const std::vector<double>& bins,
 			int in_size,COLORREF in_color, bool normed, std::vector<double>& range);
 
-		Histogram(const std::vector<double>& in_x, int bins, const std::vector<double>&
+		Histogram(const DataView& in_x, int bins, const std::vector<double>&
 			max_min_range, int in_size, COLORREF in_color, bool normed,
 			std::vector<double>& range);
 
-		virtual void initialize(const std::vector<double>& in_x,
-			const std::vector<double>& bins, int in_size, COLORREF in_color, 
-			bool normed, std::vector<double>& range);
+		// Empty histogram of fixed bins
+		Histogram(const std::vector<double>& bins, int in_size, COLORREF in_color,
+			bool normed);
 
-		virtual void show(HDC hdc, HWND hwnd, RECT rect,
+		// Empty histogram of bins adapted to the added data
+		Histogram(int bins, int in_size, COLORREF in_color, bool normed);
+
+		virtual bool add(const DataView& data, std::vector<double>& range);
+
+		virtual void show(Canvas *canvas, RECT rect,
 			const std::vector<double>& range) const;
 
 		virtual ~Histogram() = default;
 
 	private:
-		std::vector<double> x, y, bin_pos;
+		// Height of the bar of the i-th bin
+		double height(size_t i) const;
+
+		std::vector<double> bin_pos;
+		std::vector<unsigned long long> counts;
+		unsigned long long total; // number of the counted values
+		bool normed;
+		std::unique_ptr<BinSketch> sketch; // nullptr for fixed bins
+
+		mutable std::vector<RECT> bars; // rectangles of the bins, kept between the shows
 	};
 
-	Histogram::Histogram(const std::vector<double>& in_x,
+	Histogram::Histogram(const DataView& in_x,
 		const std::vector<double>& bins, int in_size, COLORREF in_color, 
-		bool normed, std::vector<double>& range) : x(in_x), y(bins),
-		bin_pos(bins), Graph(in_color, in_size)
+		bool normed, std::vector<double>& range) : 
+		Histogram(bins, in_size, in_color, normed)
 	{
-		this->initialize(in_x, bins, in_size, in_color, normed, range);
-
-		double max_y = *std::max_element(y.begin(), y.end(),
-			[](const double& a, const double& b)
-		{ return a < b;  });
-
-		// Set x and y range for Window member range
-		range[0] = range[0] < x.front() ? range[0] : x.front();
-		range[1] = range[1] > x.back() ? range[1] : x.back();
-		range[2] = range[2] < 0.0 ? range[2] : 0.0;
-		range[3] = range[3] > max_y ? range[3] : max_y;
+		this->add(in_x, range);
 	}
 
-	Histogram::Histogram(const std::vector<double>& in_x,
+	Histogram::Histogram(const DataView& in_x,
 		int bins, const std::vector<double>& max_min_range, 
 		int in_size, COLORREF in_color,
 		bool normed, std::vector<double>& range) : 
-		x(in_x), y(bins, 0.0), Graph(in_color, in_size)
+		Graph(in_color, in_size), total(0), normed(normed)
 	{
+		CPPLOT_TRACE_SCOPE("Histogram::Histogram");
+
 		// Find the max of x
 		double min_x, max_x;
 		if (max_min_range.empty())
 		{
-			min_x = *std::min_element(in_x.begin(), in_x.end(),
-				[](const double& a, const double& b)
-			{ return a < b;  });
-			max_x = *std::max_element(in_x.begin(), in_x.end(),
-				[](const double& a, const double& b)
-			{ return a < b;  });
+			minmax(in_x, min_x, max_x);
 		}
 		else
 		{
@@ -398,150 +1044,124 @@ namespace cpplot {
 		{
 			bin_pos[i] = min_x + i * offset;
 		}
+		counts.assign(bins, 0);
 
-		this->initialize(in_x, bin_pos, in_size, in_color, normed, range);
-
-		double max_y = *std::max_element(y.begin(), y.end(),
-			[](const double& a, const double& b)
-		{ return a < b;  });
-
-		range[0] = range[0] < min_x ? range[0] : min_x;
-		range[1] = range[1] > max_x ? range[1] : max_x;
-		range[2] = range[2] < 0.0 ? range[2] : 0.0;
-		range[3] = range[3] > max_y ? range[3] : max_y;
+		this->add(in_x, range);
 	}
 
-	void Histogram::initialize(const std::vector<double>& in_x,
-		const std::vector<double>& bins, int in_size, 
-		COLORREF in_color, bool normed, std::vector<double>& range)
+	Histogram::Histogram(const std::vector<double>& bins, int in_size,
+		COLORREF in_color, bool normed) : Graph(in_color, in_size),
+		total(0), normed(normed)
 	{
-		std::sort(x.begin(), x.end());
+		// Edges are sorted by the binning
+		bin_pos = Binning(bins).get_edges();
+		if (bin_pos.size() < 2)
+		{
+			printf("Warning: Histogram needs at least two bin edges. "
+				"No data are shown.\n");
+			bin_pos.clear();
+		}
 
-		// Find the count of x values in the bucket
-		std::vector<double>::iterator y_iter = y.begin();
-		std::vector<double>::const_iterator bin_pos_iter = ++bin_pos.begin();
-		std::vector<double>::const_iterator x_iter = x.begin();
+		counts.assign(bin_pos.empty() ? 0 : bin_pos.size() - 1, 0);
+	}
 
-		// Find the starting values for x
-		while (*x_iter < (*bin_pos_iter - FP_ERROR)) { x_iter++; }
-	
-		// Fill the bins
-		double sum_y = 0.0;
-		int i = 0;
-		for (; bin_pos_iter != bin_pos.end(); bin_pos_iter++)
-		{
-			while (*x_iter < (*bin_pos_iter - FP_ERROR))
-			{
-				++x_iter;
-				*y_iter += 1.0;
-				sum_y += 1.0;
+	Histogram::Histogram(int bins, int in_size, COLORREF in_color, bool normed) :
+		Graph(in_color, in_size), total(0), normed(normed),
+		sketch(new BinSketch(bins > 0 ? bins : 1)) {}
 
-				if (x_iter == x.end()) { break; }
-			}
+	bool Histogram::add(const DataView& data, std::vector<double>& range)
+	{
+		CPPLOT_TRACE_SCOPE("Histogram::add");
 
-			if (x_iter == x.end()) { break; }
+		// The data are counted in place, without sorting or copying them
+		if (sketch)
+		{
+			sketch->add(data);
+			sketch->get_bins(bin_pos, counts);
+			total = sketch->get_total();
+		}
+		else if (!bin_pos.empty())
+		{
+			total += Binning(bin_pos).count(data, counts);
+		}
 
-			++y_iter;
+		// Set x and y range for Window member range
+		if (!total)
+		{
+			range = { INFINITY, -INFINITY, INFINITY, -INFINITY };
+			return true;
 		}
 
-		// In case there are still values in the x equal to the end of the last bin
-		--y_iter;
-		--bin_pos_iter;
-		while (x_iter != x.end() && *x_iter < (*bin_pos_iter + FP_ERROR))
+		double max_y = 0.0;
+		for (size_t i = 0; i != counts.size(); ++i)
 		{
-			*y_iter += 1.0;
-			sum_y += 1.0;
-			++x_iter;
+			max_y = this->height(i) > max_y ? this->height(i) : max_y;
 		}
 
+		range = { bin_pos.front(), bin_pos.back(), 0.0, max_y };
+
+		return true;
+	}
+
+	double Histogram::height(size_t i) const
+	{
 		// Normalize by dividing by number of observations times bin width
 		if (normed)
 		{
-			for (int i = 0; i != y.size(); ++i)
-			{
-				y[i] /= sum_y * (bin_pos[i + 1] - bin_pos[i]);
-			}
+			return counts[i] / (total * (bin_pos[i + 1] - bin_pos[i]));
 		}
+
+		return (double)counts[i];
 	}
 
-	void Histogram::show(HDC hdc, HWND hwnd, RECT rect,
+	void Histogram::show(Canvas *canvas, RECT rect,
 		const std::vector<double>& range) const
 	{
-		double adj_min_x = range[0];
-		double adj_max_x = range[1];
-		double adj_min_y = range[2];
-		double adj_max_y = range[3];
+		CPPLOT_TRACE_SCOPE("Histogram::show");
+		CPPLOT_TRACE_COUNT(TRACE_POINTS, counts.size());
 
-		// Pre-compute variables
-		double win_length_x = rect.right - rect.left;
-		double win_length_y = rect.bottom - rect.top;
-		double length_x = adj_max_x - adj_min_x;
-		double length_y = adj_max_y - adj_min_y;
+		// The bars of a zoomed view are clamped to the band around the rect
+		PixelMap map(rect, range);
 
 		// Set appropriate graph properties
-		HPEN hGraphPen = CreatePen(PS_SOLID, size, BLACK);
-		HBRUSH hGraphBrush = CreateSolidBrush(color);
-		HPEN hGraphPreviousPen = (HPEN)SelectObject(hdc, hGraphPen);
-		HBRUSH hGraphPreviousBrush = (HBRUSH)SelectObject(hdc, hGraphBrush);
-
-		// Render the histogram rectangles
-		RECT bin_rect;
-		bin_rect.bottom = rect.bottom -
-			(int)round((0.0 - adj_min_y) * win_length_y / length_y);
-		for (int i = 0; i != bin_pos.size() - 1; i++)
-		{
-			bin_rect.left = rect.left +
-				(int)round((bin_pos[i] - adj_min_x) * win_length_x / length_x);
-			bin_rect.right = rect.left +
-				(int)round((bin_pos[i + 1] - adj_min_x) * win_length_x / length_x);
-			bin_rect.top = rect.bottom -
-				(int)round((y[i] - adj_min_y) * win_length_y / length_y);
-			Rectangle(hdc, bin_rect.left, bin_rect.top, bin_rect.right, bin_rect.bottom);
-		}
+		canvas->select_pen(BLACK, size);
+		canvas->select_brush(color);
 
-		// Delete graphics objects
-		DeleteObject(hGraphPen);
-		DeleteObject(hGraphBrush);
+		// Render the histogram rectangles in a single batch
+		int bottom = map.clamp_y(0.0);
+		bars.resize(counts.size());
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			bars[i].left = map.clamp_x(bin_pos[i]);
+			bars[i].right = map.clamp_x(bin_pos[i + 1]);
+			bars[i].top = map.clamp_y(this->height(i));
+			bars[i].bottom = bottom;
+		}
 
-		// Set previous graphic properties
-		SelectObject(hdc, hGraphPreviousPen);
-		SelectObject(hdc, hGraphPreviousBrush);
+		canvas->rectangles(bars.data(), (int)bars.size());
 	}
 	
 	class Axis
 	{
 	public:
-		Axis() : legend_state{ false }, x_value_state{ false }, y_value_state{ false } {};
+		Axis() : legend_state{ false } {};
 
-		void show_ticks(HDC hdc, HWND hwnd, RECT x_rect, RECT y_rect,
-			std::vector<double> range, HFONT font); // range by value!
+		// Draw the ticks and the values of both axes laid out by the layout
+		void show_ticks(Canvas *canvas, const WindowLayout& layout) const;
 
-		void show_ticks_internal(HDC hdc, HWND hwnd, RECT rect,	std::vector<double>
-			range, TEXTMETRIC textMetric, RenderAxis *render, bool axis);
+		void show_title(Canvas *canvas, RECT rect) const;
 
-		void tick_value_map(double diff, double& y_tick_period_adj,
-			double& y_value_period_adj);
+		// Draw the label of the x axis, followed by the add-on of its values if any
+		void show_xlabel(Canvas *canvas, RECT rect, const char *add_on = "") const;
 
-		void show_title(HDC hdc, HWND hwnd, RECT rect, HFONT font) const;
+		// Draw the label of the y axis, followed by the add-on of its values if any
+		void show_ylabel(Canvas *canvas, RECT rect, const char *add_on = "") const;
 
-		void show_xlabel(HDC hdc, HWND hwnd, RECT rect, HFONT font) const;
+		void show_legend(Canvas *canvas, RECT rect, int text_width,
+			int text_height) const;
 
-		void show_ylabel(HDC hdc, HWND hwnd, RECT rect, HFONT font) const;
-
-		void show_legend(HDC hdc, HWND hwnd, RECT rect, HFONT font,
-			int text_width, int text_height) const;
-
-		double tick_xoffset(int text_height) const;
-
-		double label_xoffset(int text_height) const;
-
-		double tick_yoffset(int text_height) const;
-
-		double label_yoffset(int text_height) const;
-
-		double title_offset(int text_height) const;
-
-		double legend_offset(HDC hdc, int text_width, int base) const;
+		// Number of characters of the longest name of the legend
+		int legend_length() const;
 
 		void set_xlabel(std::string xlab) { xlabel = xlab; }
 
@@ -572,7 +1192,7 @@ namespace cpplot {
 
 			LEGEND(std::string in_name, std::string in_type, COLORREF in_color,
 				int in_size) : name(in_name), type(in_type), color(in_color),
-				size(in_size), render_pointer(nullptr) {};
+				size(in_size), render_pointer(nullptr), ownership_render_pointer(false) {};
 
 			LEGEND(std::string in_name, std::string in_type, COLORREF in_color,
 				int in_size, RenderObjects *render_ptr);
@@ -585,6 +1205,8 @@ namespace cpplot {
 				legend.ownership_render_pointer = false;
 			}
 
+			LEGEND(LEGEND&& legend) : LEGEND(legend) {};
+
 			~LEGEND();
 
 			std::string name;
@@ -603,9 +1225,6 @@ namespace cpplot {
 
 		// whether the legend has been activated
 		bool legend_state;
-
-		// whether values on x/y axis have already been adjusted for scientific notation
-		bool x_value_state, y_value_state; 
 	};
 
 	Axis::LEGEND::LEGEND(std::string in_name, std::string in_type, 
@@ -645,403 +1264,121 @@ namespace cpplot {
 		}
 	}
 
-	void Axis::tick_value_map(double diff, double& y_tick_period_adj, 
-		double& y_value_period_adj)
-	{
-		// nothing, multication or division group
-		int y_op_sign = 0;
-		double y_factor = 0.0;
-
-		// Find the multiplicative/divisive factor
-		if ((diff + FP_ERROR) < 10.0)
-		{
-			y_op_sign = 1;
-
-			y_factor += 1.0;
-			diff *= 10.0;
-
-			while ((diff + FP_ERROR) < 10.0)
-			{
-				y_factor += 1.0;
-				diff *= 10.0;
-			}
-		}
-		else if ((diff - FP_ERROR) >= 100.0)
-		{
-			y_op_sign = 2;
-
-			y_factor += 1.0;
-			diff /= 10.0;
-
-			while ((diff - FP_ERROR) >= 100.0)
-			{
-				y_factor += 1.0;
-				diff /= 10.0;
-			}
-		}
-
-		// Find appropriate tick and value dispersion 
-		double y_value_period = 2.0;
-		double y_tick_period = 1.0;
-		if (diff >= 20.0 && diff < 40.0)
-		{
-			y_value_period = 5.0;
-			y_tick_period = 2.5;
-		}
-		else if (diff >= 40.0)
-		{
-			y_value_period = 10.0;
-			y_tick_period = 5.0;
-		}
-
-		// Set the graph-specific tick and value dispersion
-		y_value_period_adj = y_value_period;
-		y_tick_period_adj = y_tick_period;
-		switch (y_op_sign)
-		{
-		case 1:
-		{
-			y_value_period_adj /= pow(10.0, y_factor);
-			y_tick_period_adj /= pow(10.0, y_factor);
-		}
-		break;
-		case 2:
-		{
-			y_value_period_adj *= pow(10.0, y_factor);
-			y_tick_period_adj *= pow(10.0, y_factor);
-		}
-		break;
-		}
-	}
-
-	void Axis::show_ticks_internal(HDC hdc, HWND hwnd, RECT rect, std::vector<double>
-		range, TEXTMETRIC textMetric, RenderAxis *render, bool axis)
+	void Axis::show_ticks(Canvas *canvas, const WindowLayout& layout) const
 	{
-		int stick = (int)(((rect.right - rect.left) -
-			2.0 * textMetric.tmHeight) / 3.0);
-
-		double factor = 0.0;
-		double diff = range[1] - range[0];
-
-		// Automatic scientific notation
-		int value_digits = 0; // overall number of digits
-		int value_int_digits = 0; // number of integral digits
-		int exp_value_capacity = 0; // how many values are expected
-		bool scientific = 0; // whether values will be rendered in the scientific notation
-
-		// First check whether the difference is not too small, so that we 
-		// should extract a certain value and keep only the rest in the rendering
-		// of the axis -> e.g. when range is from 100.000001 to 100.000002, then
-		// plot 0.000001 and 0.000002 in the scientific notation and add 100 to the label
-		if (diff <= pow(10.0, -MIN_RANGE_DIFF))
-		{
-			scientific = 1;
-
-			// Add-on that is going to be extracted and added to the label
-			// Ranges need to be internally changed -> that is the reason why
-			// range vector needs to be passed by value!
-			int add_on = (int)range[0];
-			range[0] = range[0] - add_on;
-			range[1] = range[1] - add_on;
-			
-			if (add_on != 0)
-			{
-				if (axis && !y_value_state)
-				{
-					ylabel += " [ " + std::to_string(add_on) + "+ ]";
-
-					y_value_state = true;
-				}
-				else if(!x_value_state)
-				{
-					xlabel += " [ " + std::to_string(add_on) + "+ ]";
-
-					x_value_state = true;
-				}
-			}
-
-			// 6 is a constant because basic notation is: 
-			// e.g. (+/-)x.(SCIENTIFIC_FRAC_DIGITS)e(+/-)10
-			value_digits = 6 + SCIENTIFIC_FRAC_DIGITS;
-
-			// In case of negative number, also increase number of digits
-			if (range[0] < 0)
-			{
-				++value_digits;
-			}
-		}
-		else if (abs(range[1]) > MAX_RANGE_VALUE)
-		{
-			scientific = 1;
-
-			// 6 is a constant because basic notation is: 
-			// e.g. (+/-)1.(SCIENTIFIC_FRAC_DIGITS)e(+/-)10
-			value_digits = 6 + SCIENTIFIC_FRAC_DIGITS;
-
-			// In case of negative number, also increase number of digits
-			if (range[0] < 0)
-			{
-				++value_digits;
-			}
-		}
-
-		// Obtain the appropriate steps for ticks and values
-		double value_period, tick_period;
-		this->tick_value_map(diff, tick_period, value_period);
-
-		// Find the starting values for the first tick and value
-		int value_divisor = (int)ceil(range[0] / value_period);
-		int tick_divisor = (int)ceil(range[0] / tick_period);
-
-		double value = value_divisor * value_period;
-		double tick = tick_divisor * tick_period;
-
-		// Pre-compute variables
-		double win_length = rect.bottom - rect.top;
-		double length = range[1] - range[0];
-		int x_coord = rect.right;
-		int y_coord;
-
-		// Render ticks
-		while (tick < range[1])
-		{
-			y_coord = rect.bottom -
-				(int)round((tick - range[0]) * win_length / length);
-
-			render->render_tick(hdc, x_coord, y_coord, stick);
-
-			tick += tick_period;
-		}
-
-		x_coord -= (int)(TICK_TEXT_FACTOR * stick);
-		std::wstring y_text;
-		
-		// If the values do not classify as scientific, find the number of integral
-		// and fractional digits -> e.g. 100.01 = 3 integral and 2 fractional
-		if (!scientific)
-		{
-			double value_c = value;
-			int current_digits = 0, current_int_digits = 0;
-			while (value_c <= range[1])
-			{
-				current_int_digits = get_int_digits(value_c);
-				current_digits = current_int_digits +
-					get_frac_digits(value_c, MIN_RANGE_DIFF + 1);
-
-				if (value_digits < current_digits)
-				{
-					value_digits = current_digits;
-					value_int_digits = current_int_digits;
-				}
-
-				value_c += value_period;
-				++exp_value_capacity;
-			}
-		}
-		else
-		{
-			double value_c = value;
-			while (value_c <= range[1])
-			{
-				value_c += value_period;
-				++exp_value_capacity;
-			}
-		}
+		// Set graphics attributes
+		canvas->select_pen(BLACK, 1);
 
-		// Find correct text length and max capacity of the rectangle
-		int av_value_length = AXIS_VALUE_SPACE +
-			value_digits * textMetric.tmAveCharWidth;
-		int max_value_capacity = (rect.bottom - rect.top) / av_value_length;
+		// Set proper text alignment
+		UINT prev_text_align = canvas->set_text_align(TA_CENTER | TA_TOP);
 
-		// If expected space is higher than maximal space, halve the expectations 
-		double halving = 2.0;
-		while (exp_value_capacity > max_value_capacity)
+		// Render ticks on the x axis -> flip back the rendering rectangle
+		RenderAxisX renderX = RenderAxisX(layout.x_ticks);
+		const AxisLayout& x_axis = layout.x_axis;
+		for (size_t i = 0; i != x_axis.ticks.size(); ++i)
 		{
-			if (exp_value_capacity <= 2)
-			{
-				exp_value_capacity = 1;
-				break;
-			}
-
-			exp_value_capacity = (int)ceil(exp_value_capacity / halving);
-			value_period *= halving;
+			renderX.render_tick(canvas, x_axis.tick_x, x_axis.ticks[i], x_axis.stick);
 		}
-
-		// Make proper format for the text rendering via snprintf
-		// char *format = "% int . frac f" or scientific notation
-		char *sbuffer = new char[value_digits + 1];
-		wchar_t *wbuffer = new wchar_t[value_digits + 1];
-
-		char format[6];
-		int snprintf_res;
-
-		// Render the text
-		while (value < range[1])
+		for (size_t i = 0; i != x_axis.labels.size(); ++i)
 		{
-			y_coord = rect.bottom -
-				(int)round((value - range[0]) * win_length / length);
-
-			// Set the format for writing the current value to the sbuffer
-			set_format(format, value, scientific);
-
-			// Write the value to the sbuffer
-			snprintf_res = snprintf(sbuffer, value_digits + 1, format, value);
-
-			// Render only if writing to the sbuffer was successful
-			if (snprintf_res < (value_digits + 1) && snprintf_res > 0)
-			{
-				MultiByteToWideChar(CP_UTF8, 0, sbuffer, -1, wbuffer, value_digits + 1);
-
-				render->render_text(hdc, x_coord, y_coord, wbuffer, snprintf_res);
-			}
-
-			value += value_period;
+			const TickLabel& label = x_axis.labels[i];
+			renderX.render_text(canvas, x_axis.text_x, label.position, label.text, label.length);
 		}
 
-		// Clean allocated buffers 
-		delete[] sbuffer;
-		delete[] wbuffer;
-	}
-
-	void Axis::show_ticks(HDC hdc, HWND hwnd, RECT x_rect, RECT y_rect,
-		std::vector<double> range, HFONT font)
-	{
-		// Set graphics attributes
-		HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-		SelectObject(hdc, hBoxPen);
-
-		// Set proper text alignment
-		int prev_text_align = SetTextAlign(hdc, TA_CENTER | TA_TOP);
-
-		// Get parameters of current font -> for proper rendering of axis values
-		TEXTMETRIC textMetric;
-		GetTextMetrics(hdc, &textMetric);
-
-		// Render ticks on the x axis -> flip the rendering rectangle
-		RenderAxisX renderX = RenderAxisX(x_rect);
-		std::vector<double> x_range{ range[0], range[1] };
-		RECT x_rect_flipped = {x_rect.top, x_rect.left, x_rect.bottom, x_rect.right};
-		this->show_ticks_internal(hdc, hwnd, x_rect_flipped, x_range, textMetric, &renderX, 0);
-
 		// Set bottom and center text alignment
-		SetTextAlign(hdc, TA_CENTER | TA_BOTTOM);
+		canvas->set_text_align(TA_CENTER | TA_BOTTOM);
 
 		// Set font rotation by 90 degrees
-		LOGFONT lf;
-		GetObject(font, sizeof(LOGFONT), &lf);
-		lf.lfEscapement = 900;
-		HFONT lfont = CreateFontIndirect(&lf);
-		HFONT h_prev_font = (HFONT)SelectObject(hdc, (HGDIOBJ)(HFONT)(lfont));
+		canvas->select_font(900, false);
 
 		// Render ticks on the y axis
 		RenderAxisY renderY = RenderAxisY();
-		std::vector<double> y_range{ range[2], range[3] };
-		this->show_ticks_internal(hdc, hwnd, y_rect, y_range, textMetric, &renderY, 1);
+		const AxisLayout& y_axis = layout.y_axis;
+		for (size_t i = 0; i != y_axis.ticks.size(); ++i)
+		{
+			renderY.render_tick(canvas, y_axis.tick_x, y_axis.ticks[i], y_axis.stick);
+		}
+		for (size_t i = 0; i != y_axis.labels.size(); ++i)
+		{
+			const TickLabel& label = y_axis.labels[i];
+			renderY.render_text(canvas, y_axis.text_x, label.position, label.text, label.length);
+		}
 
 		// Set text alignment and font that was in place before rendering axis attributes
-		SetTextAlign(hdc, prev_text_align);
-		SelectObject(hdc, h_prev_font);
-
-		DeleteObject(hBoxPen);
+		canvas->set_text_align(prev_text_align);
+		canvas->select_font(0, false);
 	}
 
-	void Axis::show_xlabel(HDC hdc, HWND hwnd, RECT rect, HFONT font) const
+	void Axis::show_xlabel(Canvas *canvas, RECT rect, const char *add_on) const
 	{
+		std::string text = add_on[0] ? xlabel + " [ " + add_on + "+ ]" : xlabel;
+
 		// Set proper text alignment
-		int prev_text_align = SetTextAlign(hdc, TA_CENTER | TA_BOTTOM);
+		UINT prev_text_align = canvas->set_text_align(TA_CENTER | TA_BOTTOM);
 
 		// Set pen attribute
-		HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-		SelectObject(hdc, hBoxPen);
+		canvas->select_pen(BLACK, 1);
 
 		// Write the label of x axis
 		int x_coord_xlabel = (int)((rect.right + rect.left) * 0.5);
 		int y_coord_xlabel = rect.bottom;
-		wchar_t *wide_xlabel = new wchar_t[xlabel.size() + 1];
-		MultiByteToWideChar(CP_UTF8, 0, xlabel.c_str(), -1, wide_xlabel, (int)xlabel.size() + 1);
-		TextOut(hdc, x_coord_xlabel, y_coord_xlabel, wide_xlabel, (int)xlabel.size());
-
-		delete[] wide_xlabel;
+		canvas->text_out(x_coord_xlabel, y_coord_xlabel, text.c_str(), (int)text.size());
 
 		// Set previous graphic properties
-		SetTextAlign(hdc, prev_text_align);
-
-		DeleteObject(hBoxPen);
+		canvas->set_text_align(prev_text_align);
 	}
 
-	void Axis::show_ylabel(HDC hdc, HWND hwnd, RECT rect, HFONT font) const
+	void Axis::show_ylabel(Canvas *canvas, RECT rect, const char *add_on) const
 	{
+		std::string text = add_on[0] ? ylabel + " [ " + add_on + "+ ]" : ylabel;
+
 		// Set proper text alignment
-		int prev_text_align = SetTextAlign(hdc, TA_CENTER | TA_TOP);
+		UINT prev_text_align = canvas->set_text_align(TA_CENTER | TA_TOP);
 
 		// Set font rotated by 90 degrees
-		LOGFONT lf;
-		GetObject(font, sizeof(LOGFONT), &lf);
-		lf.lfEscapement = 900;
-		HFONT lfont = CreateFontIndirect(&lf);
-		HFONT h_prev_font = (HFONT)SelectObject(hdc, (HGDIOBJ)(HFONT)(lfont));
+		canvas->select_font(900, false);
 
 		// Set pen attribute
-		HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-		HPEN hPreviousPen = (HPEN)SelectObject(hdc, hBoxPen);
+		canvas->select_pen(BLACK, 1);
 
 		// Write the label of y axis
 		int x_coord_ylabel = rect.left;
 		int y_coord_ylabel = (int)((rect.top + rect.bottom) * 0.5);
-		wchar_t * wide_ylabel = new wchar_t[ylabel.size() + 1];
-		MultiByteToWideChar(CP_UTF8, 0, ylabel.c_str(), -1, wide_ylabel, (int)ylabel.size() + 1);
-		TextOut(hdc, x_coord_ylabel, y_coord_ylabel, wide_ylabel, (int)ylabel.size());
-
-		delete[] wide_ylabel;
+		canvas->text_out(x_coord_ylabel, y_coord_ylabel, text.c_str(), (int)text.size());
 
 		// Set previous graphic properties
-		SetTextAlign(hdc, prev_text_align);
-		SelectObject(hdc, h_prev_font);
-		SelectObject(hdc, hPreviousPen);
-
-		// Clean graphic objects
-		DeleteObject(hBoxPen);
+		canvas->set_text_align(prev_text_align);
+		canvas->select_font(0, false);
 	}
 
-	void Axis::show_title(HDC hdc, HWND hwnd, RECT rect, HFONT font) const
+	void Axis::show_title(Canvas *canvas, RECT rect) const
 	{
 		// Set proper text alignment
-		int prev_text_align = SetTextAlign(hdc, TA_CENTER | TA_TOP);
+		UINT prev_text_align = canvas->set_text_align(TA_CENTER | TA_TOP);
 
 		// Make the font bold
-		LOGFONT lf;
-		GetObject(font, sizeof(LOGFONT), &lf);
-		lf.lfWeight = FW_BOLD;
-		HFONT lfont = CreateFontIndirect(&lf);
-		HFONT h_prev_font = (HFONT)SelectObject(hdc, (HGDIOBJ)(HFONT)(lfont));
+		canvas->select_font(0, true);
 
 		// Set pen attribute
-		HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-		HPEN hPreviousPen = (HPEN)SelectObject(hdc, hBoxPen);
+		canvas->select_pen(BLACK, 1);
 
 		// Write the title
 		int x_coord_title = (int)((rect.right + rect.left) / 2);
 		int y_coord_title = rect.top;
-		wchar_t * wide_title = new wchar_t[title.size() + 1];
-		MultiByteToWideChar(CP_UTF8, 0, title.c_str(), -1, wide_title, (int)title.size() + 1);
-		TextOut(hdc, x_coord_title, y_coord_title, wide_title, (int)title.size());
-
-		delete[] wide_title;
+		canvas->text_out(x_coord_title, y_coord_title, title.c_str(), (int)title.size());
 
 		// Set previous graphic properties
-		SetTextAlign(hdc, prev_text_align);
-		SelectObject(hdc, h_prev_font);
-		SelectObject(hdc, hPreviousPen);
-
-		// Clean graphic objects
-		DeleteObject(hBoxPen);
+		canvas->set_text_align(prev_text_align);
+		canvas->select_font(0, false);
 	}
 
-	inline void Axis::show_legend(HDC hdc, HWND hwnd, RECT rect, HFONT font,
-		int text_width, int text_height) const
+	inline void Axis::show_legend(Canvas *canvas, RECT rect, int text_width,
+		int text_height) const
 	{
+		CPPLOT_TRACE_SCOPE("Axis::show_legend");
+
 		// Set proper text alignment
-		int prev_text_align = SetTextAlign(hdc, TA_LEFT | TA_TOP);
+		UINT prev_text_align = canvas->set_text_align(TA_LEFT | TA_TOP);
 
 		// Position of points/centre of lines for symbols of the legend
 		int point_pos_x, point_pos_y;
@@ -1060,7 +1397,7 @@ namespace cpplot {
 		}
 
 		// Buffer to hold current output text
-		wchar_t *buffer = new wchar_t[max_symbols + 1]; // one for null for wcsncpy_s
+		std::string buffer;
 
 		// Length of unwritten string, length of whole string and beginning
 		// and end of the current state of writing
@@ -1069,22 +1406,13 @@ namespace cpplot {
 		// Offset of the y axis from the top of the rectangle
 		int current_offset = LEGEND_SYMBOL_LENGTH;
 
-		// Get current graphic properties
-		HPEN hGraphPreviousPen = (HPEN)GetCurrentObject(hdc, OBJ_PEN);
-		HBRUSH hGraphPreviousBrush = (HBRUSH)GetCurrentObject(hdc, OBJ_BRUSH);
-		
-		// This defintions are for the correctnes of deletion
-		HPEN hGraphPen = CreatePen(PS_SOLID, 1, BLACK);
-		HBRUSH hGraphBrush = CreateSolidBrush(BLACK);
 
 		for (std::vector<LEGEND>::const_iterator it = legend.begin();
 			it != legend.end(); ++it)
 		{
 			// Set proper graphics attributes
-			hGraphPen = CreatePen(PS_SOLID, it->size, it->color);
-			hGraphBrush = CreateSolidBrush(it->color);
-			SelectObject(hdc, hGraphPen);
-			SelectObject(hdc, hGraphBrush);
+			canvas->select_pen(it->color, it->size);
+			canvas->select_brush(it->color);
 
 			// Paint the point/line in the left column of the legend
 			point_pos_x = (int)((rect.left + LEGEND_SYMBOL_LENGTH * 0.5));
@@ -1096,17 +1424,16 @@ namespace cpplot {
 			
 			if (it->type == "scatter")
 			{
-				(it->render_pointer)->renderLegend(hdc, legend_rect);
+				(it->render_pointer)->renderLegend(canvas, legend_rect);
 			}
 			else if (it->type == "line")
 			{
-				(it->render_pointer)->renderLegend(hdc, legend_rect);
+				(it->render_pointer)->renderLegend(canvas, legend_rect);
 
 			}
 			else if (it->type == "hist")
 			{
-				hGraphPen = CreatePen(PS_SOLID, it->size, BLACK);
-				(HPEN)SelectObject(hdc, hGraphPen);
+				canvas->select_pen(BLACK, it->size);
 
 				RECT hist_rect;
 				hist_rect.top = (int)(rect.top + current_offset);
@@ -1116,7 +1443,7 @@ namespace cpplot {
 					LEGEND_SYMBOL_LENGTH * 0.25));
 				hist_rect.right = (int)((rect.left +
 					LEGEND_SYMBOL_LENGTH * 0.75));
-				Rectangle(hdc, hist_rect.left, hist_rect.top, hist_rect.right, hist_rect.bottom);
+				canvas->rectangle(hist_rect.left, hist_rect.top, hist_rect.right, hist_rect.bottom);
 			}
 
 			// Show the text associated with a given point/line
@@ -1131,21 +1458,18 @@ namespace cpplot {
 				{
 					end = string_size;
 
-					MultiByteToWideChar(CP_UTF8, 0, &((it->name).c_str())[begin],
-						end - begin, buffer, diff);
-					TextOut(hdc, rect.left + LEGEND_SYMBOL_LENGTH, rect.top
-						+ current_offset, buffer, end - begin);
+					canvas->text_out(rect.left + LEGEND_SYMBOL_LENGTH, rect.top
+						+ current_offset, &((it->name).c_str())[begin], end - begin);
 					break;
 				}
 				else
 				{
 					end = begin + max_symbols - 1;
 
-					MultiByteToWideChar(CP_UTF8, 0, &(it->name).c_str()[begin],
-						end - begin, buffer, max_symbols - 1);
-					wcsncpy_s(&buffer[max_symbols - 1], 2, L"-", 1);
-					TextOut(hdc, rect.left + LEGEND_SYMBOL_LENGTH, rect.top +
-						current_offset, buffer, max_symbols);
+					buffer.assign(&(it->name).c_str()[begin], end - begin);
+					buffer += '-';
+					canvas->text_out(rect.left + LEGEND_SYMBOL_LENGTH, rect.top +
+						current_offset, buffer.c_str(), max_symbols);
 
 					begin = end;
 					diff = string_size - begin;
@@ -1164,70 +1488,19 @@ namespace cpplot {
 		}
 
 		// Set the previous graphics properties
-		SelectObject(hdc, hGraphPreviousPen);
-		SelectObject(hdc, hGraphPreviousBrush);
-		SetTextAlign(hdc, prev_text_align);
-
-		// Clean graphics objects
-		DeleteObject(hGraphPen);
-		DeleteObject(hGraphBrush);
-		
-		delete[] buffer;
+		canvas->set_text_align(prev_text_align);
 	}
 
-	double Axis::legend_offset(HDC hdc, int text_width, int base) const
+	int Axis::legend_length() const
 	{
-		// width of the rectangle available for text of the legend
-		int base_width = base - LEGEND_SYMBOL_LENGTH;
-
-		// finding whether any string representing label names is longer
-		// than available width
-		int max_width = 0;
-		int string_width = 0;
+		int length = 0;
 		for (std::vector<LEGEND>::const_iterator
 			it = legend.begin(); it != legend.end(); ++it)
 		{
-			string_width = (int)(it->name).size() * text_width;
-			if (string_width >= base_width)
-			{
-				return base_width;
-			};
-
-			max_width = (string_width > max_width) ? string_width : max_width;
+			length = (int)(it->name).size() > length ? (int)(it->name).size() : length;
 		}
 
-		return max_width + LEGEND_SYMBOL_LENGTH;
-	}
-
-	double Axis::tick_xoffset(int text_height) const
-	{
-		return text_height * X_TICK_RATIO;
-	}
-
-	double Axis::label_xoffset(int text_height) const
-	{
-		if (xlabel.empty()) { return 0.0; }
-
-		return text_height;
-	}
-
-	double Axis::tick_yoffset(int text_height) const
-	{
-		return text_height * Y_TICK_RATIO;
-	}
-
-	double Axis::label_yoffset(int text_height) const
-	{
-		if (ylabel.empty()) { return 0.0; }
-
-		return text_height;
-	}
-
-	double Axis::title_offset(int text_height) const
-	{
-		if (title.empty()) { return 0.0; }
-
-		return text_height * TITLE_RATIO;
+		return length;
 	}
 
 	void Axis::set_legend(std::string name, std::string type, COLORREF color,
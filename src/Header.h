@@ -1,4 +1,6 @@
 #pragma once
+
+#ifdef _WIN32
 #pragma comment(lib, "User32.lib")
 #pragma comment(lib, "Gdi32.lib")
 #pragma comment(lib, "Gdiplus.lib")
@@ -13,15 +15,64 @@
 
 #include <windows.h>
 #include "Gdiplus.h"
-#include "Gdiplusheaders.h" 
+#include "Gdiplusheaders.h"
+#else
+#include <cstdint>
+
+// Portable counterparts of the WINAPI types and macros used by the
+// drawing code, so that the headless backend builds without windows.h
+typedef uint32_t COLORREF;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+
+struct RECT
+{
+	long left;
+	long top;
+	long right;
+	long bottom;
+};
+
+struct POINT
+{
+	long x;
+	long y;
+};
+
+#define RGB(r, g, b) ((COLORREF)(((uint8_t)(r) | ((uint16_t)((uint8_t)(g)) << 8)) | \
+	(((uint32_t)(uint8_t)(b)) << 16)))
+#define GetRValue(rgb) ((uint8_t)(rgb))
+#define GetGValue(rgb) ((uint8_t)(((uint16_t)(rgb)) >> 8))
+#define GetBValue(rgb) ((uint8_t)((rgb) >> 16))
+
+// Text alignment flags with the same values as in wingdi.h
+#define TA_LEFT 0
+#define TA_RIGHT 2
+#define TA_CENTER 6
+#define TA_TOP 0
+#define TA_BOTTOM 8
+#define TA_BASELINE 24
+#endif
+
+// SSE2 is used by the vectorized kernels unless CPPLOT_NO_SIMD is defined
+#if !defined(CPPLOT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CPPLOT_SSE2
+#include <emmintrin.h>
+#endif
 
 #include <cstdio>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <math.h>
 
 #include <vector>
 #include <string>
 #include <map>
 #include <algorithm>
 #include <memory>
+#include <typeinfo>
 
 #include "Constants.h"
@@ -0,0 +1,475 @@
+#pragma once
+#include "Header.h"
+#include "Canvas.h"
+#include "TickFormat.h"
+#include "Trace.h"
+
+namespace cpplot
+{
+	// Everything the layout of a window depends on
+	struct LayoutInput
+	{
+		RECT rect; // rectangle of the window
+		double range[4]; // shown min_x, max_x, min_y, max_y
+		TextMetric metric; // of the font of the canvas
+		bool xlabel, ylabel, title; // whether the labels and the title are set
+		bool legend; // whether the legend is shown
+		int legend_length; // number of characters of the longest name of the legend
+
+		bool operator==(const LayoutInput& input) const;
+	};
+
+	// Text of a tick value
+	struct TickLabel
+	{
+		double value;
+		int position; // coordinate along the axis
+		int length;
+		char text[TICK_LABEL_LENGTH];
+	};
+
+	/*
+	Ticks and labels of an axis. Both axes are laid out in the orientation
+	of the y axis -> the rectangle of the x axis is flipped, which RenderAxisX
+	flips back when drawing.
+	*/
+	struct AxisLayout
+	{
+		AxisLayout() : from(NAN), to(NAN), length(0), char_width(0),
+			stick(0), tick_x(0), text_x(0), scientific(false), add_on(0.0),
+			add_on_text{} {};
+
+		double from, to; // range of the values, without the add-on
+		int length; // length of the axis
+		int char_width; // average width of the characters of the labels
+		int stick; // length of the ticks
+		int tick_x; // coordinate of the ticks across the axis
+		int text_x; // coordinate of the labels across the axis
+		bool scientific; // whether the values are in the scientific notation
+		double add_on; // value subtracted from the values, shown with the label
+		char add_on_text[TICK_LABEL_LENGTH]; // the add-on written to its last digit
+		std::vector<int> ticks; // coordinates of the ticks along the axis
+		std::vector<TickLabel> labels;
+	};
+
+	// Rectangles of the parts of a window and its axes
+	struct WindowLayout
+	{
+		RECT graph, x_ticks, y_ticks, x_label, y_label, title, legend;
+		bool has_data; // whether the range is finite and the axes are shown
+		AxisLayout x_axis, y_axis;
+	};
+
+	/*
+	Layout of the windows, independent of the canvas: the range, the
+	rectangle and the font metrics are turned to the rectangles of the
+	graph, the axes, the labels, the title and the legend, and to the
+	positions and the texts of the ticks.
+	*/
+	namespace Layout
+	{
+		// Periods of the ticks and the labelled values of a range of width diff
+		void tick_periods(double diff, double& tick_period, double& value_period);
+
+		// Value subtracted from the values of a range too narrow for their whole
+		// values to be shown, 0 if none: the integral part of a range narrower
+		// than pow(10, -MIN_RANGE_DIFF) and a multiple of the power of ten above
+		// the range if the labels would need more than MAX_TICK_DIGITS digits.
+		// precision is the decimal exponent of the last digit of the add-on.
+		double add_on(double from, double to, int& precision);
+
+		// Lay the ticks and the labels of the values from to out in the rectangle.
+		// The labels of axis are reused if only the position of the rectangle changed.
+		void axis(RECT rect, double from, double to, TextMetric metric, AxisLayout& axis);
+
+		// Lay the window out, reusing the storage and the labels of layout
+		void window(const LayoutInput& input, WindowLayout& layout);
+	}
+
+	// Layout of a window kept until any of its inputs changes
+	class LayoutCache
+	{
+	public:
+		LayoutCache() : valid(false) {};
+
+		// Layout of the input, computed only if the input differs from the last one
+		const WindowLayout& get(const LayoutInput& input);
+
+		// Compute the layout again at the next get
+		void invalidate() { valid = false; }
+
+	private:
+		LayoutInput input;
+		WindowLayout layout;
+		bool valid;
+	};
+
+	inline bool LayoutInput::operator==(const LayoutInput& input) const
+	{
+		return memcmp(&rect, &input.rect, sizeof(RECT)) == 0 &&
+			memcmp(range, input.range, sizeof(range)) == 0 &&
+			metric.height == input.metric.height &&
+			metric.ave_char_width == input.metric.ave_char_width &&
+			xlabel == input.xlabel && ylabel == input.ylabel && title == input.title &&
+			legend == input.legend && legend_length == input.legend_length;
+	}
+
+	inline void Layout::tick_periods(double diff, double& tick_period,
+		double& value_period)
+	{
+		// nothing, multication or division group
+		int op_sign = 0;
+		double factor = 0.0;
+
+		// Find the multiplicative/divisive factor
+		if ((diff + FP_ERROR) < 10.0)
+		{
+			op_sign = 1;
+
+			factor += 1.0;
+			diff *= 10.0;
+
+			while ((diff + FP_ERROR) < 10.0)
+			{
+				factor += 1.0;
+				diff *= 10.0;
+			}
+		}
+		else if ((diff - FP_ERROR) >= 100.0)
+		{
+			op_sign = 2;
+
+			factor += 1.0;
+			diff /= 10.0;
+
+			while ((diff - FP_ERROR) >= 100.0)
+			{
+				factor += 1.0;
+				diff /= 10.0;
+			}
+		}
+
+		// Find appropriate tick and value dispersion
+		value_period = 2.0;
+		tick_period = 1.0;
+		if (diff >= 20.0 && diff < 40.0)
+		{
+			value_period = 5.0;
+			tick_period = 2.5;
+		}
+		else if (diff >= 40.0)
+		{
+			value_period = 10.0;
+			tick_period = 5.0;
+		}
+
+		// Set the graph-specific tick and value dispersion
+		switch (op_sign)
+		{
+		case 1:
+		{
+			value_period /= pow(10.0, factor);
+			tick_period /= pow(10.0, factor);
+		}
+		break;
+		case 2:
+		{
+			value_period *= pow(10.0, factor);
+			tick_period *= pow(10.0, factor);
+		}
+		break;
+		}
+	}
+
+	inline double Layout::add_on(double from, double to, int& precision)
+	{
+		precision = 0;
+
+		double diff = to - from;
+		if (!(diff > 0.0) || !std::isfinite(diff))
+		{
+			return 0.0;
+		}
+
+		double add_on = diff <= pow(10.0, -MIN_RANGE_DIFF) && fabs(from) < 9.0e18 ?
+			trunc(from) : 0.0;
+
+		// Significant digits of the largest label, written to the last digit
+		// of the period of the values
+		double tick_period, value_period;
+		Layout::tick_periods(diff, tick_period, value_period);
+		double largest = fabs(from - add_on) > fabs(to - add_on) ?
+			fabs(from - add_on) : fabs(to - add_on);
+		int digits = largest > 0.0 ?
+			(int)floor(log10(largest)) - TickFormat::precision(value_period) + 1 : 0;
+
+		if (digits > MAX_TICK_DIGITS)
+		{
+			// The rest of the values is below twice the power of ten above the
+			// range, which needs just a few digits
+			precision = (int)ceil(log10(diff));
+			double unit = pow(10.0, precision > 0 ? precision : -precision);
+			add_on += precision > 0 ? floor((from - add_on) / unit) * unit :
+				floor((from - add_on) * unit) / unit;
+		}
+
+		return add_on;
+	}
+
+	inline void Layout::axis(RECT rect, double from, double to, TextMetric metric,
+		AxisLayout& axis)
+	{
+		axis.stick = (int)(((rect.right - rect.left) - 2.0 * metric.height) / 3.0);
+		axis.tick_x = rect.right;
+		axis.text_x = rect.right - (int)(TICK_TEXT_FACTOR * axis.stick);
+		axis.scientific = false;
+		axis.ticks.clear();
+
+		int add_on_precision;
+		axis.add_on = Layout::add_on(from, to, add_on_precision);
+		if (axis.add_on == 0.0 || !TickFormat::label(axis.add_on, add_on_precision, false,
+			axis.add_on_text, TICK_LABEL_LENGTH))
+		{
+			axis.add_on_text[0] = '\0';
+		}
+
+		double diff = to - from;
+
+		// An empty or infinite range has no ticks, which would never end
+		if (!(diff > 0.0) || !std::isfinite(diff))
+		{
+			axis.labels.clear();
+			axis.from = NAN;
+
+			return;
+		}
+
+		// First check whether the difference is not too small, so that we
+		// should extract a certain value and keep only the rest in the rendering
+		// of the axis -> e.g. when range is from 100.000001 to 100.000002, then
+		// plot 0.000001 and 0.000002 in the scientific notation and add 100 to the label.
+		// Values needing too many digits are plotted from their add-on likewise.
+		from -= axis.add_on;
+		to -= axis.add_on;
+		if (diff <= pow(10.0, -MIN_RANGE_DIFF) || fabs(to) > MAX_RANGE_VALUE)
+		{
+			axis.scientific = true;
+		}
+
+		// Obtain the appropriate steps for ticks and values
+		double value_period, tick_period;
+		Layout::tick_periods(diff, tick_period, value_period);
+
+		// Find the starting values for the first tick and value
+		double value = ceil(from / value_period) * value_period;
+		double tick = ceil(from / tick_period) * tick_period;
+
+		// Pre-compute variables
+		double win_length = rect.bottom - rect.top;
+		double length = to - from;
+
+		// Values too large for the precision of their periods do not advance
+		while (tick < to && tick + tick_period > tick)
+		{
+			axis.ticks.push_back(rect.bottom -
+				(int)round((tick - from) * win_length / length));
+
+			tick += tick_period;
+		}
+
+		// The labels are formatted again only when the range or the space changes
+		int axis_length = rect.bottom - rect.top;
+		if (axis.from != from || axis.to != to || axis.length != axis_length ||
+			axis.char_width != metric.ave_char_width)
+		{
+			axis.from = from;
+			axis.to = to;
+			axis.length = axis_length;
+			axis.char_width = metric.ave_char_width;
+
+			// Find the number of the values and the length of the longest of them,
+			// written to the last digit of their period
+			int precision = TickFormat::precision(value_period);
+			char text[TICK_LABEL_LENGTH];
+			int value_digits = 0; // overall number of characters
+			int exp_value_capacity = 0; // how many values are expected
+			for (double value_c = value; value_c <= to && value_c + value_period > value_c;
+				value_c += value_period)
+			{
+				int text_length = TickFormat::label(value_c, precision, axis.scientific,
+					text, TICK_LABEL_LENGTH);
+				value_digits = text_length > value_digits ? text_length : value_digits;
+				++exp_value_capacity;
+			}
+
+			// Find correct text length and max capacity of the rectangle
+			int av_value_length = AXIS_VALUE_SPACE + value_digits * metric.ave_char_width;
+			int max_value_capacity = axis_length / av_value_length;
+
+			// If expected space is higher than maximal space, halve the expectations
+			double halving = 2.0;
+			while (exp_value_capacity > max_value_capacity)
+			{
+				if (exp_value_capacity <= 2)
+				{
+					exp_value_capacity = 1;
+					break;
+				}
+
+				exp_value_capacity = (int)ceil(exp_value_capacity / halving);
+				value_period *= halving;
+			}
+			precision = TickFormat::precision(value_period);
+
+			axis.labels.clear();
+			for (; value < to && value + value_period > value; value += value_period)
+			{
+				TickLabel label;
+				label.value = value;
+				label.length = TickFormat::label(value, precision, axis.scientific,
+					label.text, TICK_LABEL_LENGTH);
+				if (label.length)
+				{
+					axis.labels.push_back(label);
+				}
+			}
+		}
+		else
+		{
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+		}
+
+		for (size_t i = 0; i != axis.labels.size(); ++i)
+		{
+			axis.labels[i].position = rect.bottom -
+				(int)round((axis.labels[i].value - from) * win_length / length);
+		}
+	}
+
+	inline void Layout::window(const LayoutInput& input, WindowLayout& layout)
+	{
+		CPPLOT_TRACE_SCOPE("Layout::window");
+
+		const RECT& rect = input.rect;
+		int text_height = input.metric.height;
+
+		// Appendable series may not have any points yet
+		layout.has_data = std::isfinite(input.range[0]) && std::isfinite(input.range[1]) &&
+			std::isfinite(input.range[2]) && std::isfinite(input.range[3]);
+
+		// Set rectangle for graph space
+		RECT graph_rect = {
+			rect.left + ADJUSTMENT_WINDOW,
+			rect.top + ADJUSTMENT_WINDOW,
+			rect.right - ADJUSTMENT_WINDOW,
+			rect.bottom - ADJUSTMENT_WINDOW
+		};
+
+		// The add-ons of the values are shown with the labels
+		int precision;
+		bool x_add_on = layout.has_data && Layout::add_on(input.range[0], input.range[1], precision) != 0.0;
+		bool y_add_on = layout.has_data && Layout::add_on(input.range[2], input.range[3], precision) != 0.0;
+
+		// Find which attributes the graph should have
+		double x_tick_offset = text_height * X_TICK_RATIO;
+		double y_tick_offset = text_height * Y_TICK_RATIO;
+		double x_label_offset = input.xlabel || x_add_on ? text_height : 0.0;
+		double y_label_offset = input.ylabel || y_add_on ? text_height : 0.0;
+		double title_offset = input.title ? text_height * TITLE_RATIO : 0.0;
+		double legend_offset = 0.0;
+
+		// Find legend offset if the user wants the legend
+		if (input.legend)
+		{
+			// Maximum legend area and the width of it available for the text
+			int legend_width = (int)((graph_rect.right -
+				graph_rect.left) * MAX_LEGEND_RATIO - GRAPH_LEGEND_SPACE);
+			int text_width = legend_width - LEGEND_SYMBOL_LENGTH;
+
+			int string_width = input.legend_length * input.metric.ave_char_width;
+			legend_offset = string_width >= text_width ? text_width :
+				string_width + LEGEND_SYMBOL_LENGTH;
+		}
+
+		// Prepare rectangle for axis and labels
+		RECT& x_ticks = layout.x_ticks;
+		RECT& y_ticks = layout.y_ticks;
+		RECT& x_label = layout.x_label;
+		RECT& y_label = layout.y_label;
+
+		// Set x and y label rectangles
+		x_label.bottom = graph_rect.bottom;
+		x_label.top = (int)(x_label.bottom - x_label_offset);
+
+		y_label.left = graph_rect.left;
+		y_label.right = (int)(y_label.left + y_label_offset);
+
+		// Set x and y tick rectangles
+		x_ticks.bottom = x_label.top;
+		x_ticks.top = (int)(x_ticks.bottom - x_tick_offset);
+
+		y_ticks.left = y_label.right;
+		y_ticks.right = (int)(y_ticks.left + y_tick_offset);
+
+		// Create rectangle for legend
+		RECT& legend = layout.legend;
+		legend = graph_rect;
+		legend.right -= GRAPH_LEGEND_SPACE; // move also the right side of the legend
+		legend.left = legend.right - (int)legend_offset;
+
+		// Create title rectangle
+		RECT& title_rect = layout.title;
+		title_rect = graph_rect;
+		title_rect.bottom = (int)(title_rect.top + title_offset);
+
+		// Adjust the graph rectangle
+		graph_rect.bottom = x_ticks.top;
+		graph_rect.left = y_ticks.right;
+		graph_rect.right = legend.left - GRAPH_LEGEND_SPACE;
+		graph_rect.top = title_rect.bottom;
+		layout.graph = graph_rect;
+
+		// Adjust axis attributes to fit the adjusted graph rectangle,
+		// i.e. those sides which are not affected by that particular attribute
+		x_ticks.left = graph_rect.left;
+		x_ticks.right = graph_rect.right;
+		y_ticks.top = graph_rect.top;
+		y_ticks.bottom = graph_rect.bottom;
+		x_label.left = graph_rect.left;
+		x_label.right = graph_rect.right;
+		y_label.top = graph_rect.top;
+		y_label.bottom = graph_rect.bottom;
+		legend.top = graph_rect.top;
+		legend.bottom = graph_rect.bottom;
+		title_rect.right = graph_rect.right;
+		title_rect.left = graph_rect.left;
+
+		if (!layout.has_data)
+		{
+			layout.x_axis = AxisLayout();
+			layout.y_axis = AxisLayout();
+
+			return;
+		}
+
+		// The x axis is laid out in the flipped rectangle
+		RECT x_flipped = { x_ticks.top, x_ticks.left, x_ticks.bottom, x_ticks.right };
+		Layout::axis(x_flipped, input.range[0], input.range[1], input.metric, layout.x_axis);
+		Layout::axis(y_ticks, input.range[2], input.range[3], input.metric, layout.y_axis);
+	}
+
+	inline const WindowLayout& LayoutCache::get(const LayoutInput& in_input)
+	{
+		if (valid && input == in_input)
+		{
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			return layout;
+		}
+
+		input = in_input;
+		Layout::window(input, layout);
+		valid = true;
+
+		return layout;
+	}
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include "Header.h"
+#include "DataView.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cpplot
+{
+	/*
+	Read-only memory mapping of a binary file. Its columns are DataViews
+	sharing the ownership of the mapping, so the file stays mapped while any
+	graph of it exists and the values are read from the page cache while the
+	graphs are reduced and drawn, without loading the whole file to memory.
+	*/
+	class MappedFile
+	{
+	public:
+		// Map the file, is_open() tells whether it succeeded. With sequential, the
+		// system reads ahead of the accessed pages, which suits the passes over
+		// the whole file made by the graphs, but not the random reads of
+		// e.g. zooming into the index of a long line
+		explicit MappedFile(const std::string& file, bool sequential = true);
+
+		bool is_open() const { return mapping != nullptr; }
+
+		// Size of the file in bytes
+		size_t size() const { return mapping ? mapping->size : 0; }
+
+		// Column of count values of the type (all up to the end of the file if 0),
+		// the first at offset bytes and the next ones stride bytes apart (the size
+		// of the type if 0), e.g. a field of records of a fixed size, or an array
+		// following a header
+		DataView column(DataView::Type type, size_t offset = 0, size_t stride = 0,
+			size_t count = 0) const;
+
+	private:
+		struct Mapping
+		{
+			const unsigned char *data;
+			size_t size;
+#ifdef _WIN32
+			HANDLE file, map;
+#endif
+
+			~Mapping();
+		};
+
+		std::shared_ptr<const Mapping> mapping;
+	};
+
+	inline MappedFile::Mapping::~Mapping()
+	{
+#ifdef _WIN32
+		if (data)
+		{
+			UnmapViewOfFile(data);
+		}
+		if (map)
+		{
+			CloseHandle(map);
+		}
+		CloseHandle(file);
+#else
+		if (data)
+		{
+			munmap((void*)data, size);
+		}
+#endif
+	}
+
+	inline MappedFile::MappedFile(const std::string& file, bool sequential)
+	{
+		std::shared_ptr<Mapping> mapped;
+
+#ifdef _WIN32
+		std::wstring wide_file(file.size() + 1, L'\0');
+		int length = MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1,
+			&wide_file[0], (int)wide_file.size());
+		wide_file.resize(length > 0 ? length - 1 : 0);
+
+		HANDLE handle = CreateFileW(wide_file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER file_size;
+		if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &file_size) ||
+			(unsigned long long)file_size.QuadPart > (unsigned long long)SIZE_MAX)
+		{
+			if (handle != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(handle);
+			}
+
+			printf("ERROR: File %s could not be opened for reading.\n", file.c_str());
+			return;
+		}
+
+		mapped = std::make_shared<Mapping>();
+		mapped->data = nullptr;
+		mapped->size = (size_t)file_size.QuadPart;
+		mapped->file = handle;
+		mapped->map = nullptr;
+
+		// Empty files can not be mapped and have no values to view
+		if (mapped->size)
+		{
+			mapped->map = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			mapped->data = mapped->map ?
+				(const unsigned char*)MapViewOfFile(mapped->map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+			if (!mapped->data)
+			{
+				printf("ERROR: File %s could not be mapped to memory.\n", file.c_str());
+				return;
+			}
+		}
+#else
+		int descriptor = open(file.c_str(), O_RDONLY);
+		struct stat status;
+		if (descriptor < 0 || fstat(descriptor, &status) != 0 ||
+			(unsigned long long)status.st_size > (unsigned long long)SIZE_MAX)
+		{
+			if (descriptor >= 0)
+			{
+				close(descriptor);
+			}
+
+			printf("ERROR: File %s could not be opened for reading.\n", file.c_str());
+			return;
+		}
+
+		mapped = std::make_shared<Mapping>();
+		mapped->data = nullptr;
+		mapped->size = (size_t)status.st_size;
+
+		// Empty files can not be mapped and have no values to view
+		if (mapped->size)
+		{
+			void *address = mmap(nullptr, mapped->size, PROT_READ, MAP_SHARED, descriptor, 0);
+			if (address == MAP_FAILED)
+			{
+				close(descriptor);
+
+				printf("ERROR: File %s could not be mapped to memory.\n", file.c_str());
+				return;
+			}
+
+			mapped->data = (const unsigned char*)address;
+			if (sequential)
+			{
+				madvise(address, mapped->size, MADV_SEQUENTIAL);
+			}
+		}
+
+		// The mapping stays valid after the file is closed
+		close(descriptor);
+#endif
+
+		mapping = mapped;
+	}
+
+	inline DataView MappedFile::column(DataView::Type type, size_t offset,
+		size_t stride, size_t count) const
+	{
+		size_t element = DataView::element_size(type);
+		if (!mapping || !element)
+		{
+			printf("Warning: No column of the file could be viewed. No action taken.\n");
+			return DataView();
+		}
+
+		stride = stride ? stride : element;
+
+		// Values lying entirely within the file
+		size_t available = 0;
+		if (offset <= mapping->size && element <= mapping->size - offset)
+		{
+			available = (mapping->size - offset - element) / stride + 1;
+		}
+
+		if (count > available)
+		{
+			printf("Warning: Only %zu values of the column lie within the file.\n", available);
+		}
+		count = count && count < available ? count : available;
+
+		if (!count)
+		{
+			return DataView();
+		}
+
+		return DataView(mapping->data + offset, type, count, stride, mapping);
+	}
+}
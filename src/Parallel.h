@@ -0,0 +1,164 @@
+#pragma once
+#include "Header.h"
+
+#include <atomic>
+#include <thread>
+
+namespace cpplot
+{
+	// Simple data-parallel helpers built on std::thread
+	namespace Parallel
+	{
+		// Maximal number of threads of the parallel algorithms called from the
+		// current thread, 0 for no limit. Threads of a pool working in parallel
+		// already limit it, so that the algorithms do not oversubscribe the cores.
+		inline unsigned int& thread_limit()
+		{
+			thread_local unsigned int limit = 0;
+
+			return limit;
+		}
+
+		// Number of threads the parallel algorithms may use
+		inline unsigned int thread_count()
+		{
+			if (thread_limit())
+			{
+				return thread_limit();
+			}
+
+			unsigned int count = std::thread::hardware_concurrency();
+
+			return count ? count : 1;
+		}
+
+		// Number of chunks a container of length elements is split to
+		inline size_t chunk_count(size_t length, size_t min_chunk = PARALLEL_MIN_LENGTH)
+		{
+			size_t chunks = min_chunk ? length / min_chunk : length;
+			chunks = chunks < thread_count() ? chunks : thread_count();
+
+			return chunks ? chunks : 1;
+		}
+
+		// Beginning of the index-th chunk out of chunks
+		inline size_t chunk_begin(size_t length, size_t chunks, size_t index)
+		{
+			return (size_t)((unsigned long long)length * index / chunks);
+		}
+
+		/*
+		Call func(index, begin, end) for chunks of [0, length) split
+		by chunk_count, every chunk on its own thread. The first chunk
+		runs on the calling thread.
+		*/
+		template<typename Function>
+		void for_chunks(size_t length, size_t chunks, Function func)
+		{
+			if (chunks <= 1)
+			{
+				func((size_t)0, (size_t)0, length);
+				return;
+			}
+
+			std::vector<std::thread> threads;
+			threads.reserve(chunks - 1);
+			for (size_t i = 1; i != chunks; ++i)
+			{
+				threads.emplace_back(func, i, chunk_begin(length, chunks, i),
+					chunk_begin(length, chunks, i + 1));
+			}
+
+			func((size_t)0, (size_t)0, chunk_begin(length, chunks, 1));
+
+			for (size_t i = 0; i != threads.size(); ++i)
+			{
+				threads[i].join();
+			}
+		}
+
+		template<typename Function>
+		void for_chunks(size_t length, Function func)
+		{
+			for_chunks(length, chunk_count(length), func);
+		}
+
+		// Number of threads working on tasks with at most threads threads,
+		// all hardware threads if it is 0
+		inline size_t worker_count(size_t tasks, unsigned int threads)
+		{
+			size_t workers = threads ? threads : thread_count();
+			workers = workers < tasks ? workers : tasks;
+
+			return workers ? workers : 1;
+		}
+
+		/*
+		Call func(worker, task) for every task of [0, tasks) on worker_count
+		threads. A thread takes the next task left whenever it finishes one,
+		so tasks of uneven cost are balanced. Worker 0 runs on the calling thread.
+		*/
+		template<typename Function>
+		void for_tasks(size_t tasks, unsigned int threads, Function func)
+		{
+			size_t workers = worker_count(tasks, threads);
+			std::atomic<size_t> next(0);
+
+			auto work = [&](size_t worker)
+			{
+				for (size_t task = next++; task < tasks; task = next++)
+				{
+					func(worker, task);
+				}
+			};
+
+			std::vector<std::thread> pool;
+			pool.reserve(workers - 1);
+			for (size_t i = 1; i < workers; ++i)
+			{
+				pool.emplace_back(work, i);
+			}
+
+			work((size_t)0);
+
+			for (size_t i = 0; i != pool.size(); ++i)
+			{
+				pool[i].join();
+			}
+		}
+
+		// Sort the chunks in parallel and merge them pairwise in parallel rounds
+		template<typename Iterator, typename Compare>
+		void sort(Iterator first, Iterator last, Compare comp)
+		{
+			size_t length = last - first;
+			size_t chunks = chunk_count(length);
+
+			for_chunks(length, chunks, [&](size_t, size_t begin, size_t end)
+			{
+				std::sort(first + begin, first + end, comp);
+			});
+
+			for (size_t width = 1; width < chunks; width *= 2)
+			{
+				size_t merges = (chunks + 2 * width - 1) / (2 * width);
+
+				for_chunks(merges, merges, [&](size_t index, size_t, size_t)
+				{
+					size_t left = 2 * width * index;
+					size_t middle = left + width;
+					size_t right = middle + width;
+					if (middle >= chunks)
+					{
+						return;
+					}
+					right = right < chunks ? right : chunks;
+
+					std::inplace_merge(first + chunk_begin(length, chunks, left),
+						first + chunk_begin(length, chunks, middle),
+						first + chunk_begin(length, chunks, right), comp);
+				});
+			}
+		}
+	}
+}
@@ -0,0 +1,375 @@
+#pragma once
+#include "Header.h"
+#include "DataView.h"
+
+#include <atomic>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace cpplot
+{
+	/*
+	Multi-resolution summary of the extremes of a series. Level 0 keeps the
+	minimum and maximum of every block of LOD_BLOCK values, every further level
+	combines pairs of entries of the level below. The extremes of any range are
+	found from O(log(n)) entries and the two partial blocks at its ends, so a
+	line is reduced to the pixel columns of any viewport without reading all
+	its points.
+	*/
+	class MinMaxPyramid
+	{
+	public:
+		// Summarize the values of y, returns false if the build was cancelled
+		bool build(const DataView& y, const std::atomic<bool>& cancelled);
+
+		// Positions of the minimal and maximal value of y in the non-empty range
+		// [begin, end) -> the first position is returned for equal values
+		void query(const DataView& y, size_t begin, size_t end,
+			size_t& min, size_t& max) const;
+
+	private:
+		struct Extremes
+		{
+			double min_value, max_value;
+			size_t min, max; // positions of the extremes
+		};
+
+		static void merge(Extremes& extremes, const Extremes& other);
+
+		static void scan(const DataView& y, size_t begin, size_t end, Extremes& extremes);
+
+		// Level k summarizes blocks of LOD_BLOCK << k values
+		std::vector<std::vector<Extremes>> levels;
+	};
+
+	inline void MinMaxPyramid::merge(Extremes& extremes, const Extremes& other)
+	{
+		if (other.min_value < extremes.min_value ||
+			(other.min_value == extremes.min_value && other.min < extremes.min))
+		{
+			extremes.min_value = other.min_value;
+			extremes.min = other.min;
+		}
+
+		if (other.max_value > extremes.max_value ||
+			(other.max_value == extremes.max_value && other.max < extremes.max))
+		{
+			extremes.max_value = other.max_value;
+			extremes.max = other.max;
+		}
+	}
+
+	inline void MinMaxPyramid::scan(const DataView& y, size_t begin, size_t end,
+		Extremes& extremes)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			double value = y[i];
+			if (value < extremes.min_value)
+			{
+				extremes.min_value = value;
+				extremes.min = i;
+			}
+			if (value > extremes.max_value)
+			{
+				extremes.max_value = value;
+				extremes.max = i;
+			}
+		}
+	}
+
+	inline bool MinMaxPyramid::build(const DataView& y, const std::atomic<bool>& cancelled)
+	{
+		levels.clear();
+
+		// Only the full blocks are summarized, the rest is scanned by the queries
+		size_t blocks = y.size() / LOD_BLOCK;
+		if (!blocks)
+		{
+			return true;
+		}
+
+		std::vector<double> values(LOD_BLOCK);
+		std::vector<Extremes> level(blocks);
+		for (size_t i = 0; i != blocks; ++i)
+		{
+			if (cancelled.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+
+			size_t begin = i * LOD_BLOCK;
+			y.read(begin, LOD_BLOCK, values.data());
+
+			Extremes& extremes = level[i];
+			extremes = Extremes{ values[0], values[0], begin, begin };
+			for (size_t j = 1; j != LOD_BLOCK; ++j)
+			{
+				if (values[j] < extremes.min_value)
+				{
+					extremes.min_value = values[j];
+					extremes.min = begin + j;
+				}
+				if (values[j] > extremes.max_value)
+				{
+					extremes.max_value = values[j];
+					extremes.max = begin + j;
+				}
+			}
+		}
+		levels.push_back(std::move(level));
+
+		while (levels.back().size() > 1)
+		{
+			const std::vector<Extremes>& below = levels.back();
+			std::vector<Extremes> above(below.size() / 2);
+			for (size_t i = 0; i != above.size(); ++i)
+			{
+				above[i] = below[2 * i];
+				merge(above[i], below[2 * i + 1]);
+			}
+
+			levels.push_back(std::move(above));
+		}
+
+		return true;
+	}
+
+	inline void MinMaxPyramid::query(const DataView& y, size_t begin, size_t end,
+		size_t& min, size_t& max) const
+	{
+		Extremes extremes{ y[begin], y[begin], begin, begin };
+
+		size_t first_block = (begin + LOD_BLOCK - 1) / LOD_BLOCK;
+		size_t last_block = end / LOD_BLOCK;
+		if (first_block >= last_block || levels.empty())
+		{
+			scan(y, begin + 1, end, extremes);
+		}
+		else
+		{
+			// Partial blocks at the ends
+			scan(y, begin + 1, first_block * LOD_BLOCK, extremes);
+			scan(y, last_block * LOD_BLOCK, end, extremes);
+
+			// Full blocks from the coarsest levels covering them
+			size_t low = first_block, high = last_block;
+			for (size_t k = 0; low < high; ++k)
+			{
+				if (low & 1)
+				{
+					merge(extremes, levels[k][low++]);
+				}
+				if (high & 1)
+				{
+					merge(extremes, levels[k][--high]);
+				}
+
+				low >>= 1;
+				high >>= 1;
+			}
+		}
+
+		min = extremes.min;
+		max = extremes.max;
+	}
+
+	/*
+	Spatial index of a scatterplot: the positions of the points sorted to
+	LOD_TILES x LOD_TILES tiles over the range of the data. A viewport query
+	reads only the points of the tiles it overlaps.
+	*/
+	class TileIndex
+	{
+	public:
+		// Sort the points to the tiles over the data_range (min_x, max_x, min_y, max_y),
+		// returns false if the build was cancelled or there are too many points
+		bool build(const DataView& x, const DataView& y,
+			const std::vector<double>& data_range, const std::atomic<bool>& cancelled);
+
+		// Whether the range leaves out some tiles, so that a query skips points
+		bool partial(const std::vector<double>& range) const;
+
+		// Append the points of the tiles overlapping the range that lie in the range
+		void query(const DataView& x, const DataView& y, const std::vector<double>& range,
+			std::vector<double>& out_x, std::vector<double>& out_y) const;
+
+	private:
+		// Tile column or row of a value in [min, max]
+		static size_t tile(double value, double min, double max);
+
+		std::vector<double> bounds; // range of the data the tiles divide
+		std::vector<size_t> starts; // start of the points of every tile in positions
+		std::vector<uint32_t> positions;
+	};
+
+	inline size_t TileIndex::tile(double value, double min, double max)
+	{
+		double scaled = (value - min) / (max - min) * LOD_TILES;
+		if (!(scaled > 0.0))
+		{
+			return 0;
+		}
+
+		return scaled < LOD_TILES ? (size_t)scaled : LOD_TILES - 1;
+	}
+
+	inline bool TileIndex::build(const DataView& x, const DataView& y,
+		const std::vector<double>& data_range, const std::atomic<bool>& cancelled)
+	{
+		size_t length = x.size();
+		if (length > UINT32_MAX)
+		{
+			return false;
+		}
+
+		bounds = data_range;
+
+		// Counting sort of the positions by their tiles
+		std::vector<uint32_t> tiles(length);
+		starts.assign(LOD_TILES * LOD_TILES + 1, 0);
+		for (size_t i = 0; i != length; ++i)
+		{
+			if ((i % LOD_BLOCK) == 0 && cancelled.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+
+			tiles[i] = (uint32_t)(tile(y[i], bounds[2], bounds[3]) * LOD_TILES +
+				tile(x[i], bounds[0], bounds[1]));
+			++starts[tiles[i] + 1];
+		}
+
+		for (size_t i = 1; i != starts.size(); ++i)
+		{
+			starts[i] += starts[i - 1];
+		}
+
+		std::vector<size_t> next(starts.begin(), starts.end() - 1);
+		positions.resize(length);
+		for (size_t i = 0; i != length; ++i)
+		{
+			positions[next[tiles[i]]++] = (uint32_t)i;
+		}
+
+		return true;
+	}
+
+	inline bool TileIndex::partial(const std::vector<double>& range) const
+	{
+		return tile(range[0], bounds[0], bounds[1]) > 0 ||
+			tile(range[1], bounds[0], bounds[1]) < LOD_TILES - 1 ||
+			tile(range[2], bounds[2], bounds[3]) > 0 ||
+			tile(range[3], bounds[2], bounds[3]) < LOD_TILES - 1;
+	}
+
+	inline void TileIndex::query(const DataView& x, const DataView& y,
+		const std::vector<double>& range, std::vector<double>& out_x,
+		std::vector<double>& out_y) const
+	{
+		size_t first_column = tile(range[0], bounds[0], bounds[1]);
+		size_t last_column = tile(range[1], bounds[0], bounds[1]);
+		size_t first_row = tile(range[2], bounds[2], bounds[3]);
+		size_t last_row = tile(range[3], bounds[2], bounds[3]);
+
+		for (size_t row = first_row; row <= last_row; ++row)
+		{
+			size_t begin = starts[row * LOD_TILES + first_column];
+			size_t end = starts[row * LOD_TILES + last_column + 1];
+
+			for (size_t i = begin; i != end; ++i)
+			{
+				double point_x = x[positions[i]], point_y = y[positions[i]];
+				if (point_x >= range[0] && point_x <= range[1] &&
+					point_y >= range[2] && point_y <= range[3])
+				{
+					out_x.push_back(point_x);
+					out_y.push_back(point_y);
+				}
+			}
+		}
+	}
+
+	/*
+	Index built on a background thread. The owner starts the build when the
+	index is first worth having and uses get() once it is done, until then the
+	data are read directly. The build must be reset before the indexed data
+	change or are freed.
+	*/
+	template <typename Index>
+	class LazyIndex
+	{
+	public:
+		LazyIndex() : started(false), done(false), cancelled(false) {};
+
+		LazyIndex(const LazyIndex& lazy_index) = delete;
+
+		LazyIndex& operator=(const LazyIndex& lazy_index) = delete;
+
+		// Run build(index, cancelled) on a background thread, it returns false
+		// if the index can not be used -> only the first call starts a build
+		void start(std::function<bool(Index&, const std::atomic<bool>&)> build);
+
+		bool is_started() const { return started; }
+
+		// The built index, or nullptr while it is being built
+		const Index* get() const
+		{
+			return done.load(std::memory_order_acquire) ? &index : nullptr;
+		}
+
+		// Cancel and wait for the build and drop the index
+		void reset();
+
+		~LazyIndex() { this->reset(); }
+
+	private:
+		Index index;
+		std::thread worker;
+		bool started;
+		std::atomic<bool> done, cancelled;
+	};
+
+	template <typename Index>
+	inline void LazyIndex<Index>::start(
+		std::function<bool(Index&, const std::atomic<bool>&)> build)
+	{
+		if (started)
+		{
+			return;
+		}
+		started = true;
+
+		// Without a thread the data keep being read directly
+		try
+		{
+			worker = std::thread([this, build]()
+			{
+				if (build(index, cancelled))
+				{
+					done.store(true, std::memory_order_release);
+				}
+			});
+		}
+		catch (const std::system_error&)
+		{
+			printf("Warning: The index of a graph could not be built in the background.\n");
+		}
+	}
+
+	template <typename Index>
+	inline void LazyIndex<Index>::reset()
+	{
+		if (worker.joinable())
+		{
+			cancelled.store(true, std::memory_order_relaxed);
+			worker.join();
+		}
+
+		index = Index();
+		started = false;
+		done.store(false, std::memory_order_relaxed);
+		cancelled.store(false, std::memory_order_relaxed);
+	}
+}
@@ -1,21 +1,24 @@
 #pragma once
 #include "Header.h"
+#include "Canvas.h"
+#include "Parallel.h"
+#include "DataView.h"
 
 namespace cpplot
 {
 
 	/*
 	Class interface that allows using unified rendering for ticks.
-	RenderAxisX flips back flipped coordinates pushed to the
-	show_ticks_internal fuction in the Axis class for x axis.
+	RenderAxisX flips back the coordinates of the x axis, which the
+	layout computes in the flipped rectangle (see AxisLayout).
 	*/
 	class RenderAxis
 	{
 	public:
-		virtual void render_text(HDC hdc, int x, int y,
-			wchar_t* format, int length) = 0;
+		virtual void render_text(Canvas *canvas, int x, int y,
+			const char* text, int length) = 0;
 
-		virtual void render_tick(HDC hdc, int x, int y,
+		virtual void render_tick(Canvas *canvas, int x, int y,
 			int stick) = 0;
 	};
 
@@ -24,10 +27,10 @@ namespace cpplot
 	public:
 		RenderAxisX(RECT in_rect) : rect(in_rect) {};
 
-		virtual void render_text(HDC hdc, int x, int y,
-			wchar_t* format, int length);
+		virtual void render_text(Canvas *canvas, int x, int y,
+			const char* text, int length);
 
-		virtual void render_tick(HDC hdc, int x, int y,
+		virtual void render_tick(Canvas *canvas, int x, int y,
 			int stick);
 
 	private:
@@ -37,43 +40,160 @@ namespace cpplot
 	class RenderAxisY : public RenderAxis
 	{
 	public:
-		virtual void render_text(HDC hdc, int x, int y,
-			wchar_t* format, int length);
+		virtual void render_text(Canvas *canvas, int x, int y,
+			const char* text, int length);
 
-		virtual void render_tick(HDC hdc, int x, int y,
+		virtual void render_tick(Canvas *canvas, int x, int y,
 			int stick);
 	};
 
-	inline void RenderAxisX::render_text(HDC hdc, int x,
-		int y, wchar_t* text, int length)
+	inline void RenderAxisX::render_text(Canvas *canvas, int x,
+		int y, const char* text, int length)
 	{
 		int adj_x = rect.right - (y - rect.left);
 		int adj_y = rect.bottom - (x - rect.top);
 
-		TextOut(hdc, adj_x, adj_y, text, length);
+		canvas->text_out(adj_x, adj_y, text, length);
 	}
 
-	inline void RenderAxisX::render_tick(HDC hdc, int x,
+	inline void RenderAxisX::render_tick(Canvas *canvas, int x,
 		int y, int stick)
 	{
 		int adj_x = rect.right - (y - rect.left);
 		int adj_y = rect.bottom - (x - rect.top);
 
-		MoveToEx(hdc, adj_x, adj_y, NULL);
-		LineTo(hdc, adj_x, adj_y + stick);
+		canvas->move_to(adj_x, adj_y);
+		canvas->line_to(adj_x, adj_y + stick);
 	}
 
-	inline void RenderAxisY::render_text(HDC hdc, int x,
-		int y, wchar_t* text, int length)
+	inline void RenderAxisY::render_text(Canvas *canvas, int x,
+		int y, const char* text, int length)
 	{
-		TextOut(hdc, x, y, text, length);
+		canvas->text_out(x, y, text, length);
 	}
 
-	inline void RenderAxisY::render_tick(HDC hdc, int x,
+	inline void RenderAxisY::render_tick(Canvas *canvas, int x,
 		int y, int stick)
 	{
-		MoveToEx(hdc, x, y, NULL);
-		LineTo(hdc, x - stick, y);
+		canvas->move_to(x, y);
+		canvas->line_to(x - stick, y);
+	}
+
+
+	/*
+	Mapping of the data to the pixels of a rect, as rect.left + round((x - min_x)
+	* width / length_x) and likewise from the bottom for y. The points of a zoomed
+	view may lie so far outside of the rect that their pixels overflow int, so the
+	offsets from the left and bottom edge are kept in double until the drawing is
+	clipped or clamped to the rect widened by a margin.
+	*/
+	class PixelMap
+	{
+	public:
+		PixelMap(RECT in_rect, const std::vector<double>& range);
+
+		// Offsets of the values from the left and the bottom edge in pixels
+		double offset_x(double value) const { return (value - min_x) * width / length_x; }
+
+		double offset_y(double value) const { return (value - min_y) * height / length_y; }
+
+		// Pixels of offsets within the clipping margins
+		int pixel_x(double offset) const { return rect.left + (int)round(offset); }
+
+		int pixel_y(double offset) const { return rect.bottom - (int)round(offset); }
+
+		// Pixels of the values clamped to PIXEL_GUARD_BAND pixels around the rect,
+		// which keeps them monotonic in the values
+		int clamp_x(double value) const;
+
+		int clamp_y(double value) const;
+
+		// Whether the point at the offsets lies within margin pixels around the rect
+		bool inside(double x, double y, double margin) const;
+
+		// Clip the segment between the offsets to margin pixels around the rect,
+		// returns false if it misses them, otherwise the part from the fraction
+		// t0 to the fraction t1 of the segment is inside (0 and 1 if all of it)
+		bool clip(double x0, double y0, double x1, double y1, double margin,
+			double& t0, double& t1) const;
+
+	private:
+		RECT rect;
+		double min_x, min_y;
+		double width, height; // of the rect
+		double length_x, length_y; // of the range
+	};
+
+	inline PixelMap::PixelMap(RECT in_rect, const std::vector<double>& range) :
+		rect(in_rect), min_x(range[0]), min_y(range[2]),
+		width(in_rect.right - in_rect.left), height(in_rect.bottom - in_rect.top),
+		length_x(range[1] - range[0]), length_y(range[3] - range[2])
+	{
+	}
+
+	inline int PixelMap::clamp_x(double value) const
+	{
+		// Comparisons with NaN are false, so NaN is clamped to the left
+		double offset = this->offset_x(value);
+		offset = offset > -PIXEL_GUARD_BAND ? offset : -PIXEL_GUARD_BAND;
+		offset = offset < width + PIXEL_GUARD_BAND ? offset : width + PIXEL_GUARD_BAND;
+
+		return this->pixel_x(offset);
+	}
+
+	inline int PixelMap::clamp_y(double value) const
+	{
+		double offset = this->offset_y(value);
+		offset = offset > -PIXEL_GUARD_BAND ? offset : -PIXEL_GUARD_BAND;
+		offset = offset < height + PIXEL_GUARD_BAND ? offset : height + PIXEL_GUARD_BAND;
+
+		return this->pixel_y(offset);
+	}
+
+	inline bool PixelMap::inside(double x, double y, double margin) const
+	{
+		return x >= -margin && x <= width + margin && y >= -margin && y <= height + margin;
+	}
+
+	inline bool PixelMap::clip(double x0, double y0, double x1, double y1, double margin,
+		double& t0, double& t1) const
+	{
+		t0 = 0.0;
+		t1 = 1.0;
+		if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+		{
+			return false;
+		}
+
+		// Liang-Barsky clipping, which leaves t0 and t1 exact for the inner segments
+		double dx = x1 - x0, dy = y1 - y0;
+		double p[4] = { -dx, dx, -dy, dy };
+		double q[4] = { x0 + margin, width + margin - x0, y0 + margin, height + margin - y0 };
+
+		for (int i = 0; i != 4; ++i)
+		{
+			if (p[i] == 0.0)
+			{
+				if (q[i] < 0.0)
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			double t = q[i] / p[i];
+			if (p[i] < 0.0)
+			{
+				t0 = t > t0 ? t : t0;
+			}
+			else
+			{
+				t1 = t < t1 ? t : t1;
+			}
+		}
+
+		return t0 <= t1;
 	}
 
 
@@ -86,177 +206,481 @@ namespace cpplot
 	class RenderObjects
 	{
 	public:
-		virtual void renderPoints(HDC hdc, const std::vector<double>& x,
-			const std::vector<double>& y, RECT rect, const std::vector<double>& range) {};
+		virtual void renderPoints(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range) {};
+
+		virtual void renderLines(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range) {};
+
+		virtual void renderLegend(Canvas *canvas, RECT pos) {};
 
-		virtual void renderLines(HDC hdc, const std::map<double, double>& data, RECT rect,
-			const std::vector<double>& range) {};
+		// Whether renderLines draws the same output for the data reduced to
+		// the first, minimal, maximal and last point of every pixel column
+		virtual bool isReducible() { return false; }
 
-		virtual void renderLegend(HDC hdc, RECT pos) {};
+		virtual ~RenderObjects() = default;
 	};
 
 	class RenderScatter : public RenderObjects
 	{
 	public:
-		virtual void renderPoints(HDC hdc, const std::vector<double>& x,
-			const std::vector<double>& y, RECT rect, const std::vector<double>& range) {};
+		virtual void renderPoints(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range) {};
 
-		virtual void renderLegend(HDC hdc, RECT pos) {};
+		virtual void renderLegend(Canvas *canvas, RECT pos) {};
+
+	protected:
+		// Bounds of the markers of the points, centred at their pixels and
+		// reaching radius pixels around them. The markers of a series share
+		// their colour, so a marker of a pixel already covered by another one
+		// does not change the drawing and is left out -> the data are read
+		// block by block and the markers are at most one per pixel of the rect
+		void place(const DataView& x, const DataView& y, RECT rect,
+			const std::vector<double>& range, int radius, std::vector<RECT>& rects);
+
+	private:
+		std::vector<unsigned char> placed; // pixels of the rect with a marker
 	};
 
+	inline void RenderScatter::place(const DataView& x, const DataView& y, RECT rect,
+		const std::vector<double>& range, int radius, std::vector<RECT>& rects)
+	{
+		PixelMap map(rect, range);
+		int x_coord, y_coord;
+
+		// Pixels of the rect including its right and bottom edge, the markers
+		// of the points outside of them but reaching the rect are all kept
+		int width = rect.right - rect.left + 1;
+		int height = rect.bottom - rect.top + 1;
+		width = width > 0 ? width : 0;
+		height = height > 0 ? height : 0;
+		placed.assign((size_t)width * height, 0);
+
+		rects.clear();
+		size_t length = x.size() < y.size() ? x.size() : y.size();
+		static constexpr size_t block = 1024;
+		double block_x[block], block_y[block];
+		for (size_t begin = 0; begin < length; begin += block)
+		{
+			size_t count = length - begin < block ? length - begin : block;
+			x.read(begin, count, block_x);
+			y.read(begin, count, block_y);
+
+			for (size_t i = 0; i != count; ++i)
+			{
+				// Markers not reaching the rect are left out, e.g. of a zoomed view
+				double offset_x = map.offset_x(block_x[i]);
+				double offset_y = map.offset_y(block_y[i]);
+				if (!map.inside(offset_x, offset_y, radius + 1))
+				{
+					continue;
+				}
+
+				x_coord = map.pixel_x(offset_x);
+				y_coord = map.pixel_y(offset_y);
+
+				int column = x_coord - rect.left, row = y_coord - rect.top;
+				if (column >= 0 && column < width && row >= 0 && row < height)
+				{
+					unsigned char& pixel = placed[(size_t)row * width + column];
+					if (pixel)
+					{
+						continue;
+					}
+					pixel = 1;
+				}
+
+				rects.push_back(RECT{ x_coord - radius, y_coord - radius,
+					x_coord + radius, y_coord + radius });
+			}
+		}
+	}
+
 	class RenderScatterPoints : public RenderScatter
 	{
 	public:
-		virtual void renderPoints(HDC hdc, const std::vector<double>& x,
-			const std::vector<double>& y, RECT rect, const std::vector<double>& range);
+		virtual void renderPoints(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range);
 
-		virtual void renderLegend(HDC hdc, RECT pos);
+		virtual void renderLegend(Canvas *canvas, RECT pos);
+
+	private:
+		std::vector<RECT> rects; // bounds of the points, kept between the repaints
 	};
 
-	inline void RenderScatterPoints::renderPoints(HDC hdc, const std::vector<double>& x,
-		const std::vector<double>& y, RECT rect, const std::vector<double>& range)
+	inline void RenderScatterPoints::renderPoints(Canvas *canvas, const DataView& x,
+		const DataView& y, RECT rect, const std::vector<double>& range)
 	{
-		// Set adjusted min and max values, adjusted for the 
-		// free space before/after the first/last point
-		double min_x = range[0];
-		double max_x = range[1];
-		double min_y = range[2];
-		double max_y = range[3];
+		// Draw the points in a single batch
+		this->place(x, y, rect, range, 1, rects);
+		canvas->ellipses(rects.data(), (int)rects.size());
+	}
 
-		// Pre-compute variables
-		double win_length_x = rect.right - rect.left;
-		double win_length_y = rect.bottom - rect.top;
-		double length_x = max_x - min_x;
-		double length_y = max_y - min_y;
-		int x_coord, y_coord;
+	inline void RenderScatterPoints::renderLegend(Canvas *canvas, RECT pos)
+	{
+		int x = (int)(0.5 * (pos.left + pos.right));
+		int y = (int)(0.5 * (pos.top + pos.bottom));
 
-		// Draw the points
-		int x_size = x.size();
-		for (int i = 0; i != x_size; ++i)
-		{
-			x_coord = rect.left +
-				(int)round((x[i] - min_x) * win_length_x / length_x);
-			y_coord = rect.bottom -
-				(int)round((y[i] - min_y) * win_length_y / length_y);
+		canvas->ellipse(x - 1, y - 1, x + 1, y + 1);
+	}
 
-			Ellipse(hdc, x_coord - 1, y_coord - 1, x_coord + 1, y_coord + 1);
-		}
+	class RenderScatterSquares : public RenderScatter
+	{
+	public:
+		virtual void renderPoints(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range);
+
+		void renderLegend(Canvas *canvas, RECT pos);
+
+	private:
+		std::vector<RECT> rects; // squares of the points, kept between the repaints
+	};
+
+	inline void RenderScatterSquares::renderPoints(Canvas *canvas, const DataView& x,
+		const DataView& y, RECT rect, const std::vector<double>& range)
+	{
+		// Draw the points in a single batch
+		this->place(x, y, rect, range, 2, rects);
+		canvas->rectangles(rects.data(), (int)rects.size());
 	}
 
-	inline void RenderScatterPoints::renderLegend(HDC hdc, RECT pos)
+	inline void RenderScatterSquares::renderLegend(Canvas *canvas, RECT pos)
 	{
 		int x = (int)(0.5 * (pos.left + pos.right));
 		int y = (int)(0.5 * (pos.top + pos.bottom));
 
-		Ellipse(hdc, x - 1, y - 1, x + 1, y + 1);
+		canvas->rectangle(x - 2, y - 2, x + 2, y + 2);
 	}
 
-	class RenderScatterSquares : public RenderScatter
+	/*
+	Scatter rendering for millions of points. Points are binned to a grid
+	of per-pixel counts, which is painted as a single image coloured 
+	by the logarithm of the count. Empty pixels are left transparent.
+	*/
+	class RenderScatterDensity : public RenderScatter
 	{
 	public:
-		virtual void renderPoints(HDC hdc, const std::vector<double>& x,
-			const std::vector<double>& y, RECT rect, const std::vector<double>& range);
+		// Colormap from low to high density, the default resembles viridis
+		RenderScatterDensity(const std::vector<COLORREF>& in_colormap = 
+			{ RGB(68, 1, 84), RGB(59, 82, 139), RGB(33, 145, 140), 
+			RGB(94, 201, 98), RGB(253, 231, 37) });
+
+		// Colormap from a light tint of color to color
+		RenderScatterDensity(COLORREF color);
+
+		virtual void renderPoints(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range);
+
+		virtual void renderLegend(Canvas *canvas, RECT pos);
 
-		void renderLegend(HDC hdc, RECT pos);
+	private:
+		// Add the points of [begin, end) to the width x height grid of counts
+		static void bin(const double *x, const double *y, size_t begin, size_t end,
+			double min_x, double min_y, double scale_x, double scale_y,
+			int width, int height, unsigned int *grid);
+
+		std::vector<COLORREF> colormap;
+		std::vector<unsigned int> counts; // grid of counts reused between renders
+		std::vector<unsigned char> pixels; // RGBA image reused between renders
 	};
 
-	inline void RenderScatterSquares::renderPoints(HDC hdc, const std::vector<double>& x,
-		const std::vector<double>& y, RECT rect, const std::vector<double>& range)
+	inline RenderScatterDensity::RenderScatterDensity(
+		const std::vector<COLORREF>& in_colormap) : colormap(in_colormap)
+	{
+		if (colormap.empty())
+		{
+			colormap.push_back(BLACK);
+		}
+	}
+
+	inline RenderScatterDensity::RenderScatterDensity(COLORREF color)
+	{
+		colormap.push_back(RGB(191 + GetRValue(color) / 4, 
+			191 + GetGValue(color) / 4, 191 + GetBValue(color) / 4));
+		colormap.push_back(color);
+	}
+
+	inline void RenderScatterDensity::bin(const double *x, const double *y, 
+		size_t begin, size_t end, double min_x, double min_y, double scale_x, 
+		double scale_y, int width, int height, unsigned int *grid)
 	{
-		// Set adjusted min and max values, adjusted for the 
-		// free space before/after the first/last point
+		// Pixel coordinates are rounded as floor(v + 0.5), which equals round(v)
+		// for non-negative v, and points outside of the grid are skipped
+		size_t i = begin;
+
+#ifdef CPPLOT_SSE2
+		const __m128d v_min_x = _mm_set1_pd(min_x);
+		const __m128d v_min_y = _mm_set1_pd(min_y);
+		const __m128d v_scale_x = _mm_set1_pd(scale_x);
+		const __m128d v_scale_y = _mm_set1_pd(scale_y);
+		const __m128d v_width = _mm_set1_pd(width);
+		const __m128d v_height = _mm_set1_pd(height);
+		const __m128d v_half = _mm_set1_pd(0.5);
+		const __m128d v_zero = _mm_setzero_pd();
+		int columns[4], rows[4];
+
+		for (; i + 2 <= end; i += 2)
+		{
+			__m128d fx = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(
+				_mm_loadu_pd(x + i), v_min_x), v_scale_x), v_half);
+			__m128d fy = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(
+				_mm_loadu_pd(y + i), v_min_y), v_scale_y), v_half);
+
+			// Comparisons with NaN are false, so such points are skipped too
+			__m128d inside = _mm_and_pd(
+				_mm_and_pd(_mm_cmpge_pd(fx, v_zero), _mm_cmplt_pd(fx, v_width)),
+				_mm_and_pd(_mm_cmpge_pd(fy, v_zero), _mm_cmplt_pd(fy, v_height)));
+			int mask = _mm_movemask_pd(inside);
+			if (!mask)
+			{
+				continue;
+			}
+
+			_mm_storeu_si128((__m128i*)columns, _mm_cvttpd_epi32(fx));
+			_mm_storeu_si128((__m128i*)rows, _mm_cvttpd_epi32(fy));
+
+			if (mask & 1)
+			{
+				++grid[(size_t)(height - 1 - rows[0]) * width + columns[0]];
+			}
+			if (mask & 2)
+			{
+				++grid[(size_t)(height - 1 - rows[1]) * width + columns[1]];
+			}
+		}
+#endif
+
+		for (; i < end; ++i)
+		{
+			double fx = (x[i] - min_x) * scale_x + 0.5;
+			double fy = (y[i] - min_y) * scale_y + 0.5;
+
+			if (fx >= 0 && fx < width && fy >= 0 && fy < height)
+			{
+				++grid[(size_t)(height - 1 - (int)fy) * width + (int)fx];
+			}
+		}
+	}
+
+	inline void RenderScatterDensity::renderPoints(Canvas *canvas, const DataView& x,
+		const DataView& y, RECT rect, const std::vector<double>& range)
+	{
+		// Grid covers the rect including its right and bottom edge
+		int width = rect.right - rect.left + 1;
+		int height = rect.bottom - rect.top + 1;
+		if (width <= 0 || height <= 0)
+		{
+			return;
+		}
+
 		double min_x = range[0];
-		double max_x = range[1];
 		double min_y = range[2];
-		double max_y = range[3];
+		double scale_x = (rect.right - rect.left) / (range[1] - range[0]);
+		double scale_y = (rect.bottom - rect.top) / (range[3] - range[2]);
 
-		// Pre-compute variables
-		double win_length_x = rect.right - rect.left;
-		double win_length_y = rect.bottom - rect.top;
-		double length_x = max_x - min_x;
-		double length_y = max_y - min_y;
-		int x_coord, y_coord;
+		size_t length = x.size() < y.size() ? x.size() : y.size();
+		size_t size = (size_t)width * height;
+		counts.assign(size, 0);
+
+		// Every thread bins to its own grid, which are summed afterwards
+		size_t chunks = Parallel::chunk_count(length);
+		std::vector<std::vector<unsigned int>> grids(chunks - 1);
+		Parallel::for_chunks(length, chunks, [&](size_t index, size_t begin, size_t end)
+		{
+			unsigned int *grid = counts.data();
+			if (index)
+			{
+				grids[index - 1].assign(size, 0);
+				grid = grids[index - 1].data();
+			}
+
+			const double *values_x = x.contiguous();
+			const double *values_y = y.contiguous();
+			if (values_x && values_y)
+			{
+				bin(values_x, values_y, begin, end, min_x, min_y, scale_x, scale_y,
+					width, height, grid);
+				return;
+			}
+
+			// Other element types and strides are converted block by block
+			static constexpr size_t block = 1024;
+			double block_x[block], block_y[block];
+			for (size_t i = begin; i < end; i += block)
+			{
+				size_t count = end - i < block ? end - i : block;
+				x.read(i, count, block_x);
+				y.read(i, count, block_y);
+
+				bin(block_x, block_y, 0, count, min_x, min_y, scale_x, scale_y,
+					width, height, grid);
+			}
+		});
 
-		// Draw the points
-		int x_size = x.size();
-		for (int i = 0; i != x_size; ++i)
+		unsigned int max_count = 0;
+		for (size_t i = 0; i != grids.size(); ++i)
 		{
-			x_coord = rect.left +
-				(int)round((x[i] - min_x) * win_length_x / length_x);
-			y_coord = rect.bottom -
-				(int)round((y[i] - min_y) * win_length_y / length_y);
+			const unsigned int *grid = grids[i].data();
+			for (size_t j = 0; j != size; ++j)
+			{
+				counts[j] += grid[j];
+			}
+		}
+		for (size_t j = 0; j != size; ++j)
+		{
+			max_count = counts[j] > max_count ? counts[j] : max_count;
+		}
 
-			Rectangle(hdc, x_coord - 2, y_coord - 2, x_coord + 2, y_coord + 2);
+		if (!max_count)
+		{
+			return;
 		}
+
+		// Interpolated colormap with 256 levels
+		unsigned char table[256][3];
+		size_t stops = colormap.size();
+		for (int level = 0; level != 256; ++level)
+		{
+			double position = stops > 1 ? level / 255.0 * (stops - 1) : 0.0;
+			size_t stop = (size_t)position;
+			stop = stop < stops - 1 ? stop : (stops > 1 ? stops - 2 : 0);
+			double alpha = stops > 1 ? position - stop : 0.0;
+			COLORREF low = colormap[stop];
+			COLORREF high = colormap[stops > 1 ? stop + 1 : 0];
+
+			table[level][0] = (unsigned char)round(GetRValue(low) * (1.0 - alpha) + GetRValue(high) * alpha);
+			table[level][1] = (unsigned char)round(GetGValue(low) * (1.0 - alpha) + GetGValue(high) * alpha);
+			table[level][2] = (unsigned char)round(GetBValue(low) * (1.0 - alpha) + GetBValue(high) * alpha);
+		}
+
+		// Colour the non-empty pixels by the logarithm of their count
+		pixels.assign(size * 4, 0);
+		double log_max = log(1.0 + max_count);
+		for (size_t j = 0; j != size; ++j)
+		{
+			if (counts[j])
+			{
+				int level = max_count > 1 ? 
+					(int)round(log(1.0 + counts[j]) / log_max * 255.0) : 255;
+				unsigned char *pixel = &pixels[j * 4];
+				pixel[0] = table[level][0];
+				pixel[1] = table[level][1];
+				pixel[2] = table[level][2];
+				pixel[3] = 255;
+			}
+		}
+
+		canvas->image(rect.left, rect.top, width, height, pixels.data());
 	}
 
-	inline void RenderScatterSquares::renderLegend(HDC hdc, RECT pos)
+	inline void RenderScatterDensity::renderLegend(Canvas *canvas, RECT pos)
 	{
 		int x = (int)(0.5 * (pos.left + pos.right));
 		int y = (int)(0.5 * (pos.top + pos.bottom));
 
-		Rectangle(hdc, x - 2, y - 2, x + 2, y + 2);
+		canvas->rectangle(x - 2, y - 2, x + 2, y + 2);
 	}
 
 	class RenderLines : public RenderObjects
 	{
 	public:
-		virtual void renderLiness(HDC hdc, const std::map<double, double>& data, RECT rect,
-			const std::vector<double>& range) {};
+		virtual void renderLiness(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range) {};
 
-		virtual void renderLegend(HDC hdc, RECT pos) {};
+		virtual void renderLegend(Canvas *canvas, RECT pos) {};
 	};
 
 	class RenderLinesFull : public RenderLines
 	{
 	public:
-		virtual void renderLines(HDC hdc, const std::map<double, double>& data, RECT rect,
-			const std::vector<double>& range);
+		virtual void renderLines(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range);
 
-		virtual void renderLegend(HDC hdc, RECT pos);
+		virtual void renderLegend(Canvas *canvas, RECT pos);
+
+		virtual bool isReducible() { return true; }
+
+	private:
+		// Vertices of the polylines and their counts, kept between the repaints
+		std::vector<POINT> points;
+		std::vector<DWORD> counts;
 	};
 
-	inline void RenderLinesFull::renderLines(HDC hdc, const std::map<double, double>& data, RECT rect,
-		const std::vector<double>& range)
+	inline void RenderLinesFull::renderLines(Canvas *canvas, const DataView& x,
+		const DataView& y, RECT rect, const std::vector<double>& range)
 	{
-		double min_x = range[0];
-		double max_x = range[1];
-		double min_y = range[2];
-		double max_y = range[3];
-
-		// Pre-compute variables
-		double win_length_x = rect.right - rect.left;
-		double win_length_y = rect.bottom - rect.top;
-		double length_x = max_x - min_x;
-		double length_y = max_y - min_y;
-
-		// Move to the starting point
-		int x_coord = rect.left +
-			(int)round((data.begin()->first - min_x) * win_length_x / length_x);
-		int y_coord = rect.bottom -
-			(int)round((data.begin()->second - min_y) * win_length_y / length_y);
-		MoveToEx(hdc, x_coord, y_coord, NULL);
-
-		for (std::map<double, double>::const_iterator it = data.begin();
-			it != data.end(); ++it)
+		PixelMap map(rect, range);
+		double band = PIXEL_GUARD_BAND;
+
+		size_t x_size = x.size();
+		double last_x = map.offset_x(x[0]);
+		double last_y = map.offset_y(y[0]);
+
+		if (x_size == 1)
 		{
-			x_coord = rect.left +
-				(int)round((it->first - min_x) * win_length_x / length_x);
-			y_coord = rect.bottom -
-				(int)round((it->second - min_y) * win_length_y / length_y);
+			if (map.inside(last_x, last_y, band))
+			{
+				canvas->move_to(map.pixel_x(last_x), map.pixel_y(last_y));
+				canvas->line_to(map.pixel_x(last_x), map.pixel_y(last_y));
+			}
+			return;
+		}
 
-			LineTo(hdc, x_coord, y_coord);
+		// Build the vertices and submit them as a single polyline -> a line
+		// leaving the guard band around the rect, e.g. of a zoomed view, is cut
+		// at its edge and continues by another polyline where it returns
+		points.clear();
+		counts.clear();
+		bool open = false; // whether the last vertex is the previous point
+		for (size_t i = 1; i < x_size; ++i)
+		{
+			double next_x = map.offset_x(x[i]);
+			double next_y = map.offset_y(y[i]);
+
+			double t0, t1;
+			if (map.clip(last_x, last_y, next_x, next_y, band, t0, t1))
+			{
+				if (!open || t0 > 0.0)
+				{
+					points.push_back(POINT{ map.pixel_x(last_x + t0 * (next_x - last_x)),
+						map.pixel_y(last_y + t0 * (next_y - last_y)) });
+					counts.push_back(1);
+				}
+
+				// The inner vertices are rounded from the points themselves
+				open = t1 == 1.0;
+				points.push_back(open ? POINT{ map.pixel_x(next_x), map.pixel_y(next_y) } :
+					POINT{ map.pixel_x(last_x + t1 * (next_x - last_x)),
+					map.pixel_y(last_y + t1 * (next_y - last_y)) });
+				++counts.back();
+			}
+			else
+			{
+				open = false;
+			}
+
+			last_x = next_x;
+			last_y = next_y;
+		}
+
+		if (counts.size() == 1)
+		{
+			canvas->polyline(points.data(), (int)points.size());
+		}
+		else if (!counts.empty())
+		{
+			canvas->polypolyline(points.data(), counts.data(), (int)counts.size());
 		}
 	}
 
-	inline void RenderLinesFull::renderLegend(HDC hdc, RECT pos)
+	inline void RenderLinesFull::renderLegend(Canvas *canvas, RECT pos)
 	{
 		int begin_x = (int)(pos.left + 0.25 * (pos.right - pos.left));
 		int end_x = (int)(pos.left + 0.75 * (pos.right - pos.left));
 		int y = (int)(0.5 * (pos.top + pos.bottom));
 
-		MoveToEx(hdc, begin_x, y, NULL);
-		LineTo(hdc, end_x, y);
+		canvas->move_to(begin_x, y);
+		canvas->line_to(end_x, y);
 	}
 
 	class RenderLinesDotted : public RenderLines
@@ -264,10 +688,10 @@ namespace cpplot
 	public:
 		RenderLinesDotted(int dot_length) : dot_length(dot_length) {};
 
-		virtual void renderLines(HDC hdc, const std::map<double, double>& data, RECT rect,
-			const std::vector<double>& range);
+		virtual void renderLines(Canvas *canvas, const DataView& x,
+			const DataView& y, RECT rect, const std::vector<double>& range);
 
-		virtual void renderLegend(HDC hdc, RECT pos);
+		virtual void renderLegend(Canvas *canvas, RECT pos);
 
 	private:
 		struct Point
@@ -281,9 +705,9 @@ namespace cpplot
 
 		double norm(Point a, Point b)
 		{
-			double distance = (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+			double dx = (double)a.x - b.x, dy = (double)a.y - b.y;
 
-			return sqrt(distance);
+			return sqrt(dx * dx + dy * dy);
 		};
 
 		Point interpolate(Point a, Point b, double alpha)
@@ -295,106 +719,173 @@ namespace cpplot
 			return point;
 		}
 
+		// Add the dots of the line from start_data to end_data, continuing the
+		// dot from start_dot_length to end_dot_length on it
+		void dash(Point start_data, Point end_data, double& start_dot_length,
+			double& end_dot_length);
+
+		// Move the dots along distance pixels of the line without adding them,
+		// e.g. over its parts outside of the rect
+		void skip(double distance, double& start_dot_length, double& end_dot_length);
+
 		int dot_length;
+
+		// Ends of the dots and their counts, kept between the repaints
+		std::vector<POINT> points;
+		std::vector<DWORD> counts;
 	};
 
 
-	inline void RenderLinesDotted::renderLines(HDC hdc, const std::map<double, double>& data, RECT rect,
-		const std::vector<double>& range)
+	inline void RenderLinesDotted::renderLines(Canvas *canvas, const DataView& x,
+		const DataView& y, RECT rect, const std::vector<double>& range)
 	{
-		double min_x = range[0];
-		double max_x = range[1];
-		double min_y = range[2];
-		double max_y = range[3];
-
-		// Pre-compute variables
-		double win_length_x = rect.right - rect.left;
-		double win_length_y = rect.bottom - rect.top;
-		double length_x = max_x - min_x;
-		double length_y = max_y - min_y;
+		PixelMap map(rect, range);
 
 		// Starting point
-		Point start_data, end_data;
-		start_data.x = rect.left +
-			(int)round((data.begin()->first - min_x) * win_length_x / length_x);
-		start_data.y = rect.bottom -
-			(int)round((data.begin()->second - min_y) * win_length_y / length_y);
+		double start_x = map.offset_x(x[0]);
+		double start_y = map.offset_y(y[0]);
 
-		double distance; // length of the current line
 		double start_dot_length = 0.0; // current dot start on the current line
 		double end_dot_length = (double)dot_length; // current dot end on the current line
-		Point start_point, end_point; // starting point and ending point of the current line
 
-		// Start the data iterator at the second point
-		std::map<double, double>::const_iterator it = ++data.begin();
+		// Collect the dots, which are submitted in a single batch
+		points.clear();
 
-		// Render the dotted line
-		for (; it != data.end(); ++it)
+		// Render the dotted line, starting at the second point -> only the parts 
+		// of the lines within a pixel around the rect get dots, so a zoomed view 
+		// adds no more dots than the rect holds
+		size_t x_size = x.size();
+		for (size_t i = 1; i < x_size; ++i)
 		{
-			end_data.x = rect.left +
-				(int)round((it->first - min_x) * win_length_x / length_x);
-			end_data.y = rect.bottom -
-				(int)round((it->second - min_y) * win_length_y / length_y);
-
-			// Compute the length of the current line
-			distance = norm(start_data, end_data);
+			double end_x = map.offset_x(x[i]);
+			double end_y = map.offset_y(y[i]);
 
-			// Render every second dot_length
-			while (end_dot_length <= distance)
+			double t0, t1;
+			if (map.clip(start_x, start_y, end_x, end_y, 1.0, t0, t1))
 			{
-				start_point = interpolate(start_data, end_data, start_dot_length / distance);
-				end_point = interpolate(start_data, end_data, end_dot_length / distance);
-
-				MoveToEx(hdc, start_point.x, start_point.y, NULL);
-				LineTo(hdc, end_point.x, end_point.y);
-
-				start_dot_length = norm(end_point, start_data) + dot_length;
-				end_dot_length = start_dot_length + dot_length;
+				double distance = sqrt((end_x - start_x) * (end_x - start_x) +
+					(end_y - start_y) * (end_y - start_y));
+				if (t0 > 0.0)
+				{
+					this->skip(t0 * distance, start_dot_length, end_dot_length);
+				}
 
-				// Adjust dot length for cases when the start should still start in this segment
-				if (end_dot_length > distance)
+				// The lines inside are dotted between the pixels of their points
+				Point start_point = t0 > 0.0 ?
+					Point(map.pixel_x(start_x + t0 * (end_x - start_x)),
+					map.pixel_y(start_y + t0 * (end_y - start_y))) :
+					Point(map.pixel_x(start_x), map.pixel_y(start_y));
+				Point end_point = t1 < 1.0 ?
+					Point(map.pixel_x(start_x + t1 * (end_x - start_x)),
+					map.pixel_y(start_y + t1 * (end_y - start_y))) :
+					Point(map.pixel_x(end_x), map.pixel_y(end_y));
+				this->dash(start_point, end_point, start_dot_length, end_dot_length);
+
+				if (t1 < 1.0)
 				{
-					end_dot_length = dot_length;
-					break;
+					this->skip((1.0 - t1) * distance, start_dot_length, end_dot_length);
 				}
 			}
-
-			// In case we can still paint a part of the current dotted segment,
-			// we divide the segment. In case we cannot, we move to the next segment
-			// with an appropriate offset
-			if (start_dot_length < distance)
+			else if (std::isfinite(end_x) && std::isfinite(end_y) &&
+				std::isfinite(start_x) && std::isfinite(start_y))
 			{
-				start_point = interpolate(start_data, end_data, start_dot_length / distance);
-				end_point = end_data;
+				this->skip(sqrt((end_x - start_x) * (end_x - start_x) +
+					(end_y - start_y) * (end_y - start_y)), start_dot_length, end_dot_length);
+			}
 
-				MoveToEx(hdc, start_point.x, start_point.y, NULL);
-				LineTo(hdc, end_point.x, end_point.y);
+			start_x = end_x;
+			start_y = end_y;
+		}
+
+		counts.assign(points.size() / 2, 2);
+		canvas->polypolyline(points.data(), counts.data(), (int)counts.size());
+	}
 
-				end_dot_length -= norm(start_point, end_point);
-				start_dot_length = 0.0;
+	inline void RenderLinesDotted::dash(Point start_data, Point end_data,
+		double& start_dot_length, double& end_dot_length)
+	{
+		Point start_point, end_point; // starting point and ending point of the current dot
+
+		// Compute the length of the current line
+		double distance = norm(start_data, end_data);
+
+		// Points at the same pixel do not move along the line, and the dots
+		// could not be interpolated on it
+		if (distance == 0.0)
+		{
+			return;
+		}
+
+		// Render every second dot_length
+		while (end_dot_length <= distance)
+		{
+			start_point = interpolate(start_data, end_data, start_dot_length / distance);
+			end_point = interpolate(start_data, end_data, end_dot_length / distance);
+
+			points.push_back(POINT{ start_point.x, start_point.y });
+			points.push_back(POINT{ end_point.x, end_point.y });
+
+			start_dot_length = norm(end_point, start_data) + dot_length;
+			end_dot_length = start_dot_length + dot_length;
+
+			// Adjust dot length for cases when the start should still start in this segment
+			if (end_dot_length > distance)
+			{
+				end_dot_length = dot_length;
+				break;
 			}
-			else
+		}
+
+		// In case we can still paint a part of the current dotted segment,
+		// we divide the segment. In case we cannot, we move to the next segment
+		// with an appropriate offset
+		if (start_dot_length < distance)
+		{
+			start_point = interpolate(start_data, end_data, start_dot_length / distance);
+			end_point = end_data;
+
+			points.push_back(POINT{ start_point.x, start_point.y });
+			points.push_back(POINT{ end_point.x, end_point.y });
+
+			end_dot_length -= norm(start_point, end_point);
+			start_dot_length = 0.0;
+		}
+		else
+		{
+			// There needs to be this test, because of distance and start_dot_length being 0
+			if ((abs(distance) - FP_ERROR) > 0)
 			{
-				// There needs to be this test, because of distance and start_dot_length being 0
-				if ((abs(distance) - FP_ERROR) > 0)
-				{
-					start_dot_length -= distance;
-					end_dot_length = start_dot_length + dot_length;
-				}
+				start_dot_length -= distance;
+				end_dot_length = start_dot_length + dot_length;
 			}
+		}
+	}
 
-			start_data.x = end_data.x;
-			start_data.y = end_data.y;
+	inline void RenderLinesDotted::skip(double distance, double& start_dot_length,
+		double& end_dot_length)
+	{
+		start_dot_length -= distance;
+		end_dot_length -= distance;
+
+		// The dot ended within the distance -> skip the whole periods of 
+		// a gap and a dot after it
+		if (end_dot_length <= 0.0)
+		{
+			double period = 2.0 * dot_length;
+			end_dot_length += (floor(-end_dot_length / period) + 1.0) * period;
+			start_dot_length = end_dot_length - dot_length;
 		}
+
+		start_dot_length = start_dot_length > 0.0 ? start_dot_length : 0.0;
 	}
 
-	inline void RenderLinesDotted::renderLegend(HDC hdc, RECT pos)
+	inline void RenderLinesDotted::renderLegend(Canvas *canvas, RECT pos)
 	{
 		int begin_x = (int)(pos.left + 0.25 * (pos.right - pos.left));
 		int end_x = (int)(pos.left + 0.75 * (pos.right - pos.left));
 		int y = (int)(0.5 * (pos.top + pos.bottom));
 
-		MoveToEx(hdc, begin_x, y, NULL);
-		LineTo(hdc, end_x, y);
+		canvas->move_to(begin_x, y);
+		canvas->line_to(end_x, y);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+#include "Header.h"
+
+#include <deque>
+
+namespace cpplot
+{
+	/*
+	Minimum and maximum of a sliding window of values. Values are pushed
+	at the back and popped at the front, both in amortized O(1), by keeping
+	monotonic queues of the candidates for the extremes.
+	*/
+	class SlidingExtremes
+	{
+	public:
+		SlidingExtremes() : first(0), last(0) {};
+
+		void push(double value);
+
+		// Remove the oldest value
+		void pop();
+
+		double min() const { return minima.front().first; }
+
+		double max() const { return maxima.front().first; }
+
+		bool empty() const { return first == last; }
+
+	private:
+		// Candidates with their sequence numbers, minima are increasing
+		// and maxima are decreasing from the front
+		std::deque<std::pair<double, size_t>> minima, maxima;
+		size_t first, last; // sequence numbers of the oldest and the next value
+	};
+
+	inline void SlidingExtremes::push(double value)
+	{
+		while (!minima.empty() && minima.back().first >= value)
+		{
+			minima.pop_back();
+		}
+		minima.emplace_back(value, last);
+
+		while (!maxima.empty() && maxima.back().first <= value)
+		{
+			maxima.pop_back();
+		}
+		maxima.emplace_back(value, last);
+
+		++last;
+	}
+
+	inline void SlidingExtremes::pop()
+	{
+		if (empty())
+		{
+			return;
+		}
+
+		if (minima.front().second == first)
+		{
+			minima.pop_front();
+		}
+
+		if (maxima.front().second == first)
+		{
+			maxima.pop_front();
+		}
+
+		++first;
+	}
+
+	/*
+	Buffer of the newest capacity points of a series. Once the buffer
+	is full, every new point overwrites the oldest one. A capacity of 0
+	means the buffer is not used.
+	*/
+	class RingBuffer
+	{
+	public:
+		RingBuffer() : capacity(0), head(0), increasing(0) {};
+
+		RingBuffer(size_t in_capacity) : capacity(in_capacity), head(0), increasing(0)
+		{
+			x.reserve(capacity);
+			y.reserve(capacity);
+		};
+
+		void push(double in_x, double in_y);
+
+		size_t get_capacity() const { return capacity; }
+
+		size_t size() const { return x.size(); }
+
+		// Points in the order of their slots, not from the oldest
+		const std::vector<double>& get_x() const { return x; }
+
+		const std::vector<double>& get_y() const { return y; }
+
+		// Copy the points from the oldest to the newest
+		void unroll(std::vector<double>& out_x, std::vector<double>& out_y) const;
+
+		// Append the newest count points, from the oldest of them
+		void append_newest(size_t count, std::vector<double>& out_x,
+			std::vector<double>& out_y) const;
+
+		// Whether the x values increase from the oldest to the newest point
+		bool is_increasing() const { return increasing >= x.size(); }
+
+		// Set range to min_x, max_x, min_y and max_y of the kept points
+		void get_range(std::vector<double>& range) const;
+
+	private:
+		size_t capacity;
+		size_t head; // slot of the oldest point once the buffer is full
+		size_t increasing; // number of the newest points with increasing x values
+		std::vector<double> x, y;
+		SlidingExtremes extremes_x, extremes_y;
+	};
+
+	inline void RingBuffer::push(double in_x, double in_y)
+	{
+		// The newest point of a full buffer is in the slot before the head
+		size_t newest = x.size() < capacity ? x.size() - 1 : (head + capacity - 1) % capacity;
+		increasing = !x.empty() && x[newest] < in_x ? increasing + 1 : 1;
+
+		if (x.size() < capacity)
+		{
+			x.push_back(in_x);
+			y.push_back(in_y);
+		}
+		else
+		{
+			x[head] = in_x;
+			y[head] = in_y;
+			head = head + 1 == capacity ? 0 : head + 1;
+
+			extremes_x.pop();
+			extremes_y.pop();
+		}
+
+		extremes_x.push(in_x);
+		extremes_y.push(in_y);
+	}
+
+	inline void RingBuffer::unroll(std::vector<double>& out_x,
+		std::vector<double>& out_y) const
+	{
+		out_x.assign(x.begin() + head, x.end());
+		out_x.insert(out_x.end(), x.begin(), x.begin() + head);
+		out_y.assign(y.begin() + head, y.end());
+		out_y.insert(out_y.end(), y.begin(), y.begin() + head);
+	}
+
+	inline void RingBuffer::append_newest(size_t count, std::vector<double>& out_x,
+		std::vector<double>& out_y) const
+	{
+		count = count < x.size() ? count : x.size();
+
+		// The first of the points is count slots before the head
+		size_t first = (head + x.size() - count) % (x.size() ? x.size() : 1);
+		size_t end = first + count < x.size() ? first + count : x.size();
+
+		out_x.insert(out_x.end(), x.begin() + first, x.begin() + end);
+		out_x.insert(out_x.end(), x.begin(), x.begin() + (count - (end - first)));
+		out_y.insert(out_y.end(), y.begin() + first, y.begin() + end);
+		out_y.insert(out_y.end(), y.begin(), y.begin() + (count - (end - first)));
+	}
+
+	inline void RingBuffer::get_range(std::vector<double>& range) const
+	{
+		if (extremes_x.empty())
+		{
+			range = { INFINITY, -INFINITY, INFINITY, -INFINITY };
+			return;
+		}
+
+		range = { extremes_x.min(), extremes_x.max(),
+			extremes_y.min(), extremes_y.max() };
+	}
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "Header.h"
+#include "Parallel.h"
+
+namespace cpplot
+{
+	// Sampling of the functions plotted by Figure::fplot
+	struct SampleOptions
+	{
+		SampleOptions(size_t in_budget = FPLOT_LENGTH, bool in_adaptive = true,
+			double in_tolerance = FPLOT_TOLERANCE, unsigned int in_threads = 1) :
+			budget(in_budget), adaptive(in_adaptive), tolerance(in_tolerance),
+			threads(in_threads) {}
+
+		size_t budget; // maximal number of evaluations of the function
+		bool adaptive; // false evaluates budget equally spaced points
+		double tolerance; // error in pixels up to which the intervals are not refined
+		unsigned int threads; // threads evaluating the function, 0 for all hardware threads
+	};
+
+	namespace Sampling
+	{
+		// Evaluate y[i] = func(x[i]) for count points on threads threads,
+		// the function is called concurrently unless threads is 1
+		template<typename Function>
+		void evaluate(Function& func, const double *x, double *y, size_t count,
+			unsigned int threads)
+		{
+			Parallel::for_tasks(count, threads, [&](size_t worker, size_t i)
+			{
+				y[i] = (double)func(x[i]);
+			});
+		}
+
+		// Distance of the j-th point from the chord of its neighbours
+		inline double turn(const std::vector<double>& x, const std::vector<double>& y,
+			size_t j)
+		{
+			if (!std::isfinite(y[j - 1]) || !std::isfinite(y[j + 1]))
+			{
+				return 0.0;
+			}
+
+			double chord = y[j - 1] + (y[j + 1] - y[j - 1]) *
+				(x[j] - x[j - 1]) / (x[j + 1] - x[j - 1]);
+
+			return fabs(y[j] - chord);
+		}
+	}
+
+	/*
+	Sample the function on [from, to] for a graph of width x height pixels.
+	Adaptive sampling starts from FPLOT_INITIAL equal intervals and splits
+	the intervals whose error in pixels exceeds the tolerance, the largest
+	errors first while the budget lasts. The error of an interval is
+	estimated from the curvature at its ends: the distance of a point from
+	the chord of its neighbours, a quarter of which the half intervals
+	deviate by. The midpoints of every round are evaluated in parallel.
+	Intervals narrower than a quarter of a pixel are not split and the
+	edges of the undefined values are refined like errors.
+	*/
+	template<typename Function>
+	void SampleFunction(Function& func, double from, double to,
+		const SampleOptions& options, int width, int height,
+		std::vector<double>& x, std::vector<double>& y)
+	{
+		size_t budget = options.budget > 2 ? options.budget : 2;
+		size_t initial = options.adaptive && budget > FPLOT_INITIAL + 1 ?
+			FPLOT_INITIAL + 1 : budget;
+
+		x.resize(initial);
+		y.resize(initial);
+		for (size_t i = 0; i != initial; ++i)
+		{
+			x[i] = i + 1 == initial ? to : from + i * (to - from) / (initial - 1);
+		}
+		Sampling::evaluate(func, x.data(), y.data(), initial, options.threads);
+
+		if (!options.adaptive)
+		{
+			return;
+		}
+
+		double min_width = 0.25 * fabs(to - from) / (width > 0 ? width : 1);
+		size_t evaluations = initial;
+		std::vector<double> errors, mid_x, mid_y, new_x, new_y;
+		std::vector<size_t> split;
+		while (evaluations < budget)
+		{
+			// Pixels of y over the range of the values sampled so far
+			double min_y = INFINITY, max_y = -INFINITY;
+			for (size_t i = 0; i != y.size(); ++i)
+			{
+				if (std::isfinite(y[i]))
+				{
+					min_y = y[i] < min_y ? y[i] : min_y;
+					max_y = y[i] > max_y ? y[i] : max_y;
+				}
+			}
+			double scale_y = max_y > min_y ? (height > 0 ? height : 1) / (max_y - min_y) : 0.0;
+
+			size_t intervals = x.size() - 1;
+			errors.assign(intervals, 0.0);
+			split.clear();
+			for (size_t i = 0; i != intervals; ++i)
+			{
+				if (!(fabs(x[i + 1] - x[i]) >= 2.0 * min_width))
+				{
+					continue;
+				}
+
+				bool finite_left = std::isfinite(y[i]) != 0;
+				bool finite_right = std::isfinite(y[i + 1]) != 0;
+				if (finite_left != finite_right)
+				{
+					errors[i] = INFINITY;
+				}
+				else if (finite_left)
+				{
+					double left = i > 0 ? Sampling::turn(x, y, i) : 0.0;
+					double right = i + 1 < intervals ? Sampling::turn(x, y, i + 1) : 0.0;
+					errors[i] = 0.25 * (left > right ? left : right) * scale_y;
+				}
+
+				if (errors[i] > options.tolerance)
+				{
+					split.push_back(i);
+				}
+			}
+
+			if (split.empty())
+			{
+				break;
+			}
+
+			// Only the largest errors are refined when the budget runs out
+			size_t remaining = budget - evaluations;
+			if (split.size() > remaining)
+			{
+				std::nth_element(split.begin(), split.begin() + remaining, split.end(),
+					[&errors](size_t a, size_t b) { return errors[a] > errors[b]; });
+				split.resize(remaining);
+				std::sort(split.begin(), split.end());
+			}
+
+			mid_x.resize(split.size());
+			mid_y.resize(split.size());
+			for (size_t k = 0; k != split.size(); ++k)
+			{
+				mid_x[k] = 0.5 * (x[split[k]] + x[split[k] + 1]);
+			}
+			Sampling::evaluate(func, mid_x.data(), mid_y.data(), split.size(), options.threads);
+			evaluations += split.size();
+
+			// Insert the midpoints after the starts of their intervals
+			new_x.clear();
+			new_y.clear();
+			for (size_t i = 0, k = 0; i != x.size(); ++i)
+			{
+				new_x.push_back(x[i]);
+				new_y.push_back(y[i]);
+				if (k != split.size() && split[k] == i)
+				{
+					new_x.push_back(mid_x[k]);
+					new_y.push_back(mid_y[k]);
+					++k;
+				}
+			}
+
+			x.swap(new_x);
+			y.swap(new_y);
+		}
+	}
+}
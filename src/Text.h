@@ -0,0 +1,461 @@
+#pragma once
+#include "Header.h"
+#include "Trace.h"
+
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+namespace cpplot
+{
+	// Built-in 5x8 bitmap font for printable ASCII characters (32 - 126) used
+	// by the CanvasMemory. Every glyph is stored as 8 rows, the most significant
+	// of the 5 bits being the leftmost pixel; the last row holds descenders.
+	namespace Font
+	{
+		static constexpr int glyph_width = 5;
+		static constexpr int glyph_height = 8;
+
+		// Character cell including the spacing between characters and lines
+		static constexpr int cell_width = 6;
+		static constexpr int cell_height = 9;
+
+		static constexpr int first_char = 32;
+		static constexpr int last_char = 126;
+
+		static const unsigned char glyphs[last_char - first_char + 1][glyph_height] = {
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+			{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00 }, // '!'
+			{ 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+			{ 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A, 0x00 }, // '#'
+			{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04, 0x00 }, // '$'
+			{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x00 }, // '%'
+			{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D, 0x00 }, // '&'
+			{ 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+			{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00 }, // '('
+			{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00 }, // ')'
+			{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00, 0x00 }, // '*'
+			{ 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x00 }, // '+'
+			{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08, 0x00 }, // ','
+			{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+			{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00 }, // '/'
+			{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x00 }, // '0'
+			{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // '1'
+			{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x00 }, // '2'
+			{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, 0x00 }, // '3'
+			{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x00 }, // '4'
+			{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x00 }, // '5'
+			{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x00 }, // '6'
+			{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00 }, // '7'
+			{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00 }, // '8'
+			{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00 }, // '9'
+			{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x00 }, // ':'
+			{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08, 0x00 }, // ';'
+			{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00 }, // '<'
+			{ 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // '='
+			{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00 }, // '>'
+			{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04, 0x00 }, // '?'
+			{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E, 0x00 }, // '@'
+			{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00 }, // 'A'
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E, 0x00 }, // 'B'
+			{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E, 0x00 }, // 'C'
+			{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C, 0x00 }, // 'D'
+			{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F, 0x00 }, // 'E'
+			{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10, 0x00 }, // 'F'
+			{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F, 0x00 }, // 'G'
+			{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00 }, // 'H'
+			{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // 'I'
+			{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C, 0x00 }, // 'J'
+			{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11, 0x00 }, // 'K'
+			{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F, 0x00 }, // 'L'
+			{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00 }, // 'M'
+			{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x00 }, // 'N'
+			{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // 'O'
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10, 0x00 }, // 'P'
+			{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D, 0x00 }, // 'Q'
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11, 0x00 }, // 'R'
+			{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E, 0x00 }, // 'S'
+			{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // 'T'
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // 'U'
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00 }, // 'V'
+			{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A, 0x00 }, // 'W'
+			{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 0x00 }, // 'X'
+			{ 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04, 0x00 }, // 'Y'
+			{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F, 0x00 }, // 'Z'
+			{ 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E, 0x00 }, // '['
+			{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00 }, // '\'
+			{ 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E, 0x00 }, // ']'
+			{ 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '^'
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x00 }, // '_'
+			{ 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+			{ 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 }, // 'a'
+			{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E, 0x00 }, // 'b'
+			{ 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x00 }, // 'c'
+			{ 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00 }, // 'd'
+			{ 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 }, // 'e'
+			{ 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08, 0x00 }, // 'f'
+			{ 0x00, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // 'g'
+			{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // 'h'
+			{ 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // 'i'
+			{ 0x02, 0x00, 0x06, 0x02, 0x02, 0x02, 0x12, 0x0C }, // 'j'
+			{ 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12, 0x00 }, // 'k'
+			{ 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // 'l'
+			{ 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11, 0x00 }, // 'm'
+			{ 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // 'n'
+			{ 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // 'o'
+			{ 0x00, 0x00, 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10 }, // 'p'
+			{ 0x00, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x01 }, // 'q'
+			{ 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00 }, // 'r'
+			{ 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E, 0x00 }, // 's'
+			{ 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06, 0x00 }, // 't'
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 }, // 'u'
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00 }, // 'v'
+			{ 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A, 0x00 }, // 'w'
+			{ 0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00 }, // 'x'
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // 'y'
+			{ 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F, 0x00 }, // 'z'
+			{ 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00 }, // '{'
+			{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // '|'
+			{ 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00 }, // '}'
+			{ 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00 }, // '~'
+		};
+	}
+
+	// Rectangle of the pixels of a text relative to its reference point
+	struct TextRect
+	{
+		int x, y, width, height;
+	};
+
+	/*
+	Glyphs of the built-in font rasterised once for a scale, a weight and a
+	rotation by a multiple of 90 degrees. The masks of the glyphs are in the
+	orientation of the device, relative to the reference point of the first
+	character of a text aligned to the left and the top.
+	*/
+	class GlyphAtlas
+	{
+	public:
+		// Mask of a glyph, the pixels of its character cell
+		struct Glyph
+		{
+			int x, y, width, height;
+			std::vector<unsigned char> mask; // rows of width bytes, 1 for painted pixels
+		};
+
+		GlyphAtlas(int in_scale, bool in_bold, int in_quadrant);
+
+		GlyphAtlas(const GlyphAtlas& atlas) = delete;
+
+		GlyphAtlas& operator=(const GlyphAtlas& atlas) = delete;
+
+		// Atlas shared by all the canvases, created at its first use
+		static const GlyphAtlas& get(int scale, bool bold, int quadrant);
+
+		// Glyph of a character of the font, characters outside of it are '?'
+		const Glyph& glyph(unsigned char symbol) const;
+
+		// Offset of the index-th character from the first one
+		void advance(int index, int& dx, int& dy) const;
+
+		int get_scale() const { return scale; }
+
+		int get_quadrant() const { return quadrant; }
+
+	private:
+		int scale;
+		bool bold;
+		int quadrant;
+		Glyph glyphs[Font::last_char - Font::first_char + 1];
+	};
+
+	// Text composed of the glyphs of an atlas
+	struct TextRun
+	{
+		int count; // number of characters
+		std::vector<TextRect> rects; // painted pixels, the rows merged to rectangles
+	};
+
+	/*
+	Runs of the texts drawn by the canvases, composed from the glyphs once per
+	string and atlas and shared by the painting threads. The cache is emptied
+	when it holds TEXT_RUN_CACHE_LIMIT runs, the runs in use are kept alive by
+	their pointers.
+	*/
+	class TextRunCache
+	{
+	public:
+		// Run of the UTF-8 text of length bytes, continuation bytes are
+		// skipped, so every character is a glyph
+		static std::shared_ptr<const TextRun> get(const GlyphAtlas& atlas,
+			const char *text, int length);
+
+	private:
+		// Compose the run of the text from the glyphs of the atlas
+		static void compose(const GlyphAtlas& atlas, const char *text, int length,
+			TextRun& run);
+	};
+
+	inline GlyphAtlas::GlyphAtlas(int in_scale, bool in_bold, int in_quadrant) :
+		scale(in_scale), bold(in_bold), quadrant(in_quadrant)
+	{
+		// Length of the block along the text direction, bold font is smeared by a pixel
+		int block_u = scale + (bold ? 1 : 0);
+		int block_v = scale;
+
+		for (int symbol = Font::first_char; symbol <= Font::last_char; ++symbol)
+		{
+			Glyph& glyph = glyphs[symbol - Font::first_char];
+
+			// The blocks of the cell in the coordinates along and across the text
+			// are rotated to the device, as the text is drawn by GDI
+			int cell_u = Font::glyph_width * scale + block_u - scale;
+			int cell_v = Font::glyph_height * scale;
+			switch (quadrant)
+			{
+			case 0:
+				glyph.x = 0; glyph.y = 0; glyph.width = cell_u; glyph.height = cell_v;
+				break;
+			case 1:
+				glyph.x = 0; glyph.y = -cell_u + 1; glyph.width = cell_v; glyph.height = cell_u;
+				break;
+			case 2:
+				glyph.x = -cell_u + 1; glyph.y = -cell_v + 1; glyph.width = cell_u; glyph.height = cell_v;
+				break;
+			default:
+				glyph.x = -cell_v + 1; glyph.y = 0; glyph.width = cell_v; glyph.height = cell_u;
+				break;
+			}
+			glyph.mask.assign((size_t)glyph.width * glyph.height, 0);
+
+			const unsigned char *bits = Font::glyphs[symbol - Font::first_char];
+			for (int row = 0; row != Font::glyph_height; ++row)
+			{
+				for (int column = 0; column != Font::glyph_width; ++column)
+				{
+					if (!(bits[row] & (1 << (Font::glyph_width - 1 - column))))
+					{
+						continue;
+					}
+
+					int u = column * scale;
+					int v = row * scale;
+
+					RECT block;
+					switch (quadrant)
+					{
+					case 0:
+						block = RECT{ u, v, u + block_u, v + block_v };
+						break;
+					case 1:
+						block = RECT{ v, -u - block_u + 1, v + block_v, -u + 1 };
+						break;
+					case 2:
+						block = RECT{ -u - block_u + 1, -v - block_v + 1, -u + 1, -v + 1 };
+						break;
+					default:
+						block = RECT{ -v - block_v + 1, u, -v + 1, u + block_u };
+						break;
+					}
+
+					for (int y = block.top; y != block.bottom; ++y)
+					{
+						memset(&glyph.mask[(size_t)(y - glyph.y) * glyph.width + block.left - glyph.x],
+							1, block.right - block.left);
+					}
+				}
+			}
+		}
+	}
+
+	inline const GlyphAtlas& GlyphAtlas::get(int scale, bool bold, int quadrant)
+	{
+		static std::mutex mutex;
+		static std::map<std::tuple<int, bool, int>, std::unique_ptr<GlyphAtlas>> atlases;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::unique_ptr<GlyphAtlas>& atlas = atlases[std::make_tuple(scale, bold, quadrant)];
+		if (!atlas)
+		{
+			CPPLOT_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+			atlas.reset(new GlyphAtlas(scale, bold, quadrant));
+		}
+
+		return *atlas;
+	}
+
+	inline const GlyphAtlas::Glyph& GlyphAtlas::glyph(unsigned char symbol) const
+	{
+		if (symbol < Font::first_char || symbol > Font::last_char)
+		{
+			symbol = '?';
+		}
+
+		return glyphs[symbol - Font::first_char];
+	}
+
+	inline void GlyphAtlas::advance(int index, int& dx, int& dy) const
+	{
+		int u = index * Font::cell_width * scale;
+
+		dx = quadrant == 0 ? u : (quadrant == 2 ? -u : 0);
+		dy = quadrant == 1 ? -u : (quadrant == 3 ? u : 0);
+	}
+
+	inline std::shared_ptr<const TextRun> TextRunCache::get(const GlyphAtlas& atlas,
+		const char *text, int length)
+	{
+		static std::mutex mutex;
+		static std::unordered_map<std::string, std::shared_ptr<const TextRun>> runs;
+		static std::string key; // kept to reuse its storage
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			// The atlases are never destroyed, so their addresses identify them
+			const GlyphAtlas *address = &atlas;
+			key.assign((const char*)&address, sizeof(address));
+			key.append(text, length);
+
+			std::unordered_map<std::string, std::shared_ptr<const TextRun>>::const_iterator
+				found = runs.find(key);
+			if (found != runs.end())
+			{
+				CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+				return found->second;
+			}
+		}
+
+		// The run is composed outside of the lock, a run composed by two threads
+		// at once is only stored twice
+		std::shared_ptr<TextRun> run = std::make_shared<TextRun>();
+		TextRunCache::compose(atlas, text, length, *run);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (runs.size() >= TEXT_RUN_CACHE_LIMIT)
+		{
+			runs.clear();
+		}
+
+		const GlyphAtlas *address = &atlas;
+		key.assign((const char*)&address, sizeof(address));
+		key.append(text, length);
+		runs[key] = run;
+
+		return run;
+	}
+
+	inline void TextRunCache::compose(const GlyphAtlas& atlas, const char *text,
+		int length, TextRun& run)
+	{
+		CPPLOT_TRACE_SCOPE("TextRunCache::compose");
+
+		// Bounds of the glyphs of the characters
+		run.count = 0;
+		RECT bounds = { 0, 0, 0, 0 };
+		for (int i = 0; i != length; ++i)
+		{
+			unsigned char symbol = (unsigned char)text[i];
+			if ((symbol & 0xC0) == 0x80)
+			{
+				continue;
+			}
+
+			const GlyphAtlas::Glyph& glyph = atlas.glyph(symbol);
+			int dx, dy;
+			atlas.advance(run.count, dx, dy);
+
+			RECT cell = { glyph.x + dx, glyph.y + dy, glyph.x + dx + glyph.width,
+				glyph.y + dy + glyph.height };
+			if (!run.count)
+			{
+				bounds = cell;
+			}
+			bounds.left = cell.left < bounds.left ? cell.left : bounds.left;
+			bounds.top = cell.top < bounds.top ? cell.top : bounds.top;
+			bounds.right = cell.right > bounds.right ? cell.right : bounds.right;
+			bounds.bottom = cell.bottom > bounds.bottom ? cell.bottom : bounds.bottom;
+
+			++run.count;
+		}
+
+		// Mask of the whole text
+		int left = (int)bounds.left, top = (int)bounds.top;
+		int width = (int)(bounds.right - bounds.left);
+		int height = (int)(bounds.bottom - bounds.top);
+		std::vector<unsigned char> mask((size_t)width * height, 0);
+		for (int i = 0, index = 0; i != length; ++i)
+		{
+			unsigned char symbol = (unsigned char)text[i];
+			if ((symbol & 0xC0) == 0x80)
+			{
+				continue;
+			}
+
+			const GlyphAtlas::Glyph& glyph = atlas.glyph(symbol);
+			int dx, dy;
+			atlas.advance(index++, dx, dy);
+
+			for (int y = 0; y != glyph.height; ++y)
+			{
+				const unsigned char *source = &glyph.mask[(size_t)y * glyph.width];
+				unsigned char *target = &mask[(size_t)(glyph.y + dy + y - top) * width +
+					glyph.x + dx - left];
+				for (int x = 0; x != glyph.width; ++x)
+				{
+					target[x] |= source[x];
+				}
+			}
+		}
+
+		// Spans of the rows, the equal spans of the consecutive rows are merged
+		// to a rectangle -> the scaled rows of the font are drawn at once
+		run.rects.clear();
+		std::vector<size_t> open, next; // rectangles of the spans of the last row
+		for (int y = 0; y != height; ++y)
+		{
+			next.clear();
+			size_t k = 0;
+			const unsigned char *row = &mask[(size_t)y * width];
+			for (int x = 0; x != width; )
+			{
+				if (!row[x])
+				{
+					++x;
+					continue;
+				}
+
+				int begin = x;
+				while (x != width && row[x])
+				{
+					++x;
+				}
+
+				// The spans of a row are ordered, so the matching span of the previous row
+				// is found by advancing through them
+				while (k != open.size() && run.rects[open[k]].x < begin + left)
+				{
+					++k;
+				}
+
+				TextRect span = { begin + left, y + top, x - begin, 1 };
+				if (k != open.size() && run.rects[open[k]].x == span.x &&
+					run.rects[open[k]].width == span.width)
+				{
+					++run.rects[open[k]].height;
+					next.push_back(open[k]);
+				}
+				else
+				{
+					next.push_back(run.rects.size());
+					run.rects.push_back(span);
+				}
+			}
+
+			open.swap(next);
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include "Header.h"
+
+namespace cpplot
+{
+	/*
+	Formatting of the values of the axis ticks to a buffer of the caller,
+	without allocations and printf formats. The values of the ticks are
+	multiples of a decimal period, so they are rounded in integers to the
+	last significant digit of the period (see precision), which keeps the
+	neighbouring labels distinct and drops the errors accumulated by
+	stepping (e.g. 0.30000000000000004).
+	*/
+	namespace TickFormat
+	{
+		// Largest number of digits written from an integer (of 2^63)
+		const int MAX_DIGITS = 19;
+
+		// Write the digits of number to the end of the buffer,
+		// returns the position of the first digit
+		inline char *write_digits(unsigned long long number, char *end, int min_digits)
+		{
+			char *begin = end;
+			do
+			{
+				*--begin = (char)('0' + number % 10);
+				number /= 10;
+				--min_digits;
+			} while (number || min_digits > 0);
+
+			return begin;
+		}
+
+		inline int copy(const char *begin, const char *end, char *buffer, int size)
+		{
+			int length = (int)(end - begin);
+			if (length >= size)
+			{
+				return 0;
+			}
+
+			memcpy(buffer, begin, length);
+			buffer[length] = '\0';
+
+			return length;
+		}
+
+		/*
+		Write the value with the fewest fractional digits, up to frac_digits,
+		representing it rounded to frac_digits, e.g. 2, 2.5 or -0.125. Returns
+		the length of the text, or 0 if it does not fit to size characters
+		with the terminating zero or the value is too large for the precision.
+		*/
+		inline int fixed(double value, int frac_digits, char *buffer, int size)
+		{
+			double scale = 1.0;
+			for (int i = 0; i < frac_digits; ++i)
+			{
+				scale *= 10.0;
+			}
+
+			double scaled = fabs(value) * scale;
+			if (!(scaled < 9.0e18))
+			{
+				return 0;
+			}
+
+			unsigned long long number = (unsigned long long)llround(scaled);
+
+			// The trailing zeros of the fraction are dropped
+			while (frac_digits > 0 && number % 10 == 0)
+			{
+				number /= 10;
+				--frac_digits;
+			}
+
+			char text[MAX_DIGITS + 4];
+			char *end = text + sizeof(text);
+			char *begin = write_digits(number, end, frac_digits + 1);
+			if (frac_digits > 0)
+			{
+				// Shift the integral digits to make place for the dot
+				char *dot = end - frac_digits;
+				memmove(begin - 1, begin, dot - begin);
+				*--dot = '.';
+				--begin;
+			}
+
+			// Values rounded to zero have no sign
+			if (number && value < 0.0)
+			{
+				*--begin = '-';
+			}
+
+			return copy(begin, end, buffer, size);
+		}
+
+		/*
+		Write the value in the scientific notation with frac_digits digits
+		of the mantissa and at least two digits of the exponent, as printf
+		with %.<frac_digits>e, e.g. 1.50e+06. Returns the length of the text,
+		or 0 if it does not fit to size characters with the terminating zero.
+		*/
+		inline int scientific(double value, int frac_digits, char *buffer, int size)
+		{
+			frac_digits = frac_digits < MAX_DIGITS - 1 ? frac_digits : MAX_DIGITS - 1;
+			if (!std::isfinite(value))
+			{
+				return 0;
+			}
+
+			double limit = 1.0;
+			for (int i = 0; i < frac_digits; ++i)
+			{
+				limit *= 10.0;
+			}
+
+			// Digits of the mantissa as an integer of frac_digits + 1 digits
+			int exponent = 0;
+			unsigned long long mantissa = 0;
+			if (value != 0.0)
+			{
+				exponent = (int)floor(log10(fabs(value)));
+				mantissa = (unsigned long long)llround(fabs(value) * pow(10.0, frac_digits - exponent));
+
+				// Rounded up to the next power of ten, or the logarithm was inexact
+				if (mantissa >= (unsigned long long)(10.0 * limit))
+				{
+					++exponent;
+					mantissa = (unsigned long long)llround(fabs(value) * pow(10.0, frac_digits - exponent));
+				}
+				else if (mantissa < (unsigned long long)limit)
+				{
+					--exponent;
+					mantissa = (unsigned long long)llround(fabs(value) * pow(10.0, frac_digits - exponent));
+				}
+			}
+
+			char text[2 * MAX_DIGITS + 8];
+			char *end = text + sizeof(text);
+
+			char *begin = write_digits(exponent < 0 ? -exponent : exponent, end, 2);
+			*--begin = exponent < 0 ? '-' : '+';
+			*--begin = 'e';
+
+			char *digits = write_digits(mantissa, begin, frac_digits + 1);
+			if (frac_digits > 0)
+			{
+				memmove(digits - 1, digits, 1);
+				digits[0] = '.';
+				--digits;
+			}
+
+			if (value < 0.0)
+			{
+				*--digits = '-';
+			}
+
+			return copy(digits, end, buffer, size);
+		}
+
+		// Decimal exponent of the last significant digit of the period of 
+		// the labelled values, e.g. -2 for 0.25 and 3 for 5000
+		inline int precision(double period)
+		{
+			if (!(period > 0.0) || !std::isfinite(period))
+			{
+				return 0;
+			}
+
+			// The periods have a few significant digits, up to the rounding errors
+			int exponent = (int)floor(log10(period));
+			for (int digits = 0; digits != MAX_DIGITS; ++digits)
+			{
+				double scaled = period / pow(10.0, exponent - digits);
+				if (fabs(scaled - round(scaled)) <= 1e-6 * scaled)
+				{
+					return exponent - digits;
+				}
+			}
+
+			return exponent - MAX_DIGITS + 1;
+		}
+
+		/*
+		Write the label of a tick value as the axes show it, rounded to the 
+		digit of precision (see precision), in the scientific notation if 
+		scientific or the value is too large for the fixed one. The mantissa 
+		has at least SCIENTIFIC_FRAC_DIGITS fractional digits.
+		*/
+		inline int label(double value, int precision, bool scientific, char *buffer, int size)
+		{
+			int length = scientific ? 0 : fixed(value, precision < 0 ? -precision : 0,
+				buffer, size);
+			if (length)
+			{
+				return length;
+			}
+
+			// Values rounded to zero are not written by the digits of their errors
+			value = fabs(value) < 0.5 * pow(10.0, precision) ? 0.0 : value;
+			int exponent = value != 0.0 && std::isfinite(value) ? 
+				(int)floor(log10(fabs(value))) : precision;
+			int frac_digits = exponent - precision;
+			frac_digits = frac_digits > SCIENTIFIC_FRAC_DIGITS ? frac_digits : SCIENTIFIC_FRAC_DIGITS;
+
+			return TickFormat::scientific(value, frac_digits, buffer, size);
+		}
+	}
+}
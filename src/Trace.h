@@ -0,0 +1,344 @@
+#pragma once
+#include "Header.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace cpplot
+{
+	// Counters of the work done by the traced code
+	enum TraceCounter
+	{
+		TRACE_POINTS, // points of the series passed to the rendering
+		TRACE_PRIMITIVES, // drawing calls issued to the canvases
+		TRACE_ALLOCATIONS, // framebuffers, label buffers and GDI objects allocated
+		TRACE_CACHE_HITS, // retained drawings, reductions and GDI objects reused
+		TRACE_COUNTERS
+	};
+
+	// Number of the calls and their total duration of a traced phase
+	struct TracePhase
+	{
+		unsigned long long calls;
+		double total_ms;
+	};
+
+	// Statistics of a frame -> of the work since the end of the previous paint
+	struct TraceStats
+	{
+		std::map<std::string, TracePhase> phases; // by the names of the phases
+		unsigned long long counters[TRACE_COUNTERS]; // indexed by TraceCounter
+	};
+
+	/*
+	Timings and counters of the work of a figure. The tracing is compiled in
+	only with CPPLOT_TRACE defined, otherwise CPPLOT_TRACE_SCOPE and
+	CPPLOT_TRACE_COUNT expand to nothing and the trace stays empty. The code
+	traces to the trace bound to its thread by CPPLOT_TRACE_BIND or
+	CPPLOT_TRACE_FRAME, which the figures do in their public calls, so the
+	work of every figure is traced separately. The phases are kept as events for the Chrome trace format,
+	at most TRACE_EVENT_LIMIT of them, and summed per frame.
+	*/
+	class Trace
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		Trace();
+
+		Trace(const Trace& trace) = delete;
+
+		Trace& operator=(const Trace& trace) = delete;
+
+		// Whether the tracing is compiled in
+		static bool enabled();
+
+		// Trace bound to the calling thread, or nullptr
+		static Trace*& current();
+
+		// Add to a counter of the trace bound to the calling thread
+		static void add(TraceCounter counter, unsigned long long value);
+
+		// Record the phase of name (a string literal) lasting from start to end
+		void phase(const char *name, Clock::time_point start, Clock::time_point end);
+
+		// Close the current frame and start the next one
+		void end_frame();
+
+		// Statistics of the last closed frame
+		TraceStats get_frame_stats() const;
+
+		// Append the events and the counters of the frames in the Chrome
+		// trace-event format, which chrome://tracing and Perfetto open
+		void write_json(std::string& json) const;
+
+		// Drop the recorded events, frames and statistics
+		void clear();
+
+	private:
+		struct Event
+		{
+			const char *name;
+			int thread; // index of the thread in the order of their first events
+			double start_us, duration_us; // since the origin
+		};
+
+		// Counters at the end of a frame
+		struct Mark
+		{
+			double time_us;
+			unsigned long long counters[TRACE_COUNTERS];
+		};
+
+		Clock::time_point origin;
+		std::vector<Event> events;
+		std::vector<Mark> marks;
+		std::vector<std::thread::id> threads;
+		size_t dropped; // events over the limit
+
+		std::map<std::string, TracePhase> phases; // of the current frame
+		std::atomic<unsigned long long> counters[TRACE_COUNTERS]; // of the current frame
+		TraceStats last_frame;
+
+		mutable std::mutex mutex; // guards all but the counters
+	};
+
+	// Bind a trace to the calling thread for the lifetime of the object
+	class TraceBind
+	{
+	public:
+		TraceBind(Trace *trace) : previous(Trace::current()) { Trace::current() = trace; }
+
+		~TraceBind() { Trace::current() = previous; }
+
+	private:
+		Trace *previous;
+	};
+
+	// Record the lifetime of the object as a phase of the bound trace
+	class TraceScope
+	{
+	public:
+		TraceScope(const char *in_name) : name(in_name), trace(Trace::current())
+		{
+			if (trace)
+			{
+				start = Trace::Clock::now();
+			}
+		}
+
+		~TraceScope()
+		{
+			if (trace)
+			{
+				trace->phase(name, start, Trace::Clock::now());
+			}
+		}
+
+	private:
+		const char *name;
+		Trace *trace;
+		Trace::Clock::time_point start;
+	};
+
+	// Bind a trace to the calling thread and record the lifetime of the object as
+	// a phase closing the frame. A frame within a frame of the same trace (e.g. 
+	// the paint of a save) is recorded only as a phase of the outer one.
+	class TraceFrame
+	{
+	public:
+		TraceFrame(Trace *in_trace, const char *in_name) : name(in_name),
+			trace(in_trace), previous(Trace::current()), start(Trace::Clock::now())
+		{
+			Trace::current() = trace;
+		}
+
+		~TraceFrame()
+		{
+			trace->phase(name, start, Trace::Clock::now());
+			if (previous != trace)
+			{
+				trace->end_frame();
+			}
+
+			Trace::current() = previous;
+		}
+
+	private:
+		const char *name;
+		Trace *trace, *previous;
+		Trace::Clock::time_point start;
+	};
+
+	inline Trace::Trace() : origin(Clock::now()), dropped(0)
+	{
+		for (int i = 0; i != TRACE_COUNTERS; ++i)
+		{
+			counters[i] = 0;
+			last_frame.counters[i] = 0;
+		}
+	}
+
+	inline bool Trace::enabled()
+	{
+#ifdef CPPLOT_TRACE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	inline Trace*& Trace::current()
+	{
+		thread_local Trace *trace = nullptr;
+
+		return trace;
+	}
+
+	inline void Trace::add(TraceCounter counter, unsigned long long value)
+	{
+		Trace *trace = Trace::current();
+		if (trace)
+		{
+			trace->counters[counter].fetch_add(value, std::memory_order_relaxed);
+		}
+	}
+
+	inline void Trace::phase(const char *name, Clock::time_point start,
+		Clock::time_point end)
+	{
+		double start_us = std::chrono::duration<double, std::micro>(start - origin).count();
+		double duration_us = std::chrono::duration<double, std::micro>(end - start).count();
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		TracePhase& total = phases[name];
+		++total.calls;
+		total.total_ms += duration_us / 1000.0;
+
+		if (events.size() >= TRACE_EVENT_LIMIT)
+		{
+			++dropped;
+			return;
+		}
+
+		std::thread::id id = std::this_thread::get_id();
+		int thread = (int)(std::find(threads.begin(), threads.end(), id) - threads.begin());
+		if (thread == (int)threads.size())
+		{
+			threads.push_back(id);
+		}
+
+		events.push_back(Event{ name, thread, start_us, duration_us });
+	}
+
+	inline void Trace::end_frame()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Mark mark;
+		mark.time_us = std::chrono::duration<double, std::micro>(Clock::now() - origin).count();
+
+		last_frame.phases.swap(phases);
+		phases.clear();
+		for (int i = 0; i != TRACE_COUNTERS; ++i)
+		{
+			last_frame.counters[i] = counters[i].exchange(0, std::memory_order_relaxed);
+			mark.counters[i] = last_frame.counters[i];
+		}
+
+		if (marks.size() < TRACE_EVENT_LIMIT)
+		{
+			marks.push_back(mark);
+		}
+	}
+
+	inline TraceStats Trace::get_frame_stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return last_frame;
+	}
+
+	inline void Trace::write_json(std::string& json) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (dropped)
+		{
+			printf("Warning: %zu events exceeding TRACE_EVENT_LIMIT were not kept.\n", dropped);
+		}
+
+		char buffer[256];
+		json += "{\"traceEvents\":[";
+
+		// The names are string literals of the code, which need no escaping
+		for (size_t i = 0; i != events.size(); ++i)
+		{
+			const Event& event = events[i];
+			snprintf(buffer, sizeof(buffer), "%s\n{\"name\":\"%s\",\"cat\":\"cpplot\",\"ph\":\"X\","
+				"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", i ? "," : "",
+				event.name, event.start_us, event.duration_us, event.thread);
+			json += buffer;
+		}
+
+		for (size_t i = 0; i != marks.size(); ++i)
+		{
+			const Mark& mark = marks[i];
+			snprintf(buffer, sizeof(buffer), "%s\n{\"name\":\"frame\",\"cat\":\"cpplot\",\"ph\":\"C\","
+				"\"ts\":%.3f,\"pid\":1,\"tid\":0,\"args\":{\"points\":%llu,\"primitives\":%llu,"
+				"\"allocations\":%llu,\"cache_hits\":%llu}}", events.empty() && !i ? "" : ",",
+				mark.time_us, mark.counters[TRACE_POINTS], mark.counters[TRACE_PRIMITIVES],
+				mark.counters[TRACE_ALLOCATIONS], mark.counters[TRACE_CACHE_HITS]);
+			json += buffer;
+		}
+
+		json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	inline void Trace::clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		origin = Clock::now();
+		events.clear();
+		marks.clear();
+		threads.clear();
+		dropped = 0;
+		phases.clear();
+		last_frame.phases.clear();
+		for (int i = 0; i != TRACE_COUNTERS; ++i)
+		{
+			counters[i] = 0;
+			last_frame.counters[i] = 0;
+		}
+	}
+}
+
+#define CPPLOT_TRACE_JOIN_INNER(a, b) a##b
+#define CPPLOT_TRACE_JOIN(a, b) CPPLOT_TRACE_JOIN_INNER(a, b)
+
+#ifdef CPPLOT_TRACE
+// Time the rest of the enclosing scope as the phase name
+#define CPPLOT_TRACE_SCOPE(name) \
+	cpplot::TraceScope CPPLOT_TRACE_JOIN(trace_scope_, __LINE__)(name)
+
+// Add value to a TraceCounter of the bound trace
+#define CPPLOT_TRACE_COUNT(counter, value) cpplot::Trace::add(counter, value)
+
+// Bind the trace to the thread for the rest of the enclosing scope
+#define CPPLOT_TRACE_BIND(trace) \
+	cpplot::TraceBind CPPLOT_TRACE_JOIN(trace_bind_, __LINE__)(trace)
+
+// Bind the trace and time the rest of the enclosing scope as the phase
+// name, which closes the frame
+#define CPPLOT_TRACE_FRAME(trace, name) \
+	cpplot::TraceFrame CPPLOT_TRACE_JOIN(trace_frame_, __LINE__)(trace, name)
+#else
+#define CPPLOT_TRACE_SCOPE(name) ((void)0)
+#define CPPLOT_TRACE_COUNT(counter, value) ((void)0)
+#define CPPLOT_TRACE_BIND(trace) ((void)0)
+#define CPPLOT_TRACE_FRAME(trace, name) ((void)0)
+#endif
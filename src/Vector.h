@@ -0,0 +1,1329 @@
+#pragma once
+#include "Header.h"
+#include "Canvas.h"
+#include "Framebuffer.h"
+#include "Bitmap.h"
+#include "Deflate.h"
+
+#include <set>
+#include <tuple>
+
+namespace cpplot
+{
+	namespace Encoding
+	{
+		// Whether the extension (in lower case) is written by a vector canvas
+		inline bool is_vector_format(const std::string& extension)
+		{
+			return extension == "svg" || extension == "pdf";
+		}
+	}
+
+	/*
+	Base of the canvases writing a vector document (CanvasSVG and CanvasPDF)
+	instead of pixels. The primitives are written to the sink as they come and
+	only about VECTOR_BUFFER_SIZE bytes are held, so also figures of large series
+	are written with bounded memory. Consecutive lines of the same pen are joined
+	to a single path. With the decimation of the options, the points of polylines
+	and the shapes of batches, which do not change the drawing at the pixel
+	precision of the coordinates, are left out.
+	*/
+	class CanvasVector : public Canvas
+	{
+	public:
+		CanvasVector(ImageSink& in_sink, int in_width, int in_height,
+			const ImageOptions& in_options, int in_font_scale = FONT_SCALE);
+
+		virtual void select_pen(COLORREF color, int width);
+
+		virtual void select_brush(COLORREF color);
+
+		virtual void select_font(int escapement, bool bold);
+
+		virtual UINT set_text_align(UINT align);
+
+		virtual TextMetric get_text_metrics();
+
+		virtual void move_to(int x, int y);
+
+		virtual void line_to(int x, int y);
+
+		virtual void polyline(const POINT *points, int count);
+
+		virtual void polypolyline(const POINT *points, const DWORD *counts,
+			int polylines);
+
+		virtual void rectangle(int left, int top, int right, int bottom);
+
+		virtual void rectangles(const RECT *rects, int count);
+
+		virtual void ellipse(int left, int top, int right, int bottom);
+
+		virtual void ellipses(const RECT *rects, int count);
+
+		// Write the end of the document, false if any write to the sink failed
+		virtual bool finish() = 0;
+
+	protected:
+		// Open and close a path stroked with the current pen
+		virtual void begin_stroke() = 0;
+
+		virtual void end_stroke() = 0;
+
+		// Start a subpath or continue it with a line, path_x and path_y
+		// hold the previous point of the path
+		virtual void move_point(int x, int y) = 0;
+
+		virtual void line_point(int x, int y) = 0;
+
+		// Open and close a path of shapes filled with the current brush
+		// and outlined with the current pen
+		virtual void begin_shapes() = 0;
+
+		virtual void end_shapes() = 0;
+
+		// Add a shape to the path, the coordinates follow Canvas::rectangle
+		virtual void rectangle_path(int left, int top, int right, int bottom) = 0;
+
+		virtual void ellipse_path(int left, int top, int right, int bottom) = 0;
+
+		// Write a piece of the buffered content to the sink
+		virtual void write_content(const char *data, size_t length) = 0;
+
+		// Close the open stroke path before other primitives or a new pen
+		void flush_stroke();
+
+		// Write the buffered content once it is long enough, or always if forced
+		void flush(bool force = false);
+
+		// Write the bytes to the sink directly, bypassing the content
+		void write(const char *data, size_t length);
+
+		void put(const char *text) { content.append(text); }
+
+		void put(char c) { content.push_back(c); }
+
+		void put(int value);
+
+		// Number with at most decimals digits after the decimal point
+		void put(double value, int decimals = 2);
+
+		// Count of the characters of UTF-8 text
+		static int character_count(const char *text, int length);
+
+		// Start of the baseline of a text of count characters drawn at x and y
+		// w.r.t. the alignment and the rotation of the text
+		void text_origin(int x, int y, int count, double& base_x, double& base_y) const;
+
+		// Size of the font, whose characters are as wide as those of the
+		// bitmap font of the CanvasMemory, so that the layout is the same
+		double font_size() const { return Font::cell_width * font_scale / 0.6; }
+
+		ImageSink& sink;
+		int width, height;
+		ImageOptions options;
+		bool failed; // whether a write to the sink failed
+		size_t written; // number of bytes written to the sink
+
+		COLORREF pen_color, brush_color, text_color;
+		int pen_width;
+		int pos_x, pos_y; // current position
+		UINT text_align;
+		int escapement; // font rotation in tenths of degrees
+		bool bold;
+		int font_scale;
+
+		bool stroking; // whether a stroke path is open
+		bool path_started; // whether the open stroke path has a current point
+		int path_x, path_y; // current point of the open stroke path
+
+	private:
+		// Add the point to the decimated points, points on the line
+		// between the two preceding ones only extend it
+		void push_reduced(POINT point);
+
+		// Reduce the points of every column to the first, the lowest,
+		// the highest and the last one
+		void decimate(const POINT *points, int count);
+
+		std::string content; // content not written to the sink yet
+		std::vector<POINT> reduced; // decimated points of a polyline
+	};
+
+	inline CanvasVector::CanvasVector(ImageSink& in_sink, int in_width, int in_height,
+		const ImageOptions& in_options, int in_font_scale) :
+		sink(in_sink), width(in_width), height(in_height), options(in_options),
+		failed(false), written(0), pen_color(BLACK), brush_color(WHITE),
+		text_color(BLACK), pen_width(1), pos_x(0), pos_y(0),
+		text_align(TA_LEFT | TA_TOP), escapement(0), bold(false),
+		font_scale(in_font_scale > 0 ? in_font_scale : 1), stroking(false),
+		path_started(false), path_x(0), path_y(0)
+	{
+		content.reserve(VECTOR_BUFFER_SIZE + 1024);
+	}
+
+	inline void CanvasVector::select_pen(COLORREF color, int in_width)
+	{
+		in_width = in_width > 1 ? in_width : 1;
+		if (color != pen_color || in_width != pen_width)
+		{
+			this->flush_stroke();
+		}
+
+		pen_color = color;
+		pen_width = in_width;
+	}
+
+	inline void CanvasVector::select_brush(COLORREF color)
+	{
+		brush_color = color;
+	}
+
+	inline void CanvasVector::select_font(int in_escapement, bool in_bold)
+	{
+		escapement = in_escapement;
+		bold = in_bold;
+	}
+
+	inline UINT CanvasVector::set_text_align(UINT align)
+	{
+		UINT prev_align = text_align;
+		text_align = align;
+
+		return prev_align;
+	}
+
+	inline TextMetric CanvasVector::get_text_metrics()
+	{
+		return TextMetric{ Font::cell_height * font_scale, Font::cell_width * font_scale };
+	}
+
+	inline void CanvasVector::move_to(int x, int y)
+	{
+		pos_x = x;
+		pos_y = y;
+	}
+
+	inline void CanvasVector::line_to(int x, int y)
+	{
+		if (!stroking)
+		{
+			this->begin_stroke();
+			stroking = true;
+			path_started = false;
+		}
+
+		if (!path_started || path_x != pos_x || path_y != pos_y)
+		{
+			this->move_point(pos_x, pos_y);
+			path_x = pos_x;
+			path_y = pos_y;
+			path_started = true;
+		}
+
+		this->line_point(x, y);
+		path_x = pos_x = x;
+		path_y = pos_y = y;
+
+		this->flush();
+	}
+
+	inline void CanvasVector::polyline(const POINT *points, int count)
+	{
+		// A single point draws nothing, as on the other canvases
+		if (count < 2)
+		{
+			return;
+		}
+
+		if (options.decimate)
+		{
+			this->decimate(points, count);
+			points = reduced.data();
+			count = (int)reduced.size();
+		}
+
+		pos_x = points[0].x;
+		pos_y = points[0].y;
+		for (int i = 1; i < count; ++i)
+		{
+			this->line_to(points[i].x, points[i].y);
+		}
+	}
+
+	inline void CanvasVector::polypolyline(const POINT *points, const DWORD *counts,
+		int polylines)
+	{
+		for (int i = 0; i != polylines; ++i)
+		{
+			this->polyline(points, (int)counts[i]);
+			points += counts[i];
+		}
+	}
+
+	inline void CanvasVector::rectangle(int left, int top, int right, int bottom)
+	{
+		RECT rect = { left, top, right, bottom };
+		this->rectangles(&rect, 1);
+	}
+
+	inline void CanvasVector::rectangles(const RECT *rects, int count)
+	{
+		this->flush_stroke();
+		this->begin_shapes();
+
+		// Shapes drawn again over themselves do not change the drawing
+		std::set<std::tuple<int, int, int, int>> drawn;
+		for (int i = 0; i != count; ++i)
+		{
+			RECT rect = rects[i];
+			if (rect.right < rect.left) { std::swap(rect.left, rect.right); }
+			if (rect.bottom < rect.top) { std::swap(rect.top, rect.bottom); }
+
+			if (options.decimate &&
+				!drawn.insert(std::make_tuple(rect.left, rect.top, rect.right, rect.bottom)).second)
+			{
+				continue;
+			}
+
+			this->rectangle_path(rect.left, rect.top, rect.right, rect.bottom);
+			this->flush();
+		}
+
+		this->end_shapes();
+		this->flush();
+	}
+
+	inline void CanvasVector::ellipse(int left, int top, int right, int bottom)
+	{
+		RECT rect = { left, top, right, bottom };
+		this->ellipses(&rect, 1);
+	}
+
+	inline void CanvasVector::ellipses(const RECT *rects, int count)
+	{
+		this->flush_stroke();
+		this->begin_shapes();
+
+		std::set<std::tuple<int, int, int, int>> drawn;
+		for (int i = 0; i != count; ++i)
+		{
+			RECT rect = rects[i];
+			if (rect.right < rect.left) { std::swap(rect.left, rect.right); }
+			if (rect.bottom < rect.top) { std::swap(rect.top, rect.bottom); }
+
+			if (options.decimate &&
+				!drawn.insert(std::make_tuple(rect.left, rect.top, rect.right, rect.bottom)).second)
+			{
+				continue;
+			}
+
+			this->ellipse_path(rect.left, rect.top, rect.right, rect.bottom);
+			this->flush();
+		}
+
+		this->end_shapes();
+		this->flush();
+	}
+
+	inline void CanvasVector::flush_stroke()
+	{
+		if (stroking)
+		{
+			this->end_stroke();
+			stroking = false;
+		}
+	}
+
+	inline void CanvasVector::flush(bool force)
+	{
+		if (content.size() >= VECTOR_BUFFER_SIZE || (force && !content.empty()))
+		{
+			this->write_content(content.data(), content.size());
+			content.clear();
+		}
+	}
+
+	inline void CanvasVector::write(const char *data, size_t length)
+	{
+		if (!failed && !sink.write((const unsigned char *)data, length))
+		{
+			failed = true;
+		}
+		written += length;
+	}
+
+	inline void CanvasVector::put(int value)
+	{
+		char digits[12];
+		int count = 0;
+		unsigned int magnitude = value < 0 ? 0U - (unsigned int)value : (unsigned int)value;
+		do
+		{
+			digits[count++] = (char)('0' + magnitude % 10);
+			magnitude /= 10;
+		} while (magnitude);
+
+		if (value < 0)
+		{
+			content.push_back('-');
+		}
+		while (count)
+		{
+			content.push_back(digits[--count]);
+		}
+	}
+
+	inline void CanvasVector::put(double value, int decimals)
+	{
+		char number[32];
+		snprintf(number, sizeof(number), "%.*f", decimals, value);
+
+		// Strip the trailing zeros and the decimal point
+		size_t length = strlen(number);
+		if (strchr(number, '.'))
+		{
+			while (number[length - 1] == '0') { --length; }
+			if (number[length - 1] == '.') { --length; }
+		}
+		number[length] = '\0';
+
+		this->put(strcmp(number, "-0") ? number : "0");
+	}
+
+	inline int CanvasVector::character_count(const char *text, int length)
+	{
+		int count = 0;
+		for (int i = 0; i != length; ++i)
+		{
+			if (((unsigned char)text[i] & 0xC0) != 0x80)
+			{
+				++count;
+			}
+		}
+
+		return count;
+	}
+
+	inline void CanvasVector::text_origin(int x, int y, int count,
+		double& base_x, double& base_y) const
+	{
+		int text_width = count * Font::cell_width * font_scale;
+		int text_height = Font::cell_height * font_scale;
+		int ascent = (Font::glyph_height - 1) * font_scale;
+
+		// Offsets of the reference point w.r.t. the text alignment
+		int ref_u = 0, ref_v = 0;
+		if ((text_align & TA_CENTER) == TA_CENTER)
+		{
+			ref_u = text_width / 2;
+		}
+		else if (text_align & TA_RIGHT)
+		{
+			ref_u = text_width;
+		}
+
+		if ((text_align & TA_BASELINE) == TA_BASELINE)
+		{
+			ref_v = ascent;
+		}
+		else if (text_align & TA_BOTTOM)
+		{
+			ref_v = text_height;
+		}
+
+		// The text runs along (cos, -sin) and the baseline is below the top
+		// along (sin, cos) as the y axis points down
+		double angle = escapement * 3.14159265358979323846 / 1800.0;
+		double below = ascent - ref_v;
+		base_x = x - ref_u * cos(angle) + below * sin(angle);
+		base_y = y + ref_u * sin(angle) + below * cos(angle);
+	}
+
+	inline void CanvasVector::push_reduced(POINT point)
+	{
+		size_t n = reduced.size();
+		if (n && reduced[n - 1].x == point.x && reduced[n - 1].y == point.y)
+		{
+			return;
+		}
+
+		if (n >= 2)
+		{
+			long long ax = reduced[n - 1].x - reduced[n - 2].x;
+			long long ay = reduced[n - 1].y - reduced[n - 2].y;
+			long long bx = point.x - reduced[n - 1].x;
+			long long by = point.y - reduced[n - 1].y;
+
+			if (ax * by == ay * bx && ax * bx + ay * by > 0)
+			{
+				reduced[n - 1] = point;
+				return;
+			}
+		}
+
+		reduced.push_back(point);
+	}
+
+	inline void CanvasVector::decimate(const POINT *points, int count)
+	{
+		reduced.clear();
+
+		for (int begin = 0; begin < count;)
+		{
+			int end = begin + 1;
+			int low = begin, high = begin;
+			while (end < count && points[end].x == points[begin].x)
+			{
+				low = points[end].y < points[low].y ? end : low;
+				high = points[end].y > points[high].y ? end : high;
+				++end;
+			}
+
+			// Keep the points in their original order
+			int positions[4] = { begin, low, high, end - 1 };
+			std::sort(positions, positions + 4);
+			for (int i = 0; i != 4; ++i)
+			{
+				if (i == 0 || positions[i] != positions[i - 1])
+				{
+					this->push_reduced(points[positions[i]]);
+				}
+			}
+
+			begin = end;
+		}
+
+		// A line of the same points still paints a dot with a wide pen
+		if (reduced.size() == 1)
+		{
+			reduced.push_back(reduced[0]);
+		}
+	}
+
+	/*
+	Canvas writing an SVG document. Every stroke path and batch of shapes is
+	a single path element with relative coordinates, the images are embedded
+	as PNG.
+	*/
+	class CanvasSVG : public CanvasVector
+	{
+	public:
+		CanvasSVG(ImageSink& in_sink, int in_width, int in_height,
+			const ImageOptions& in_options = ImageOptions(), int in_font_scale = FONT_SCALE);
+
+		virtual void text_out(int x, int y, const char *text, int length);
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba);
+
+		virtual void set_clip(const RECT *clip);
+
+		virtual bool finish();
+
+	protected:
+		virtual void begin_stroke();
+
+		virtual void end_stroke();
+
+		virtual void move_point(int x, int y);
+
+		virtual void line_point(int x, int y);
+
+		virtual void begin_shapes();
+
+		virtual void end_shapes();
+
+		virtual void rectangle_path(int left, int top, int right, int bottom);
+
+		virtual void ellipse_path(int left, int top, int right, int bottom);
+
+		virtual void write_content(const char *data, size_t length);
+
+	private:
+		void put_color(COLORREF color);
+
+		// Put the text with the XML special characters escaped
+		void put_escaped(const char *text, int length);
+
+		bool line_started; // whether the stroke path continues with a line command
+		bool clipped; // whether a clipped group is open
+		int clips; // number of the clip paths written
+	};
+
+	inline CanvasSVG::CanvasSVG(ImageSink& in_sink, int in_width, int in_height,
+		const ImageOptions& in_options, int in_font_scale) :
+		CanvasVector(in_sink, in_width, in_height, in_options, in_font_scale),
+		line_started(false), clipped(false), clips(0)
+	{
+		this->put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<svg xmlns=\"http://www.w3.org/2000/svg\" "
+			"xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"");
+		this->put(width);
+		this->put("\" height=\"");
+		this->put(height);
+		this->put("\" viewBox=\"0 0 ");
+		this->put(width);
+		this->put(' ');
+		this->put(height);
+		this->put("\">\n<rect width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n");
+
+		// Coordinates address the centres of the pixels
+		this->put("<g fill=\"none\" stroke-linecap=\"round\" stroke-linejoin=\"round\" "
+			"font-family=\"Courier New, Courier, monospace\" transform=\"translate(0.5 0.5)\">\n");
+	}
+
+	inline void CanvasSVG::put_color(COLORREF color)
+	{
+		static const char hex[] = "0123456789abcdef";
+		unsigned char channels[3] = { GetRValue(color), GetGValue(color), GetBValue(color) };
+
+		this->put('#');
+		for (int i = 0; i != 3; ++i)
+		{
+			this->put(hex[channels[i] >> 4]);
+			this->put(hex[channels[i] & 0xF]);
+		}
+	}
+
+	inline void CanvasSVG::put_escaped(const char *text, int length)
+	{
+		for (int i = 0; i != length; ++i)
+		{
+			switch (text[i])
+			{
+			case '&': this->put("&amp;"); break;
+			case '<': this->put("&lt;"); break;
+			case '>': this->put("&gt;"); break;
+			case '"': this->put("&quot;"); break;
+			default: this->put(text[i]); break;
+			}
+		}
+	}
+
+	inline void CanvasSVG::begin_stroke()
+	{
+		this->put("<path stroke=\"");
+		this->put_color(pen_color);
+		if (pen_width != 1)
+		{
+			this->put("\" stroke-width=\"");
+			this->put(pen_width);
+		}
+		this->put("\" d=\"");
+	}
+
+	inline void CanvasSVG::end_stroke()
+	{
+		this->put("\"/>\n");
+	}
+
+	inline void CanvasSVG::move_point(int x, int y)
+	{
+		this->put('M');
+		this->put(x);
+		this->put(' ');
+		this->put(y);
+		line_started = false;
+	}
+
+	inline void CanvasSVG::line_point(int x, int y)
+	{
+		// Repeated relative lines need no command, minus signs separate the numbers
+		int dx = x - path_x;
+		int dy = y - path_y;
+		if (!line_started)
+		{
+			this->put('l');
+			line_started = true;
+		}
+		else if (dx >= 0)
+		{
+			this->put(' ');
+		}
+
+		this->put(dx);
+		if (dy >= 0)
+		{
+			this->put(' ');
+		}
+		this->put(dy);
+	}
+
+	inline void CanvasSVG::begin_shapes()
+	{
+		this->put("<path fill=\"");
+		this->put_color(brush_color);
+		this->put("\" stroke=\"");
+		this->put_color(pen_color);
+		if (pen_width != 1)
+		{
+			this->put("\" stroke-width=\"");
+			this->put(pen_width);
+		}
+		this->put("\" d=\"");
+	}
+
+	inline void CanvasSVG::end_shapes()
+	{
+		this->put("\"/>\n");
+	}
+
+	inline void CanvasSVG::rectangle_path(int left, int top, int right, int bottom)
+	{
+		// The outline passes through the last column and row of the rectangle
+		this->put('M');
+		this->put(left);
+		this->put(' ');
+		this->put(top);
+		this->put('h');
+		this->put(right - left - 1);
+		this->put('v');
+		this->put(bottom - top - 1);
+		this->put('h');
+		this->put(left + 1 - right);
+		this->put('z');
+	}
+
+	inline void CanvasSVG::ellipse_path(int left, int top, int right, int bottom)
+	{
+		double radius_x = (right - left - 1) * 0.5;
+		double radius_y = (bottom - top - 1) * 0.5;
+
+		// Two arcs between the leftmost and the rightmost point
+		this->put('M');
+		this->put(left);
+		this->put(' ');
+		this->put((top + bottom - 1) * 0.5);
+		for (int i = 0; i != 2; ++i)
+		{
+			this->put('a');
+			this->put(radius_x);
+			this->put(' ');
+			this->put(radius_y);
+			this->put(" 0 1 0 ");
+			this->put(i ? left + 1 - right : right - left - 1);
+			this->put(" 0");
+		}
+		this->put('z');
+	}
+
+	inline void CanvasSVG::text_out(int x, int y, const char *text, int length)
+	{
+		this->flush_stroke();
+
+		int count = character_count(text, length);
+		double base_x, base_y;
+		this->text_origin(x, y, count, base_x, base_y);
+
+		// The text is stretched to the width of the layout, as the widths
+		// of the installed monospace fonts differ
+		this->put("<text x=\"");
+		this->put(base_x);
+		this->put("\" y=\"");
+		this->put(base_y);
+		this->put("\" font-size=\"");
+		this->put(this->font_size());
+		this->put("\" textLength=\"");
+		this->put(count * Font::cell_width * font_scale);
+		this->put("\" lengthAdjust=\"spacingAndGlyphs\" fill=\"");
+		this->put_color(text_color);
+		if (bold)
+		{
+			this->put("\" font-weight=\"bold");
+		}
+		if (escapement % 3600)
+		{
+			this->put("\" transform=\"rotate(");
+			this->put(-escapement / 10.0, 1);
+			this->put(' ');
+			this->put(base_x);
+			this->put(' ');
+			this->put(base_y);
+			this->put(')');
+		}
+		this->put("\">");
+		this->put_escaped(text, length);
+		this->put("</text>\n");
+
+		this->flush();
+	}
+
+	inline void CanvasSVG::image(int left, int top, int width, int height,
+		const unsigned char *rgba)
+	{
+		this->flush_stroke();
+
+		// Pixels with any alpha are opaque, as on the other canvases
+		Framebuffer pixels(width, height);
+		unsigned char *target = pixels.get_data();
+		for (size_t i = 0; i != (size_t)width * height * 4; i += 4)
+		{
+			memcpy(target + i, rgba + i, 3);
+			target[i + 3] = rgba[i + 3] ? 255 : 0;
+		}
+
+		MemorySink png;
+		WritePNG(pixels, png, options);
+
+		this->put("<image x=\"");
+		this->put(left - 0.5);
+		this->put("\" y=\"");
+		this->put(top - 0.5);
+		this->put("\" width=\"");
+		this->put(width);
+		this->put("\" height=\"");
+		this->put(height);
+		this->put("\" image-rendering=\"pixelated\" xlink:href=\"data:image/png;base64,");
+
+		static const char base64[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		const std::vector<unsigned char>& data = png.get_data();
+		for (size_t i = 0; i < data.size(); i += 3)
+		{
+			unsigned long group = (unsigned long)data[i] << 16;
+			group |= i + 1 < data.size() ? (unsigned long)data[i + 1] << 8 : 0;
+			group |= i + 2 < data.size() ? data[i + 2] : 0;
+
+			this->put(base64[(group >> 18) & 63]);
+			this->put(base64[(group >> 12) & 63]);
+			this->put(i + 1 < data.size() ? base64[(group >> 6) & 63] : '=');
+			this->put(i + 2 < data.size() ? base64[group & 63] : '=');
+
+			this->flush();
+		}
+		this->put("\"/>\n");
+
+		this->flush();
+	}
+
+	inline void CanvasSVG::set_clip(const RECT *clip)
+	{
+		this->flush_stroke();
+
+		if (clipped)
+		{
+			this->put("</g>\n");
+			clipped = false;
+		}
+
+		if (!clip)
+		{
+			return;
+		}
+
+		// The clip path covers the pixels, whose centres are the coordinates
+		this->put("<clipPath id=\"clip");
+		this->put(clips);
+		this->put("\"><rect x=\"");
+		this->put(clip->left - 0.5, 1);
+		this->put("\" y=\"");
+		this->put(clip->top - 0.5, 1);
+		this->put("\" width=\"");
+		this->put((int)(clip->right - clip->left));
+		this->put("\" height=\"");
+		this->put((int)(clip->bottom - clip->top));
+		this->put("\"/></clipPath>\n<g clip-path=\"url(#clip");
+		this->put(clips);
+		this->put(")\">\n");
+
+		++clips;
+		clipped = true;
+	}
+
+	inline bool CanvasSVG::finish()
+	{
+		this->set_clip(nullptr);
+		this->put("</g>\n</svg>\n");
+		this->flush(true);
+
+		return !failed;
+	}
+
+	inline void CanvasSVG::write_content(const char *data, size_t length)
+	{
+		this->write(data, length);
+	}
+
+	/*
+	Canvas writing a single-page PDF document. The page content is compressed
+	while it is written, the images are kept compressed in memory and written
+	as image objects after it. Text uses the standard Courier fonts, whose
+	characters have the width of the layout.
+	*/
+	class CanvasPDF : public CanvasVector
+	{
+	public:
+		CanvasPDF(ImageSink& in_sink, int in_width, int in_height,
+			const ImageOptions& in_options = ImageOptions(), int in_font_scale = FONT_SCALE);
+
+		virtual void text_out(int x, int y, const char *text, int length);
+
+		virtual void image(int left, int top, int width, int height,
+			const unsigned char *rgba);
+
+		virtual void set_clip(const RECT *clip);
+
+		virtual bool finish();
+
+	protected:
+		virtual void begin_stroke();
+
+		virtual void end_stroke();
+
+		virtual void move_point(int x, int y);
+
+		virtual void line_point(int x, int y);
+
+		virtual void begin_shapes();
+
+		virtual void end_shapes();
+
+		virtual void rectangle_path(int left, int top, int right, int bottom);
+
+		virtual void ellipse_path(int left, int top, int right, int bottom);
+
+		virtual void write_content(const char *data, size_t length);
+
+	private:
+		// Numbers of the objects written before the images
+		enum { CATALOG = 1, PAGES, PAGE, CONTENT, LENGTH, FONT, BOLD_FONT, IMAGES, FIRST_IMAGE };
+
+		struct Image
+		{
+			int width, height;
+			std::vector<unsigned char> color; // compressed RGB samples
+			std::vector<unsigned char> alpha; // compressed mask, empty for opaque images
+		};
+
+		// Start the object of the number at the current offset
+		void begin_object(int number);
+
+		void write(const std::string& text) { CanvasVector::write(text.data(), text.size()); }
+
+		// Write the compressed bytes of the content to the sink
+		void drain();
+
+		void put_color(COLORREF color, const char *operation);
+
+		// Set the colour and the width of the strokes and the fill colour if they changed
+		void set_stroke();
+
+		void set_fill(COLORREF color);
+
+		static std::vector<unsigned char> compress(const std::vector<unsigned char>& data, int level);
+
+		Encoding::Deflater deflater;
+		size_t content_length; // compressed bytes of the content
+
+		std::vector<size_t> offsets; // offsets of the objects by their numbers
+		std::vector<Image> images;
+
+		// State of the page, -1 if not set
+		long stroke_color, fill_color;
+		int line_width;
+
+		// Whether the clipped state is saved and the state to which it returns
+		bool clipped;
+		long saved_stroke_color, saved_fill_color;
+		int saved_line_width;
+	};
+
+	inline CanvasPDF::CanvasPDF(ImageSink& in_sink, int in_width, int in_height,
+		const ImageOptions& in_options, int in_font_scale) :
+		CanvasVector(in_sink, in_width, in_height, in_options, in_font_scale),
+		deflater(in_options.compression), content_length(0), offsets(FIRST_IMAGE, 0),
+		stroke_color(-1), fill_color(-1), line_width(-1), clipped(false),
+		saved_stroke_color(-1), saved_fill_color(-1), saved_line_width(-1)
+	{
+		std::string size = std::to_string(width) + " " + std::to_string(height);
+
+		this->write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+
+		this->begin_object(CATALOG);
+		this->write("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+		this->begin_object(PAGES);
+		this->write("<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+
+		this->begin_object(PAGE);
+		this->write("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + size + "]\n"
+			"/Resources << /Font << /F1 6 0 R /F2 7 0 R >> /XObject 8 0 R >>\n"
+			"/Contents 4 0 R >>\nendobj\n");
+
+		this->begin_object(FONT);
+		this->write("<< /Type /Font /Subtype /Type1 /BaseFont /Courier "
+			"/Encoding /WinAnsiEncoding >>\nendobj\n");
+
+		this->begin_object(BOLD_FONT);
+		this->write("<< /Type /Font /Subtype /Type1 /BaseFont /Courier-Bold "
+			"/Encoding /WinAnsiEncoding >>\nendobj\n");
+
+		this->begin_object(CONTENT);
+		this->write("<< /Length 5 0 R /Filter /FlateDecode >>\nstream\n");
+
+		// White page, the y axis points down and the coordinates address
+		// the centres of the pixels
+		this->put(("1 1 1 rg 0 0 " + size + " re f\n").c_str());
+		this->put("1 0 0 -1 0 ");
+		this->put(height);
+		this->put(" cm 1 0 0 1 0.5 0.5 cm 1 J 1 j\n");
+		fill_color = WHITE;
+	}
+
+	inline void CanvasPDF::begin_object(int number)
+	{
+		if ((size_t)number >= offsets.size())
+		{
+			offsets.resize(number + 1, 0);
+		}
+		offsets[number] = written;
+
+		this->write(std::to_string(number) + " 0 obj\n");
+	}
+
+	inline void CanvasPDF::put_color(COLORREF color, const char *operation)
+	{
+		this->put(GetRValue(color) / 255.0, 3);
+		this->put(' ');
+		this->put(GetGValue(color) / 255.0, 3);
+		this->put(' ');
+		this->put(GetBValue(color) / 255.0, 3);
+		this->put(' ');
+		this->put(operation);
+		this->put('\n');
+	}
+
+	inline void CanvasPDF::set_stroke()
+	{
+		if (stroke_color != (long)pen_color)
+		{
+			this->put_color(pen_color, "RG");
+			stroke_color = pen_color;
+		}
+
+		if (line_width != pen_width)
+		{
+			this->put(pen_width);
+			this->put(" w\n");
+			line_width = pen_width;
+		}
+	}
+
+	inline void CanvasPDF::set_fill(COLORREF color)
+	{
+		if (fill_color != (long)color)
+		{
+			this->put_color(color, "rg");
+			fill_color = color;
+		}
+	}
+
+	inline void CanvasPDF::begin_stroke()
+	{
+		this->set_stroke();
+	}
+
+	inline void CanvasPDF::end_stroke()
+	{
+		this->put("S\n");
+	}
+
+	inline void CanvasPDF::move_point(int x, int y)
+	{
+		this->put(x);
+		this->put(' ');
+		this->put(y);
+		this->put(" m\n");
+	}
+
+	inline void CanvasPDF::line_point(int x, int y)
+	{
+		this->put(x);
+		this->put(' ');
+		this->put(y);
+		this->put(" l\n");
+	}
+
+	inline void CanvasPDF::begin_shapes()
+	{
+		this->set_stroke();
+		this->set_fill(brush_color);
+	}
+
+	inline void CanvasPDF::end_shapes()
+	{
+		this->put("B\n");
+	}
+
+	inline void CanvasPDF::rectangle_path(int left, int top, int right, int bottom)
+	{
+		this->put(left);
+		this->put(' ');
+		this->put(top);
+		this->put(' ');
+		this->put(right - left - 1);
+		this->put(' ');
+		this->put(bottom - top - 1);
+		this->put(" re\n");
+	}
+
+	inline void CanvasPDF::ellipse_path(int left, int top, int right, int bottom)
+	{
+		// Four Bezier curves, one per quadrant
+		double centre_x = (left + right - 1) * 0.5;
+		double centre_y = (top + bottom - 1) * 0.5;
+		double radius_x = (right - left - 1) * 0.5;
+		double radius_y = (bottom - top - 1) * 0.5;
+		double kappa = 0.5522847498;
+		double kx = kappa * radius_x, ky = kappa * radius_y;
+
+		double curves[4][6] = {
+			{ centre_x + radius_x, centre_y + ky, centre_x + kx, centre_y + radius_y, centre_x, centre_y + radius_y },
+			{ centre_x - kx, centre_y + radius_y, centre_x - radius_x, centre_y + ky, centre_x - radius_x, centre_y },
+			{ centre_x - radius_x, centre_y - ky, centre_x - kx, centre_y - radius_y, centre_x, centre_y - radius_y },
+			{ centre_x + kx, centre_y - radius_y, centre_x + radius_x, centre_y - ky, centre_x + radius_x, centre_y }
+		};
+
+		this->put(centre_x + radius_x);
+		this->put(' ');
+		this->put(centre_y);
+		this->put(" m\n");
+		for (int i = 0; i != 4; ++i)
+		{
+			for (int j = 0; j != 6; ++j)
+			{
+				this->put(curves[i][j]);
+				this->put(' ');
+			}
+			this->put("c\n");
+		}
+		this->put("h\n");
+	}
+
+	inline void CanvasPDF::text_out(int x, int y, const char *text, int length)
+	{
+		this->flush_stroke();
+		this->set_fill(text_color);
+
+		// Characters outside of WinAnsiEncoding (Latin-1 here) are written as '?'
+		std::string latin;
+		for (int i = 0; i < length;)
+		{
+			unsigned char lead = (unsigned char)text[i];
+			int extra = lead < 0x80 ? 0 : (lead >= 0xF0 ? 3 : (lead >= 0xE0 ? 2 : 1));
+			unsigned long code = extra ? lead & (0x3F >> extra) : lead;
+			for (int j = 1; j <= extra && i + j < length; ++j)
+			{
+				code = (code << 6) | ((unsigned char)text[i + j] & 0x3F);
+			}
+			i += extra + 1;
+
+			latin.push_back(code < 0x100 ? (char)code : '?');
+		}
+
+		double base_x, base_y;
+		this->text_origin(x, y, (int)latin.size(), base_x, base_y);
+
+		// The text matrix turns the glyphs upright in the flipped page
+		double angle = escapement * 3.14159265358979323846 / 1800.0;
+		double matrix[6] = { cos(angle), -sin(angle), -sin(angle), -cos(angle), base_x, base_y };
+
+		this->put(bold ? "BT /F2 " : "BT /F1 ");
+		this->put(this->font_size());
+		this->put(" Tf ");
+		for (int i = 0; i != 6; ++i)
+		{
+			this->put(matrix[i], i < 4 ? 4 : 2);
+			this->put(' ');
+		}
+		this->put("Tm (");
+		for (size_t i = 0; i != latin.size(); ++i)
+		{
+			if (latin[i] == '(' || latin[i] == ')' || latin[i] == '\\')
+			{
+				this->put('\\');
+			}
+			this->put(latin[i]);
+		}
+		this->put(") Tj ET\n");
+
+		this->flush();
+	}
+
+	inline std::vector<unsigned char> CanvasPDF::compress(const std::vector<unsigned char>& data,
+		int level)
+	{
+		Encoding::Deflater image_deflater(level);
+		image_deflater.write(data.data(), data.size());
+		image_deflater.finish();
+
+		std::vector<unsigned char> compressed;
+		compressed.swap(image_deflater.get_output());
+
+		return compressed;
+	}
+
+	inline void CanvasPDF::image(int left, int top, int width, int height,
+		const unsigned char *rgba)
+	{
+		this->flush_stroke();
+
+		size_t pixels = (size_t)width * height;
+		std::vector<unsigned char> color(pixels * 3), alpha(pixels);
+		bool opaque = true;
+		for (size_t i = 0; i != pixels; ++i)
+		{
+			memcpy(&color[i * 3], rgba + i * 4, 3);
+			alpha[i] = rgba[i * 4 + 3] ? 255 : 0;
+			opaque = opaque && alpha[i];
+		}
+
+		Image stored;
+		stored.width = width;
+		stored.height = height;
+		stored.color = compress(color, options.compression);
+		if (!opaque)
+		{
+			stored.alpha = compress(alpha, options.compression);
+		}
+		images.push_back(std::move(stored));
+
+		// The unit square of the image is flipped back, so that its first row is on top
+		this->put("q ");
+		this->put(width);
+		this->put(" 0 0 ");
+		this->put(-height);
+		this->put(' ');
+		this->put(left - 0.5);
+		this->put(' ');
+		this->put(top + height - 0.5);
+		this->put(" cm /Im");
+		this->put((int)images.size() - 1);
+		this->put(" Do Q\n");
+
+		this->flush();
+	}
+
+	inline void CanvasPDF::write_content(const char *data, size_t length)
+	{
+		deflater.write((const unsigned char *)data, length);
+		this->drain();
+	}
+
+	inline void CanvasPDF::drain()
+	{
+		std::vector<unsigned char>& compressed = deflater.get_output();
+		CanvasVector::write((const char *)compressed.data(), compressed.size());
+		content_length += compressed.size();
+		compressed.clear();
+	}
+
+	inline void CanvasPDF::set_clip(const RECT *clip)
+	{
+		this->flush_stroke();
+
+		// Restoring the graphics state removes the clipping, and also
+		// returns the colours and the width to those before it
+		if (clipped)
+		{
+			this->put("Q\n");
+			stroke_color = saved_stroke_color;
+			fill_color = saved_fill_color;
+			line_width = saved_line_width;
+			clipped = false;
+		}
+
+		if (!clip)
+		{
+			return;
+		}
+
+		saved_stroke_color = stroke_color;
+		saved_fill_color = fill_color;
+		saved_line_width = line_width;
+
+		this->put("q ");
+		this->put(clip->left - 0.5, 1);
+		this->put(' ');
+		this->put(clip->top - 0.5, 1);
+		this->put(' ');
+		this->put((int)(clip->right - clip->left));
+		this->put(' ');
+		this->put((int)(clip->bottom - clip->top));
+		this->put(" re W n\n");
+
+		clipped = true;
+	}
+
+	inline bool CanvasPDF::finish()
+	{
+		this->set_clip(nullptr);
+		this->flush(true);
+		deflater.finish();
+		this->drain();
+		this->write("\nendstream\nendobj\n");
+
+		this->begin_object(LENGTH);
+		this->write(std::to_string(content_length) + "\nendobj\n");
+
+		// Every image has an object of its samples and possibly one of its mask
+		std::vector<int> numbers(images.size());
+		int next = FIRST_IMAGE;
+		for (size_t i = 0; i != images.size(); ++i)
+		{
+			numbers[i] = next;
+			next += images[i].alpha.empty() ? 1 : 2;
+		}
+
+		this->begin_object(IMAGES);
+		std::string names = "<<";
+		for (size_t i = 0; i != images.size(); ++i)
+		{
+			names += " /Im" + std::to_string(i) + " " + std::to_string(numbers[i]) + " 0 R";
+		}
+		this->write(names + " >>\nendobj\n");
+
+		for (size_t i = 0; i != images.size(); ++i)
+		{
+			const Image& stored = images[i];
+			std::string size = "/Width " + std::to_string(stored.width) +
+				" /Height " + std::to_string(stored.height);
+
+			this->begin_object(numbers[i]);
+			std::string dictionary = "<< /Type /XObject /Subtype /Image " + size +
+				" /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /FlateDecode";
+			if (!stored.alpha.empty())
+			{
+				dictionary += " /SMask " + std::to_string(numbers[i] + 1) + " 0 R";
+			}
+			this->write(dictionary + " /Length " + std::to_string(stored.color.size()) + " >>\nstream\n");
+			CanvasVector::write((const char *)stored.color.data(), stored.color.size());
+			this->write("\nendstream\nendobj\n");
+
+			if (!stored.alpha.empty())
+			{
+				this->begin_object(numbers[i] + 1);
+				this->write("<< /Type /XObject /Subtype /Image " + size +
+					" /ColorSpace /DeviceGray /BitsPerComponent 8 /Filter /FlateDecode /Length " +
+					std::to_string(stored.alpha.size()) + " >>\nstream\n");
+				CanvasVector::write((const char *)stored.alpha.data(), stored.alpha.size());
+				this->write("\nendstream\nendobj\n");
+			}
+		}
+
+		// Cross-reference table of fixed-width entries
+		size_t xref = written;
+		this->write("xref\n0 " + std::to_string(offsets.size()) + "\n0000000000 65535 f \n");
+		for (size_t i = 1; i != offsets.size(); ++i)
+		{
+			char entry[32];
+			snprintf(entry, sizeof(entry), "%010lu 00000 n \n", (unsigned long)offsets[i]);
+			this->write(entry);
+		}
+		this->write("trailer\n<< /Size " + std::to_string(offsets.size()) +
+			" /Root 1 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n");
+
+		return !failed;
+	}
+}
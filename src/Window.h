@@ -2,39 +2,87 @@
 #include "Header.h"
 #include "Graph.h"
 #include "Render.h"
+#include "DisplayList.h"
+#include "Layout.h"
+#include "Trace.h"
+
+#include <mutex>
 
 namespace cpplot
 {
+	class Series;
+
 	// Window class
 	class Window
 	{
 	public:
-		Window(COLORREF in_color) :
-			background_color(in_color), first_show{ false },
-			active_graph{ 0 }, max_graphs{ MAX_GRAPHS },
-			xy_range{ INFINITY, -INFINITY, INFINITY, -INFINITY }, axis{ new Axis() }
+		Window(COLORREF in_color) : axis{ new Axis() },
+			background_color(in_color), dirty{ false }, shown_rect(), version{ 0 },
+			scene_valid{ false }, scene_metric{ 0, 0 }, active_graph{ 0 }, max_graphs{ MAX_GRAPHS },
+			xy_range{ INFINITY, -INFINITY, INFINITY, -INFINITY }, graph_area()
 		{
 			graph = alloc.allocate(MAX_GRAPHS);
 		};
 
-		void prepare(const std::vector<double>& in_x, const std::vector<double>& in_y,
+		Series prepare(const DataView& in_x, const DataView& in_y,
 			std::string in_name, std::string in_type, int in_size,
 			COLORREF in_color, RenderObjects *render_ptr);
 
-		void prepare(const std::vector<double>& in_y, std::string in_name,
+		Series prepare(const DataView& in_y, std::string in_name,
 			std::string in_type, int in_size, COLORREF in_color,
 			RenderObjects *render_ptr);
 
-		void hist(const std::vector<double>& data, int bins, const std::vector<double>& 
+		// Append length points to the index-th graph
+		void append(int index, const double *x, const double *y, size_t length);
+
+		void set_capacity(int index, size_t capacity);
+
+		// Count a chunk of values to the index-th graph
+		void add(int index, const DataView& data);
+
+		// Whether the data changed since the last show
+		bool is_dirty();
+
+		// Number of changes of the contents, a drawing of the window is up to date
+		// while the version is the same as when it was drawn
+		unsigned long get_version();
+
+		void hist(const DataView& data, int bins, const std::vector<double>& 
 			range, std::string name, int in_size, COLORREF color, bool normed);
 
-		void hist(const std::vector<double>& data, const std::vector<double>& bins,
+		void hist(const DataView& data, const std::vector<double>& bins,
 			std::string name, int in_size, COLORREF color, bool normed);
 
-		void show(HDC hdc, HWND hwnd, RECT rect, HFONT font);
+		// Empty histogram with bins between the range, or adapted to the data 
+		// if the range is empty
+		Series hist(int bins, const std::vector<double>& range, std::string name,
+			int in_size, COLORREF color, bool normed);
+
+		Series hist(const std::vector<double>& bins, std::string name,
+			int in_size, COLORREF color, bool normed);
+
+		// Paint the window to the rectangle and return whether the retained
+		// drawing was replayed, which happens if the data and the layout did not change
+		bool show(Canvas *target, RECT rect);
 
 		bool is_window_initialized() const { return active_graph >= 1; }
 
+		// Zoom the view by the factor (> 1 zooms in) around the point, which is
+		// relative to the rectangle of the last show, returns whether the view changed
+		bool zoom(POINT at, double factor);
+
+		// Move the view as if its contents were dragged by dx and dy pixels
+		bool pan(int dx, int dy);
+
+		// Zoom to the part of the graph in the box relative to the rectangle of the last show
+		bool zoom_to(RECT box);
+
+		// Show the range (min_x, max_x, min_y, max_y), an empty range follows the data again
+		bool set_view(const std::vector<double>& range);
+
+		// Append the renderers given by the user to the graphs of the window
+		void get_shared_renderers(std::vector<const RenderObjects*>& renderers);
+
 		void set_xlabel(std::string xlab);
 
 		void set_ylabel(std::string ylab);
@@ -48,224 +96,402 @@ namespace cpplot
 	private:
 		void resize();
 
+		// Add a new graph with its range
+		void insert(Graph *new_graph, const std::vector<double>& range);
+
+		// Set xy_range to the union of the ranges of the graphs
+		void union_range();
+
+		// Update xy_range after the range of the index-th graph changed from previous
+		void update_range(int index, const std::vector<double>& previous);
+
+		// Mark the contents changed, so that the next show draws them again
+		void invalidate();
+
+		// Set the view to the range if it is valid and wider than the precision of its values
+		bool change_view(const std::vector<double>& range);
+
+		// Range of the last show or the view changed since, empty before the first show
+		const std::vector<double>& current_view() const { return view.empty() ? shown_range : view; }
+
 		Graph **graph; // array of Graph pointers
 		Axis *axis; 
 		std::allocator<Graph*> alloc;
 
 		COLORREF background_color;
-		bool first_show; /* indicator whether window is initialized
-						 and whether this is the first showing */
+		bool dirty; // indicator whether data were appended since the last show
+		RECT shown_rect; // rectangle of the last show
+		unsigned long version; // number of changes of the contents
+
+		DisplayList display; // retained drawing of the last show
+		bool scene_valid; // whether the display list is up to date
+		TextMetric scene_metric; // font metrics of the canvas of the display list
 		int active_graph, max_graphs; /* how many graphs are initialized,
 										how long graph array is*/
 		std::vector<double> xy_range; // min_x, max_x, min_y, max_y
+		std::vector<std::vector<double>> ranges; // ranges of the individual graphs
+
+		std::vector<double> view; // range set by zooming and panning, empty to follow the data
+		std::vector<double> shown_range; // range of the last show
+		RECT graph_area; // graph rectangle of the last show relative to its rectangle
+		LayoutCache layout_cache; // layout of the last show
+
+		std::mutex mutex; // guards the data against appending during show
 	};
 
-	inline void Window::show(HDC hdc, HWND hwnd, RECT rect, HFONT font)
+	/*
+	Handle of a line or scatter series returned by Figure::plot. Points 
+	appended through the handle are added to the existing series, and the 
+	range of its window is updated in amortized O(1). Histograms returned
+	by Figure::stream_hist count the chunks of values added through the
+	handle instead. The handle is valid as long as the Figure exists and
+	can be used from another thread.
+	*/
+	class Series
 	{
-		// Set the adjusted min and max values, adjusted for the free space before/after 
-		// first/last point at the initialization point
-		if (!first_show)
+	public:
+		Series() : window(nullptr), index(0) {};
+
+		Series(Window *in_window, int in_index) : window(in_window), index(in_index) {};
+
+		void append(double x, double y);
+
+		void append(const std::vector<double>& x, const std::vector<double>& y);
+
+		// Keep only the newest capacity points in a ring buffer, 0 keeps all points
+		void set_capacity(size_t capacity);
+
+		// Count a chunk of values to a histogram
+		void add(const DataView& data);
+
+		void add(const std::vector<double>& data);
+
+		bool is_valid() const { return window != nullptr; }
+
+	private:
+		Window *window;
+		int index; // index of the graph in the window
+	};
+
+	inline void Series::append(double x, double y)
+	{
+		if (window)
 		{
-			xy_range[1] += (xy_range[1] - xy_range[0]) * ADJUSTMENT_GRAPH;
-			xy_range[0] -= (xy_range[1] - xy_range[0]) * ADJUSTMENT_GRAPH;
-			xy_range[3] += (xy_range[3] - xy_range[2]) * ADJUSTMENT_GRAPH;
-			xy_range[2] -= (xy_range[3] - xy_range[2]) * ADJUSTMENT_GRAPH;
+			window->append(index, &x, &y, 1);
+		}
+	}
 
-			first_show = true;
+	inline void Series::append(const std::vector<double>& x, const std::vector<double>& y)
+	{
+		if (window)
+		{
+			window->append(index, x.data(), y.data(), x.size() < y.size() ? x.size() : y.size());
 		}
+	}
 
-		// Set rectangle for graph space
-		RECT graph_rect = {
-			rect.left + ADJUSTMENT_WINDOW,
-			rect.top + ADJUSTMENT_WINDOW,
-			rect.right - ADJUSTMENT_WINDOW,
-			rect.bottom - ADJUSTMENT_WINDOW
-		};
+	inline void Series::set_capacity(size_t capacity)
+	{
+		if (window)
+		{
+			window->set_capacity(index, capacity);
+		}
+	}
+
+	inline void Series::add(const DataView& data)
+	{
+		if (window)
+		{
+			window->add(index, data);
+		}
+	}
+
+	inline void Series::add(const std::vector<double>& data)
+	{
+		// Histograms do not keep the data, so they are not copied
+		this->add(DataView(data));
+	}
+
+	inline bool Window::show(Canvas *target, RECT rect)
+	{
+		CPPLOT_TRACE_SCOPE("Window::show");
+		std::lock_guard<std::mutex> lock(mutex);
 
 		// Get parameters of current font
-		TEXTMETRIC textMetric;
-		GetTextMetrics(hdc, &textMetric);
-
-		// Find which attributes the graph should have
-		double x_tick_offset = axis->tick_xoffset(textMetric.tmHeight);
-		double y_tick_offset = axis->tick_yoffset(textMetric.tmHeight);
-		double x_label_offset = axis->label_xoffset(textMetric.tmHeight);
-		double y_label_offset = axis->label_yoffset(textMetric.tmHeight);
-		double title_offset = axis->title_offset(textMetric.tmHeight);
-		double legend_offset = 0.0;
-
-		// Find legend offset if the user wants the legend
-		if (axis->is_legend_activated())
+		TextMetric textMetric = target->get_text_metrics();
+
+		// Replay the retained drawing if neither the data nor the layout changed
+		bool replay = scene_valid && memcmp(&rect, &shown_rect, sizeof(RECT)) == 0 &&
+			textMetric.height == scene_metric.height &&
+			textMetric.ave_char_width == scene_metric.ave_char_width;
+
+		shown_rect = rect;
+		dirty = false;
+
+		if (replay)
 		{
-			// Maximum legend area
-			int legend_width = (int)((graph_rect.right -
-				graph_rect.left) * MAX_LEGEND_RATIO - GRAPH_LEGEND_SPACE);
-
-			legend_offset = axis->legend_offset(hdc, textMetric.tmAveCharWidth,
-				legend_width);
-		}
-
-		// Prepare rectangle for axis and labels
-		RECT x_ticks, y_ticks, x_label, y_label;
-
-		// Set x and y label rectangles
-		x_label.bottom = graph_rect.bottom;
-		x_label.top = (int)(x_label.bottom - x_label_offset);
-
-		y_label.left = graph_rect.left;
-		y_label.right = (int)(y_label.left + y_label_offset);
-
-		// Set x and y tick rectangles
-		x_ticks.bottom = x_label.top;
-		x_ticks.top = (int)(x_ticks.bottom - x_tick_offset);
-
-		y_ticks.left = y_label.right;
-		y_ticks.right = (int)(y_ticks.left + y_tick_offset);
-
-		// Create rectangle for legend
-		RECT legend = graph_rect;
-		legend.right -= GRAPH_LEGEND_SPACE; // move also the right side of the legend
-		legend.left = legend.right - (int)legend_offset;
-
-		// Create title rectangle
-		RECT title_rect = graph_rect;
-		title_rect.bottom = (int)(title_rect.top + title_offset);
-
-		// Adjust the graph rectangle
-		graph_rect.bottom = x_ticks.top;
-		graph_rect.left = y_ticks.right;
-		graph_rect.right = legend.left - GRAPH_LEGEND_SPACE;
-		graph_rect.top = title_rect.bottom;
-
-		// Adjust axis attributes to fit the adjusted graph rectangle,
-		// i.e. those sides which are not affected by that particular attribute
-		x_ticks.left = graph_rect.left;
-		x_ticks.right = graph_rect.right;
-		y_ticks.top = graph_rect.top;
-		y_ticks.bottom = graph_rect.bottom;
-		x_label.left = graph_rect.left;
-		x_label.right = graph_rect.right;
-		y_label.top = graph_rect.top;
-		y_label.bottom = graph_rect.bottom;
-		legend.top = graph_rect.top;
-		legend.bottom = graph_rect.bottom;
-		title_rect.right = graph_rect.right;
-		title_rect.left = graph_rect.left;
+			CPPLOT_TRACE_COUNT(TRACE_CACHE_HITS, 1);
+			display.replay(target);
+
+			return true;
+		}
 
-		// Draw and fill the enclosing rectangle
-		HPEN hBoxPen = CreatePen(PS_SOLID, 1, BLACK);
-		HBRUSH hGraphBrush = CreateSolidBrush(background_color);
-		HGDIOBJ prev_hBoxPen = SelectObject(hdc, hBoxPen);
-		HGDIOBJ prev_hGraphBrush = SelectObject(hdc, hGraphBrush);
-		Rectangle(hdc, graph_rect.left, graph_rect.top, graph_rect.right, graph_rect.bottom);
-
-		// Set previous options and delete graphics objects
-		SelectObject(hdc, prev_hBoxPen);
-		SelectObject(hdc, prev_hGraphBrush);
-		DeleteObject(hBoxPen);
-		DeleteObject(hGraphBrush);
-
-		// Paint individual graphs
 		for (int i = 0; i != active_graph; ++i)
 		{
-			graph[i]->show(hdc, hwnd, graph_rect, xy_range);
+			graph[i]->flush();
+		}
+
+		// Record the drawing while painting it
+		display.record(target);
+		Canvas *canvas = &display;
+
+		// Set the min and max values adjusted for the free space before/after 
+		// first/last point, unless the view was zoomed or panned
+		std::vector<double> range = view;
+		if (range.empty())
+		{
+			range = xy_range;
+			range[1] += (range[1] - range[0]) * ADJUSTMENT_GRAPH;
+			range[0] -= (range[1] - range[0]) * ADJUSTMENT_GRAPH;
+			range[3] += (range[3] - range[2]) * ADJUSTMENT_GRAPH;
+			range[2] -= (range[3] - range[2]) * ADJUSTMENT_GRAPH;
 		}
 
-		// Call the rendering of axis ticks and labels -> automatic
-		axis->show_ticks(hdc, hwnd, x_ticks, y_ticks, xy_range, font);
+		// A single value is shown in the middle of a range of its magnitude
+		for (int i = 0; i != 4; i += 2)
+		{
+			if (range[i] == range[i + 1])
+			{
+				double pad = range[i] != 0.0 ? 0.5 * fabs(range[i]) : 0.5;
+				range[i] -= pad;
+				range[i + 1] += pad;
+			}
+		}
+
+		// The layout is computed again only if any of its inputs changed
+		LayoutInput input;
+		memset(&input, 0, sizeof(LayoutInput));
+		input.rect = rect;
+		memcpy(input.range, range.data(), sizeof(input.range));
+		input.metric = textMetric;
+		input.xlabel = axis->is_xlabel_activated();
+		input.ylabel = axis->is_ylabel_activated();
+		input.title = axis->is_title_activated();
+		input.legend = axis->is_legend_activated();
+		input.legend_length = input.legend ? axis->legend_length() : 0;
+
+		const WindowLayout& layout = layout_cache.get(input);
+		bool has_data = layout.has_data;
+		RECT graph_rect = layout.graph;
+
+		// Draw and fill the enclosing rectangle
+		canvas->select_pen(BLACK, 1);
+		canvas->select_brush(background_color);
+		canvas->rectangle(graph_rect.left, graph_rect.top, graph_rect.right, graph_rect.bottom);
+
+		// The view is mapped back to the data through the graph rectangle
+		shown_range = has_data ? range : std::vector<double>();
+		graph_area = RECT{ graph_rect.left - rect.left, graph_rect.top - rect.top,
+			graph_rect.right - rect.left, graph_rect.bottom - rect.top };
+
+		// Paint individual graphs and the axis ticks and labels
+		if (has_data)
+		{
+			// The graphs of a zoomed or panned view continue beyond the rectangle
+			if (!view.empty())
+			{
+				canvas->set_clip(&graph_rect);
+			}
+
+			for (int i = 0; i != active_graph; ++i)
+			{
+				graph[i]->show(canvas, graph_rect, range);
+			}
+
+			if (!view.empty())
+			{
+				canvas->set_clip(nullptr);
+			}
+
+			axis->show_ticks(canvas, layout);
+		}
 
 		// Call the rendering of x_label
-		if (axis->is_xlabel_activated())
+		if (axis->is_xlabel_activated() || layout.x_axis.add_on)
 		{
-			axis->show_xlabel(hdc, hwnd, x_label, font);
+			axis->show_xlabel(canvas, layout.x_label, layout.x_axis.add_on_text);
 		}
 
 		// Call the rendering of y_label
-		if (axis->is_ylabel_activated())
+		if (axis->is_ylabel_activated() || layout.y_axis.add_on)
 		{
-			axis->show_ylabel(hdc, hwnd, y_label, font);
+			axis->show_ylabel(canvas, layout.y_label, layout.y_axis.add_on_text);
 		}
 
 		// Call the rendering of title
 		if (axis->is_title_activated())
 		{
-			axis->show_title(hdc, hwnd, title_rect, font);
+			axis->show_title(canvas, layout.title);
 		}
 
 		// Call the rendering of legend
 		if (axis->is_legend_activated())
 		{
-			axis->show_legend(hdc, hwnd, legend, font, textMetric.tmAveCharWidth,
-				textMetric.tmHeight);
+			axis->show_legend(canvas, layout.legend, textMetric.ave_char_width,
+				textMetric.height);
 		}
+
+		scene_valid = display.stop();
+		scene_metric = textMetric;
+
+		return false;
 	}
 
-	inline void Window::prepare(const std::vector<double>& in_x, const std::vector<double>& 
-		in_y, std::string in_name, std::string in_type, int in_size, COLORREF in_color,
-		RenderObjects *render_ptr)
+	inline bool Window::zoom(POINT at, double factor)
 	{
-		// Check for number of plotted graphs in the window and resize the buffer if needed
-		if (active_graph >= max_graphs)
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const std::vector<double>& current = this->current_view();
+		int width = graph_area.right - graph_area.left;
+		int height = graph_area.bottom - graph_area.top;
+		if (current.empty() || width <= 0 || height <= 0 || !(factor > 0.0) ||
+			at.x < graph_area.left || at.x > graph_area.right ||
+			at.y < graph_area.top || at.y > graph_area.bottom)
 		{
-			this->resize();
+			return false;
 		}
 
-		// Insert adequate Graph pointer 
-		std::string local_type = in_type;
+		// The values under the point stay in place
+		double x = current[0] + (at.x - graph_area.left) * (current[1] - current[0]) / width;
+		double y = current[2] + (graph_area.bottom - at.y) * (current[3] - current[2]) / height;
 
-		if (in_type == "scatter")
+		return this->change_view({ x - (x - current[0]) / factor, x + (current[1] - x) / factor,
+			y - (y - current[2]) / factor, y + (current[3] - y) / factor });
+	}
+
+	inline bool Window::pan(int dx, int dy)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const std::vector<double>& current = this->current_view();
+		int width = graph_area.right - graph_area.left;
+		int height = graph_area.bottom - graph_area.top;
+		if (current.empty() || width <= 0 || height <= 0 || (!dx && !dy))
 		{
-			graph[active_graph++] = 
-				new Scatter(in_x, in_y, in_size, in_color, xy_range, render_ptr);
+			return false;
 		}
-		else if (in_type == "line")
+
+		// The y axis points up, while the pixels go down
+		double shift_x = -dx * (current[1] - current[0]) / width;
+		double shift_y = dy * (current[3] - current[2]) / height;
+
+		return this->change_view({ current[0] + shift_x, current[1] + shift_x,
+			current[2] + shift_y, current[3] + shift_y });
+	}
+
+	inline bool Window::zoom_to(RECT box)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const std::vector<double>& current = this->current_view();
+		int width = graph_area.right - graph_area.left;
+		int height = graph_area.bottom - graph_area.top;
+		if (current.empty() || width <= 0 || height <= 0)
 		{
-			graph[active_graph++] = 
-				new Line(in_x, in_y, in_size, in_color, xy_range, render_ptr);
+			return false;
 		}
-		else
+
+		// The corners may be given in any order and outside the graph
+		int left = box.left < box.right ? box.left : box.right;
+		int right = box.left < box.right ? box.right : box.left;
+		int top = box.top < box.bottom ? box.top : box.bottom;
+		int bottom = box.top < box.bottom ? box.bottom : box.top;
+
+		left = left > graph_area.left ? left : graph_area.left;
+		right = right < graph_area.right ? right : graph_area.right;
+		top = top > graph_area.top ? top : graph_area.top;
+		bottom = bottom < graph_area.bottom ? bottom : graph_area.bottom;
+
+		// A click without dragging is not a box
+		if (right - left < SELECTION_MIN_SIZE || bottom - top < SELECTION_MIN_SIZE)
 		{
-			printf("Warning: Unrecognized plot type selected. "
-				"Line type is initialized.\n");
+			return false;
+		}
 
-			local_type = "line";
+		double scale_x = (current[1] - current[0]) / width;
+		double scale_y = (current[3] - current[2]) / height;
 
-			graph[active_graph++] = 
-				new Line(in_x, in_y, in_size, in_color, xy_range, render_ptr);
+		return this->change_view({ current[0] + (left - graph_area.left) * scale_x,
+			current[0] + (right - graph_area.left) * scale_x,
+			current[2] + (graph_area.bottom - bottom) * scale_y,
+			current[2] + (graph_area.bottom - top) * scale_y });
+	}
+
+	inline bool Window::set_view(const std::vector<double>& range)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (range.empty())
+		{
+			if (view.empty())
+			{
+				return false;
+			}
+
+			view.clear();
+			this->invalidate();
+
+			return true;
 		}
 
-		// Set legend parameters
-		axis->set_legend(in_name, local_type, in_color, in_size, render_ptr);
+		if (range.size() != 4)
+		{
+			printf("Warning: The view must have four values. No action taken.\n");
+
+			return false;
+		}
+
+		return this->change_view(range);
 	}
 
-	inline void Window::prepare(const std::vector<double>& in_y, std::string in_name,
-		std::string in_type, int in_size, COLORREF in_color, RenderObjects *render_ptr)
+	inline bool Window::change_view(const std::vector<double>& range)
 	{
-		// Create points on the x-axis
-		std::vector<double> x(in_y.size());
-		for (unsigned int i = 1; i <= x.size(); ++i)
+		for (int i = 0; i != 4; ++i)
 		{
-			x[i - 1] = i;
+			if (!std::isfinite(range[i]))
+			{
+				return false;
+			}
 		}
 
-		// Check for number of graphs in the window and resize if needed
-		if (active_graph >= max_graphs)
+		// Narrower ranges would not map to distinct pixels
+		if (range[1] - range[0] <= 1e-12 * (fabs(range[0]) + fabs(range[1])) ||
+			range[3] - range[2] <= 1e-12 * (fabs(range[2]) + fabs(range[3])) ||
+			range[1] <= range[0] || range[3] <= range[2])
 		{
-			this->resize();
+			return false;
 		}
 
+		view = range;
+		this->invalidate();
+
+		return true;
+	}
+
+	inline Series Window::prepare(const DataView& in_x, const DataView& 
+		in_y, std::string in_name, std::string in_type, int in_size, COLORREF in_color,
+		RenderObjects *render_ptr)
+	{
 		// Insert adequate Graph pointer 
 		std::string local_type = in_type;
+		std::vector<double> range{ INFINITY, -INFINITY, INFINITY, -INFINITY };
 
 		if (in_type == "scatter")
 		{
-			graph[active_graph++] = 
-				new Scatter(x, in_y, in_size, in_color, xy_range, render_ptr);
+			this->insert(new Scatter(in_x, in_y, in_size, in_color, range, render_ptr), range);
 		}
 		else if (in_type == "line")
 		{
-			graph[active_graph++] = 
-				new Line(x, in_y, in_size, in_color, xy_range, render_ptr);
+			this->insert(new Line(in_x, in_y, in_size, in_color, range, render_ptr), range);
 		}
 		else
 		{
@@ -274,67 +500,254 @@ namespace cpplot
 
 			local_type = "line";
 
-			graph[active_graph++] = 
-				new Line(x, in_y, in_size, in_color, xy_range, render_ptr);
+			this->insert(new Line(in_x, in_y, in_size, in_color, range, render_ptr), range);
 		}
 
 		// Set legend parameters
 		axis->set_legend(in_name, local_type, in_color, in_size, render_ptr);
+
+		return Series(this, active_graph - 1);
+	}
+
+	inline Series Window::prepare(const DataView& in_y, std::string in_name,
+		std::string in_type, int in_size, COLORREF in_color, RenderObjects *render_ptr)
+	{
+		// Points on the x-axis are 1, 2, ... without storing them
+		DataView x = DataView::sequence(in_y.size(), 1.0);
+
+		return this->prepare(x, in_y, in_name, in_type, in_size, in_color, render_ptr);
 	}
 
-	inline void Window::hist(const std::vector<double>& data, int bins, 
+	inline void Window::hist(const DataView& data, int bins, 
 		const std::vector<double>& range, std::string name,
 		int in_size, COLORREF color, bool normed)
 	{
-		// Check for number of graphs in the window and resize if needed
-		if (active_graph >= max_graphs)
-		{
-			this->resize();
-		}
-
 		// Insert adequate Graph pointer 
-		graph[active_graph++] = 
-			new Histogram(data, bins, range, in_size, color, normed, xy_range);
+		std::vector<double> hist_range{ INFINITY, -INFINITY, INFINITY, -INFINITY };
+		this->insert(new Histogram(data, bins, range, in_size, color, normed, hist_range),
+			hist_range);
 
 		// Set legend parameters
 		axis->set_legend(name, "hist", color, in_size);
 	}
 
-	inline void Window::hist(const std::vector<double>& data, const std::vector<double>& 
+	inline void Window::hist(const DataView& data, const std::vector<double>& 
 		bins, std::string name, int in_size, COLORREF color, bool normed)
 	{
-		// Check for number of graphs in the window and resize if needed
-		if (active_graph >= max_graphs)
+		// Insert adequate Graph pointer 
+		std::vector<double> range{ INFINITY, -INFINITY, INFINITY, -INFINITY };
+		this->insert(new Histogram(data, bins, in_size, color, normed, range), range);
+
+		// Set legend parameters
+		axis->set_legend(name, "hist", color, in_size);
+	}
+
+	inline Series Window::hist(int bins, const std::vector<double>& range,
+		std::string name, int in_size, COLORREF color, bool normed)
+	{
+		std::vector<double> hist_range{ INFINITY, -INFINITY, INFINITY, -INFINITY };
+		if (range.empty())
 		{
-			this->resize();
+			this->insert(new Histogram(bins, in_size, color, normed), hist_range);
+		}
+		else
+		{
+			// Uniform bins of the fixed range
+			std::vector<double> edges(bins + 1);
+			for (int i = 0; i != bins + 1; i++)
+			{
+				edges[i] = range[0] + i * (range[1] - range[0]) / bins;
+			}
+
+			this->insert(new Histogram(edges, in_size, color, normed), hist_range);
 		}
 
-		// Insert adequate Graph pointer 
-		graph[active_graph++] = 
-			new Histogram(data, bins, in_size, color, normed, xy_range);
+		axis->set_legend(name, "hist", color, in_size);
+
+		return Series(this, active_graph - 1);
+	}
+
+	inline Series Window::hist(const std::vector<double>& bins, std::string name,
+		int in_size, COLORREF color, bool normed)
+	{
+		std::vector<double> hist_range{ INFINITY, -INFINITY, INFINITY, -INFINITY };
+		this->insert(new Histogram(bins, in_size, color, normed), hist_range);
 
-		// Set legend parameters
 		axis->set_legend(name, "hist", color, in_size);
+
+		return Series(this, active_graph - 1);
 	}
 
 	inline void Window::set_xlabel(std::string xlab)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
+
 		axis->set_xlabel(xlab);
+		this->invalidate();
 	}
 
 	inline void Window::set_ylabel(std::string ylab)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
+
 		axis->set_ylabel(ylab);
+		this->invalidate();
 	}
 
 	inline void Window::set_title(std::string ylab)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
+
 		axis->set_title(ylab);
+		this->invalidate();
 	}
 
 	inline void Window::activate_legend()
 	{
+		std::lock_guard<std::mutex> lock(mutex);
+
 		axis->activate_legend();
+		this->invalidate();
+	}
+
+	inline void Window::append(int index, const double *x, const double *y, size_t length)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<double>& range = ranges[index];
+		std::vector<double> previous = range;
+		for (size_t i = 0; i != length; ++i)
+		{
+			if (!graph[index]->append(x[i], y[i], range))
+			{
+				printf("Warning: The graph does not support appending. No action taken.\n");
+
+				return;
+			}
+		}
+
+		this->update_range(index, previous);
+
+		this->invalidate();
+	}
+
+	inline void Window::set_capacity(int index, size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!graph[index]->set_capacity(capacity, ranges[index]))
+		{
+			printf("Warning: The graph does not support capacity. No action taken.\n");
+
+			return;
+		}
+
+		this->union_range();
+
+		this->invalidate();
+	}
+
+	inline void Window::add(int index, const DataView& data)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<double> previous = ranges[index];
+		if (!graph[index]->add(data, ranges[index]))
+		{
+			printf("Warning: The graph does not count values. No action taken.\n");
+
+			return;
+		}
+
+		this->update_range(index, previous);
+
+		this->invalidate();
+	}
+
+	inline bool Window::is_dirty()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return dirty;
+	}
+
+	inline void Window::get_shared_renderers(std::vector<const RenderObjects*>& renderers)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (int i = 0; i != active_graph; ++i)
+		{
+			if (graph[i]->get_shared_renderer())
+			{
+				renderers.push_back(graph[i]->get_shared_renderer());
+			}
+		}
+	}
+
+	inline unsigned long Window::get_version()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return version;
+	}
+
+	inline void Window::insert(Graph *new_graph, const std::vector<double>& range)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Check for number of graphs in the window and resize if needed
+		if (active_graph >= max_graphs)
+		{
+			this->resize();
+		}
+
+		graph[active_graph++] = new_graph;
+		ranges.push_back(range);
+
+		xy_range[0] = xy_range[0] < range[0] ? xy_range[0] : range[0];
+		xy_range[1] = xy_range[1] > range[1] ? xy_range[1] : range[1];
+		xy_range[2] = xy_range[2] < range[2] ? xy_range[2] : range[2];
+		xy_range[3] = xy_range[3] > range[3] ? xy_range[3] : range[3];
+
+		this->invalidate();
+	}
+
+	inline void Window::union_range()
+	{
+		xy_range = { INFINITY, -INFINITY, INFINITY, -INFINITY };
+		for (size_t i = 0; i != ranges.size(); ++i)
+		{
+			xy_range[0] = xy_range[0] < ranges[i][0] ? xy_range[0] : ranges[i][0];
+			xy_range[1] = xy_range[1] > ranges[i][1] ? xy_range[1] : ranges[i][1];
+			xy_range[2] = xy_range[2] < ranges[i][2] ? xy_range[2] : ranges[i][2];
+			xy_range[3] = xy_range[3] > ranges[i][3] ? xy_range[3] : ranges[i][3];
+		}
+	}
+
+	inline void Window::update_range(int index, const std::vector<double>& previous)
+	{
+		const std::vector<double>& range = ranges[index];
+
+		// The union must be found again only if the range of the graph shrank
+		if (range[0] > previous[0] || range[1] < previous[1] ||
+			range[2] > previous[2] || range[3] < previous[3])
+		{
+			this->union_range();
+		}
+		else
+		{
+			xy_range[0] = xy_range[0] < range[0] ? xy_range[0] : range[0];
+			xy_range[1] = xy_range[1] > range[1] ? xy_range[1] : range[1];
+			xy_range[2] = xy_range[2] < range[2] ? xy_range[2] : range[2];
+			xy_range[3] = xy_range[3] > range[3] ? xy_range[3] : range[3];
+		}
+	}
+
+	inline void Window::invalidate()
+	{
+		dirty = true;
+		scene_valid = false;
+		++version;
 	}
 
 	inline void Window::resize()
@@ -0,0 +1,292 @@
+/*
+Tests of the layout stage (Layout.h), which needs neither a window nor
+a canvas: the ticks and the labels of the axes for normal, narrow, large
+and zoomed ranges, empty and infinite ranges, the halving of the labels that
+do not fit to the axis and the recomputation of LayoutCache. The trace
+is compiled in to count the layouts computed by the cache.
+
+Build and run on Linux:
+	g++ -std=c++17 -O2 -pthread layout.cpp -o layout && ./layout
+*/
+#define CPPLOT_TRACE
+#include "../src/Figure.h"
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char *text, int line)
+	{
+		if (!condition)
+		{
+			printf("ERROR: Check %s on line %d failed.\n", text, line);
+			++failures;
+		}
+	}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+	cpplot::TextMetric metric()
+	{
+		return cpplot::TextMetric{ 16, 7 };
+	}
+
+	// Lay out the values from to along an axis of length pixels
+	cpplot::AxisLayout axis(double from, double to, int length)
+	{
+		cpplot::AxisLayout layout;
+		cpplot::Layout::axis(RECT{ 0, 0, 60, length }, from, to, metric(), layout);
+
+		return layout;
+	}
+
+	// Labels of the axis joined by spaces
+	std::string texts(const cpplot::AxisLayout& layout)
+	{
+		std::string joined;
+		for (size_t i = 0; i != layout.labels.size(); ++i)
+		{
+			joined += (i ? " " : "") + std::string(layout.labels[i].text,
+				layout.labels[i].length);
+		}
+
+		return joined;
+	}
+
+	cpplot::LayoutInput input()
+	{
+		cpplot::LayoutInput in;
+		in.rect = RECT{ 0, 0, 800, 600 };
+		in.range[0] = 0.0;
+		in.range[1] = 10.0;
+		in.range[2] = -1.0;
+		in.range[3] = 1.0;
+		in.metric = metric();
+		in.xlabel = in.ylabel = in.title = in.legend = false;
+		in.legend_length = 0;
+
+		return in;
+	}
+
+	void test_normal_range()
+	{
+		cpplot::AxisLayout layout = axis(0.0, 10.0, 800);
+
+		CHECK(!layout.scientific);
+		CHECK(layout.add_on == 0);
+		CHECK(texts(layout) == "0 2 4 6 8");
+
+		// Ticks every 1 from the bottom of the axis, labels every 2
+		CHECK(layout.ticks.size() == 10);
+		for (size_t i = 0; i != layout.ticks.size(); ++i)
+		{
+			CHECK(layout.ticks[i] == 800 - 80 * (int)i);
+		}
+		CHECK(layout.labels.size() == 5 && layout.labels[2].position == 480);
+
+		CHECK(texts(axis(-1.0, 1.0, 800)) == "-1 -0.5 0 0.5");
+		CHECK(texts(axis(0.1, 0.7, 800)) == "0.1 0.2 0.3 0.4 0.5 0.6");
+	}
+
+	void test_add_on_range()
+	{
+		// The integral part of a range narrower than 10^-MIN_RANGE_DIFF is
+		// subtracted and the rest is written in the scientific notation
+		cpplot::AxisLayout layout = axis(500.25, 500.2501, 800);
+
+		CHECK(layout.scientific);
+		CHECK(layout.add_on == 500);
+		CHECK(texts(layout) == "2.5000e-01 2.5002e-01 2.5004e-01 2.5006e-01 2.5008e-01");
+		CHECK(std::string(layout.add_on_text) == "500");
+		CHECK(!layout.ticks.empty());
+
+		// The window reserves the space of the label showing the add-on
+		cpplot::LayoutInput in = input();
+		in.range[0] = 500.25;
+		in.range[1] = 500.2501;
+		cpplot::WindowLayout window;
+		cpplot::Layout::window(in, window);
+
+		CHECK(window.has_data);
+		CHECK(window.x_axis.add_on == 500 && window.y_axis.add_on == 0);
+		CHECK(window.x_label.bottom - window.x_label.top == metric().height);
+		CHECK(window.y_label.right == window.y_label.left);
+	}
+
+	void test_scientific_range()
+	{
+		CHECK(texts(axis(-2.0e7, 2.0e7, 800)) == "-2.00e+07 -1.00e+07 0.00e+00 1.00e+07");
+
+		// Neighbouring labels differ in the digits of their period
+		cpplot::AxisLayout layout = axis(999000.0, 1001000.0, 800);
+		CHECK(layout.scientific && layout.add_on == 0);
+		CHECK(texts(layout) == "9.990e+05 9.995e+05 1.0000e+06 1.0005e+06");
+	}
+
+	void test_zoomed_range()
+	{
+		// Labels needing more than MAX_TICK_DIGITS digits are written from
+		// a multiple of the power of ten above the range
+		cpplot::AxisLayout layout = axis(999990.0, 1000010.0, 800);
+		CHECK(!layout.scientific && layout.add_on == 999900);
+		CHECK(std::string(layout.add_on_text) == "999900");
+		CHECK(texts(layout) == "90 95 100 105");
+
+		layout = axis(1.0e9, 1.0e9 + 0.01, 800);
+		CHECK(!layout.scientific && layout.add_on == 1.0e9);
+		CHECK(std::string(layout.add_on_text) == "1000000000");
+		CHECK(texts(layout) == "0 0.001 0.002 0.003 0.004 0.005 0.006 0.007 0.008 0.009");
+
+		layout = axis(-1.0e9 - 0.01, -1.0e9, 800);
+		CHECK(std::string(layout.add_on_text) == "-1000000000.01");
+		CHECK(layout.labels.size() == 10 && texts(layout).substr(0, 7) == "0 0.001");
+
+		// The add-on too large for the fixed notation is written in the scientific one
+		layout = axis(1.0e20, 1.0e20 + 1.0e8, 800);
+		CHECK(std::string(layout.add_on_text) == "1.00000000000e+20");
+		CHECK(texts(layout) == "0.00e+00 2.00e+07 4.00e+07 6.00e+07 8.00e+07 1.00e+08");
+
+		// No label is longer than the digits, the sign, the dot and the exponent
+		double ranges[][2] = { { 1.0e9, 1.0e9 + 0.01 }, { 1.0e20, 1.0e20 + 1.0e8 },
+			{ 1234567890.123, 1234567890.125 }, { 500.999999, 500.999999 + 1.0e-9 },
+			{ -1.0e300, -0.9999999e300 } };
+		for (size_t i = 0; i != sizeof(ranges) / sizeof(ranges[0]); ++i)
+		{
+			layout = axis(ranges[i][0], ranges[i][1], 800);
+			CHECK(!layout.labels.empty());
+			for (size_t j = 0; j != layout.labels.size(); ++j)
+			{
+				CHECK(layout.labels[j].length <= MAX_TICK_DIGITS + 6);
+			}
+		}
+
+		// The window reserves the space of the label showing the add-on
+		cpplot::LayoutInput in = input();
+		in.range[2] = 1.0e9;
+		in.range[3] = 1.0e9 + 0.01;
+		cpplot::WindowLayout window;
+		cpplot::Layout::window(in, window);
+
+		CHECK(window.x_axis.add_on == 0 && window.y_axis.add_on == 1.0e9);
+		CHECK(window.y_label.right - window.y_label.left == metric().height);
+	}
+
+	void test_empty_range()
+	{
+		double ranges[][2] = { { 1.0, 1.0 }, { 2.0, 1.0 }, { 0.0, INFINITY },
+			{ -INFINITY, 0.0 }, { NAN, 1.0 } };
+		for (size_t i = 0; i != sizeof(ranges) / sizeof(ranges[0]); ++i)
+		{
+			cpplot::AxisLayout layout = axis(ranges[i][0], ranges[i][1], 800);
+			CHECK(layout.ticks.empty() && layout.labels.empty());
+		}
+
+		// A window without finite data has no axes
+		cpplot::LayoutInput in = input();
+		in.range[2] = NAN;
+		cpplot::WindowLayout window;
+		cpplot::Layout::window(in, window);
+
+		CHECK(!window.has_data);
+		CHECK(window.x_axis.ticks.empty() && window.x_axis.labels.empty());
+		CHECK(window.y_axis.ticks.empty() && window.y_axis.labels.empty());
+	}
+
+	void test_label_halving()
+	{
+		// 24 pixels per label of the longest value (10) fit 5 of the 6 values
+		// of the range on 120 pixels -> the period of 2 is doubled once
+		cpplot::AxisLayout layout = axis(0.0, 10.0, 120);
+		CHECK(texts(layout) == "0 4 8");
+		CHECK(layout.ticks.size() == 10);
+
+		// And twice if only 2 values fit to 60 pixels
+		CHECK(texts(axis(0.0, 10.0, 60)) == "0 8");
+
+		// The labels of a longer axis are not halved
+		CHECK(axis(0.0, 10.0, 800).labels.size() == 5);
+	}
+
+	// Number of the layouts the cache computed for the inputs in a frame
+	unsigned long long computed(cpplot::LayoutCache& cache, cpplot::Trace& trace,
+		const cpplot::LayoutInput& in)
+	{
+		{
+			cpplot::TraceBind bind(&trace);
+			cache.get(in);
+		}
+
+		trace.end_frame();
+		cpplot::TraceStats stats = trace.get_frame_stats();
+		std::map<std::string, cpplot::TracePhase>::const_iterator phase =
+			stats.phases.find("Layout::window");
+
+		return phase == stats.phases.end() ? 0 : phase->second.calls;
+	}
+
+	void test_cache()
+	{
+		cpplot::Trace trace;
+		cpplot::LayoutCache cache;
+		cpplot::LayoutInput base = input();
+
+		CHECK(computed(cache, trace, base) == 1);
+		CHECK(computed(cache, trace, base) == 0);
+
+		// Every field of the input makes the layout computed again once
+		std::vector<cpplot::LayoutInput> changed(14, base);
+		changed[0].rect.left += 1;
+		changed[1].rect.top += 1;
+		changed[2].rect.right += 1;
+		changed[3].rect.bottom += 1;
+		changed[4].range[0] = -1.0;
+		changed[5].range[1] = 20.0;
+		changed[6].range[2] = -2.0;
+		changed[7].range[3] = 2.0;
+		changed[8].metric.height += 1;
+		changed[9].metric.ave_char_width += 1;
+		changed[10].xlabel = true;
+		changed[11].ylabel = true;
+		changed[12].title = true;
+		changed[13].legend = true;
+
+		for (size_t i = 0; i != changed.size(); ++i)
+		{
+			CHECK(computed(cache, trace, changed[i]) == 1);
+			CHECK(computed(cache, trace, changed[i]) == 0);
+			CHECK(computed(cache, trace, base) == 1);
+		}
+
+		cpplot::LayoutInput legend = base;
+		legend.legend = true;
+		CHECK(computed(cache, trace, legend) == 1);
+		legend.legend_length = 12;
+		CHECK(computed(cache, trace, legend) == 1);
+		CHECK(computed(cache, trace, legend) == 0);
+
+		// An invalidated cache computes the same input again
+		cache.invalidate();
+		CHECK(computed(cache, trace, legend) == 1);
+		CHECK(computed(cache, trace, legend) == 0);
+	}
+}
+
+int main()
+{
+	test_normal_range();
+	test_add_on_range();
+	test_scientific_range();
+	test_zoomed_range();
+	test_empty_range();
+	test_label_halving();
+	test_cache();
+
+	if (failures)
+	{
+		printf("%d checks failed.\n", failures);
+		return 1;
+	}
+
+	printf("All checks passed.\n");
+	return 0;
+}
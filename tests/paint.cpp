@@ -0,0 +1,155 @@
+/*
+Tests of the parallel painting of the windows (Figure::paint to a
+Framebuffer), which must produce the same image as the serial painting,
+also for the drawing reaching beyond the layers of the windows: legends
+and markers of small windows, shared renderers and zoomed views.
+
+Build and run on Linux:
+	g++ -std=c++17 -O2 -pthread paint.cpp -o paint && ./paint
+*/
+#include "../src/Figure.h"
+#include <random>
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char *text, int line)
+	{
+		if (!condition)
+		{
+			printf("ERROR: Check %s on line %d failed.\n", text, line);
+			++failures;
+		}
+	}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+	// Number of the pixels in which the images differ
+	int differences(const cpplot::Framebuffer& a, const cpplot::Framebuffer& b)
+	{
+		if (a.get_width() != b.get_width() || a.get_height() != b.get_height())
+		{
+			return -1;
+		}
+
+		int count = 0;
+		for (int y = 0; y != a.get_height(); ++y)
+		{
+			for (int x = 0; x != a.get_width(); ++x)
+			{
+				count += a.get_pixel(x, y) != b.get_pixel(x, y);
+			}
+		}
+
+		return count;
+	}
+
+	// Number of the pixels in which the parallel painting differs from the
+	// serial one for the threads
+	int parallel_differences(cpplot::Figure& figure, unsigned int threads)
+	{
+		figure.set_paint_threads(1);
+		cpplot::Framebuffer serial = figure.render();
+
+		figure.set_paint_threads(threads);
+		cpplot::Framebuffer parallel = figure.render();
+
+		return differences(serial, parallel);
+	}
+
+	// Grid of windows with lines and markers drawn by shared renderers
+	void plot_grid(cpplot::Figure& figure, int rows, int columns,
+		cpplot::RenderObjects *dotted, cpplot::RenderObjects *squares)
+	{
+		std::mt19937_64 generator(123);
+		std::normal_distribution<double> distribution(0.0, 1.0);
+
+		std::vector<double> x(100), y(100), z(100);
+		for (size_t i = 0; i != x.size(); ++i)
+		{
+			x[i] = distribution(generator);
+			y[i] = distribution(generator);
+			z[i] = distribution(generator);
+		}
+
+		for (int i = 0; i != rows; ++i)
+		{
+			for (int j = 0; j != columns; ++j)
+			{
+				figure.plot(x, y, "Line A", "line", 1, BLUE, { i, j });
+				figure.plot(x, z, "Line B", "line", 1, GREEN, { i, j }, dotted);
+				figure.plot(x, y, "Scatter A", "scatter", 5, RED, { i, j });
+				figure.plot(x, z, "Scatter B", "scatter", 3, GREEN, { i, j }, squares);
+				figure.xlabel("Index");
+				figure.ylabel("Value");
+				figure.title("Graph");
+			}
+		}
+	}
+
+	void test_legends()
+	{
+		cpplot::RenderLinesDotted dotted(10);
+		cpplot::RenderScatterSquares squares;
+
+		cpplot::Figure figure(std::vector<int>{ 300, 300 }, std::vector<int>{ 200, 200 },
+			std::vector<COLORREF>{}, true);
+		plot_grid(figure, 2, 2, &dotted, &squares);
+		figure.legend();
+
+		CHECK(parallel_differences(figure, 4) == 0);
+		CHECK(parallel_differences(figure, 2) == 0);
+
+		// Replayed windows are composed the same way
+		CHECK(parallel_differences(figure, 4) == 0);
+	}
+
+	void test_small_windows()
+	{
+		cpplot::RenderLinesDotted dotted(10);
+		cpplot::RenderScatterSquares squares;
+
+		// Legends of windows smaller than the legend itself
+		cpplot::Figure figure(std::vector<int>{ 120, 90, 150 }, std::vector<int>{ 80, 60 },
+			std::vector<COLORREF>{}, true);
+		plot_grid(figure, 2, 3, &dotted, &squares);
+		figure.legend();
+
+		CHECK(parallel_differences(figure, 3) == 0);
+		CHECK(parallel_differences(figure, 0) == 0);
+	}
+
+	void test_zoomed_windows()
+	{
+		cpplot::RenderLinesDotted dotted(10);
+		cpplot::RenderScatterSquares squares;
+
+		cpplot::Figure figure(std::vector<int>{ 300, 300 }, std::vector<int>{ 200, 200 },
+			std::vector<COLORREF>{}, true);
+		plot_grid(figure, 2, 2, &dotted, &squares);
+		figure.legend();
+
+		// Lines and markers running out of the zoomed views
+		figure.zoom(POINT{ 150, 100 }, 8.0);
+		figure.zoom(POINT{ 450, 300 }, 0.25);
+
+		CHECK(parallel_differences(figure, 4) == 0);
+	}
+}
+
+int main()
+{
+	test_legends();
+	test_small_windows();
+	test_zoomed_windows();
+
+	if (failures)
+	{
+		printf("%d checks failed.\n", failures);
+		return 1;
+	}
+
+	printf("All checks passed.\n");
+	return 0;
+}